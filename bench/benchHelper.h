@@ -0,0 +1,77 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef BENCH_HELPER_H
+#define BENCH_HELPER_H
+
+#include "BodyStore.h"
+#include "ObjectFactory.h"
+#include "Universe.h"
+#include "Vector.h"
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+/**
+ *  Returns a vector2 of the given components.
+ */
+inline vector2 makeVector2(double x, double y)
+{
+    vector2 vector;
+    vector[0] = x;
+    vector[1] = y;
+    return vector;
+}
+
+/**
+ *  Returns count bodies at rest scattered uniformly over a disk of radius
+ *  meters, of masses between 0.5 and 1.5 times mass.
+ */
+inline BodyStore makeDisk(size_t count, double radius = 1.0e12, double mass = 1.0e24)
+{
+    std::mt19937_64 generator(3251);
+    std::uniform_real_distribution<> unit(0.0, 1.0);
+    BodyStore bodies;
+    bodies.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const double r = radius * std::sqrt(unit(generator));
+        const double a = 6.283185307179586 * unit(generator);
+        bodies.add("body", mass * (0.5 + unit(generator)),
+            makeVector2(r * std::cos(a), r * std::sin(a)), vector2());
+    }
+    return bodies;
+}
+
+/**
+ *  Returns a sun followed by planets bodies of planetMass on circular orbits
+ *  scattered between 0.5 and 5 AU.
+ */
+inline BodyStore makePlanets(size_t planets, double planetMass)
+{
+    const double au = 1.495978707e11;
+    const double solarMass = 1.98892e30;
+    std::mt19937_64 generator(3251);
+    std::uniform_real_distribution<> unit(0.0, 1.0);
+    BodyStore bodies;
+    bodies.reserve(planets + 1);
+    bodies.add("sun", solarMass, vector2(), vector2());
+    for (size_t i = 0; i < planets; ++i) {
+        const double r = au * (0.5 + 4.5 * unit(generator));
+        const double a = 6.283185307179586 * unit(generator);
+        const double v = std::sqrt(Universe::G * solarMass / r);
+        bodies.add("planet", planetMass, makeVector2(r * std::cos(a), r * std::sin(a)),
+            makeVector2(-v * std::sin(a), v * std::cos(a)));
+    }
+    return bodies;
+}
+
+/**
+ *  Registers every row of bodies with the Universe as an Object.
+ */
+inline void addObjects(const BodyStore& bodies)
+{
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        ObjectFactory::makeObject(
+            bodies.name[i], bodies.mass[i], bodies.getPosition(i), bodies.getVelocity(i));
+    }
+}
+
+#endif // BENCH_HELPER_H
@@ -0,0 +1,131 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "BodyStore.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ *  Compares the time to save and restore a checkpoint of N bodies with the
+ *  time to write and read the same number of bytes as one flat buffer, which
+ *  is as close to the disk bandwidth as a single stream gets. Both writes are
+ *  flushed with fsync; reads come from the page cache unless it is dropped.
+ *  A background save is timed both for the stall of the calling thread and
+ *  for the whole write, while the bodies keep changing underneath it.
+ *
+ *  Usage: checkpointBench [bodies] [path]
+ */
+
+namespace {
+/**
+ *  Returns the seconds elapsed since start.
+ */
+double since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/**
+ *  Returns count random bodies with short names.
+ */
+BodyStore makeBodies(size_t count)
+{
+    std::mt19937_64 generator(3251);
+    std::uniform_real_distribution<> unit(-1.0, 1.0);
+    BodyStore bodies;
+    bodies.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (uint32_t axis = 0; axis < 2; ++axis) {
+            bodies.position[axis][i] = 1.0e12 * unit(generator);
+            bodies.velocity[axis][i] = 1.0e4 * unit(generator);
+        }
+        bodies.mass[i] = 1.0e24 * (2.0 + unit(generator));
+        bodies.name[i] = "body" + std::to_string(i);
+    }
+    return bodies;
+}
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    std::string path = argc > 2 ? argv[2] : "checkpointBench.ckp";
+    BodyStore bodies = makeBodies(count);
+
+    auto start = std::chrono::steady_clock::now();
+    Checkpoint::save(path, bodies, 0.0, 0);
+    double save = since(start);
+
+    start = std::chrono::steady_clock::now();
+    BodyStore restored;
+    {
+        Checkpoint checkpoint(path);
+        checkpoint.restore(restored);
+    }
+    double load = since(start);
+    if (restored.position[0] != bodies.position[0] || restored.name != bodies.name) {
+        std::fprintf(stderr, "restored bodies differ\n");
+        return 1;
+    }
+
+    BackgroundCheckpoint job;
+    start = std::chrono::steady_clock::now();
+    Checkpoint::saveInBackground(path, bodies, 0.0, 0, job);
+    double stall = since(start);
+    // Touch every position page, as a step would, while the child writes.
+    size_t touched = 0;
+    while (job.pending()) {
+        bodies.position[0][touched] += 1.0;
+        touched = (touched + 512) % count;
+    }
+    double background = since(start);
+
+    // The flat buffer is as large as the checkpoint file.
+    off_t bytes = 0;
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        bytes = ::lseek(fd, 0, SEEK_END);
+        ::close(fd);
+    }
+    std::vector<char> buffer(static_cast<size_t>(bytes), 1);
+    const std::string raw = path + ".raw";
+    start = std::chrono::steady_clock::now();
+    {
+        int fd = ::open(raw.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        for (size_t done = 0; done < buffer.size();) {
+            done += static_cast<size_t>(::write(fd, buffer.data() + done, buffer.size() - done));
+        }
+        ::fsync(fd);
+        ::close(fd);
+    }
+    double rawWrite = since(start);
+    start = std::chrono::steady_clock::now();
+    {
+        int fd = ::open(raw.c_str(), O_RDONLY);
+        for (size_t done = 0; done < buffer.size();) {
+            done += static_cast<size_t>(::read(fd, buffer.data() + done, buffer.size() - done));
+        }
+        ::close(fd);
+    }
+    double rawRead = since(start);
+    std::remove(path.c_str());
+    std::remove(raw.c_str());
+
+    const double megabytes = bytes / 1048576.0;
+    std::printf("%zu bodies, %.1f MB\n", count, megabytes);
+    std::printf("%12s %12s %12s\n", "", "time (ms)", "MB/s");
+    std::printf("%12s %12.1f %12.0f\n", "save", save * 1e3, megabytes / save);
+    std::printf("%12s %12.1f %12.0f\n", "raw write", rawWrite * 1e3, megabytes / rawWrite);
+    std::printf("%12s %12.3f %12s\n", "fork stall", stall * 1e3, "");
+    std::printf("%12s %12.1f %12.0f\n", "background", background * 1e3, megabytes / background);
+    std::printf("%12s %12.1f %12.0f\n", "load", load * 1e3, megabytes / load);
+    std::printf("%12s %12.1f %12.0f\n", "raw read", rawRead * 1e3, megabytes / rawRead);
+    return 0;
+}
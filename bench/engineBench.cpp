@@ -0,0 +1,118 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./benchHelper.h"
+#include "BarnesHutEngine.h"
+#include "BodyStore.h"
+#include "FmmEngine.h"
+#include "SimdEngine.h"
+#include "ForceEngine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/**
+ *  Compares the wall time of one force evaluation with direct summation,
+ *  Barnes-Hut and the fast multipole method over a range of body counts, and
+ *  reports where each tree method overtakes the others.
+ *
+ *  Direct summation is also timed on a pool of the given number of threads to
+ *  show its parallel speedup, and serially with the symmetric engine and the
+ *  SIMD engine in double and mixed precision.
+ *
+ *  Usage: engineBench [maxBodies] [fmmOrder] [theta] [threads]
+ */
+
+namespace {
+// Direct summation beyond this many bodies is extrapolated from the largest measured run.
+const size_t directLimit = 40000;
+
+/**
+ *  Returns the best wall time in seconds of one evaluation, repeating for at
+ *  least a fifth of a second.
+ */
+double timeEngine(ForceEngine& engine, const BodyStore& bodies, ThreadPool& pool)
+{
+    ForceEngine::Accelerations acc;
+    double best = 1e300;
+    double total = 0.0;
+    do {
+        auto start = std::chrono::steady_clock::now();
+        engine.computeAccelerations(bodies, acc, pool);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        total += elapsed.count();
+    } while (total < 0.2);
+    return best;
+}
+}
+
+int main(int argc, char** argv)
+{
+    size_t maxBodies = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    uint32_t order = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    double theta = argc > 3 ? std::strtod(argv[3], nullptr) : 0.5;
+    uint32_t threads = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 0;
+
+    ThreadPool serial;
+    ThreadPool parallel(threads);
+
+    DirectEngine direct;
+    SymmetricEngine symmetric;
+    SimdEngine simd;
+    SimdEngine mixed(SimdEngine::Precision::Mixed);
+    BarnesHutEngine barnesHut(theta);
+    FmmEngine fmm(order);
+
+    std::printf("%10s %14s %14s %14s %14s %8s %14s %14s %14s\n", "bodies", "direct [ms]",
+        "barnes-hut [ms]", "fmm [ms]", "direct xT [ms]", "speedup", "symmetric [ms]",
+        "simd [ms]", "mixed [ms]");
+    double directPerPair = 0.0;
+    size_t fmmBeatsDirect = 0;
+    size_t fmmBeatsTree = 0;
+    for (size_t count = 64; count <= maxBodies; count *= 2) {
+        BodyStore bodies = makeDisk(count);
+        double directTime;
+        double threadedTime = 0.0;
+        double symmetricTime = 0.0;
+        double simdTime = 0.0;
+        double mixedTime = 0.0;
+        char mark = ' ';
+        if (count <= directLimit) {
+            directTime = timeEngine(direct, bodies, serial);
+            threadedTime = timeEngine(direct, bodies, parallel);
+            symmetricTime = timeEngine(symmetric, bodies, serial);
+            simdTime = timeEngine(simd, bodies, serial);
+            mixedTime = timeEngine(mixed, bodies, serial);
+            directPerPair = directTime / (double(count) * count);
+        } else {
+            directTime = directPerPair * count * count;
+            mark = '~';
+        }
+        double treeTime = timeEngine(barnesHut, bodies, serial);
+        double fmmTime = timeEngine(fmm, bodies, serial);
+        std::printf("%10zu %c%13.3f %14.3f %14.3f", count, mark, directTime * 1e3, treeTime * 1e3,
+            fmmTime * 1e3);
+        if (threadedTime > 0.0)
+            std::printf(" %14.3f %8.2f %14.3f %14.3f %14.3f\n", threadedTime * 1e3,
+                directTime / threadedTime, symmetricTime * 1e3, simdTime * 1e3,
+                mixedTime * 1e3);
+        else
+            std::printf(" %14s %8s %14s %14s %14s\n", "-", "-", "-", "-", "-");
+        // Track the body count from which the FMM stays ahead.
+        if (fmmTime >= directTime)
+            fmmBeatsDirect = 0;
+        else if (fmmBeatsDirect == 0)
+            fmmBeatsDirect = count;
+        if (fmmTime >= treeTime)
+            fmmBeatsTree = 0;
+        else if (fmmBeatsTree == 0)
+            fmmBeatsTree = count;
+    }
+    std::printf("(~ extrapolated from the measured cost per pair)\n");
+    std::printf("fmm order %u overtakes direct summation at N = %zu\n", order, fmmBeatsDirect);
+    std::printf("fmm order %u overtakes barnes-hut (theta %.2f) at N = %zu\n", order, theta,
+        fmmBeatsTree);
+    std::printf("threaded direct summation used %u threads\n", parallel.size());
+    std::printf("simd kernel: %s\n", SimdEngine::name(simd.getLevel()));
+    return 0;
+}
@@ -0,0 +1,187 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "BlockIntegrator.h"
+#include "Integrator.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "Parser.h"
+#include "Universe.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+/**
+ *  Integrates the two-body scenario of a script for a year with every
+ *  integrator over a range of time steps, and reports the error of the second
+ *  body's final position against the exact Kepler orbit, the relative drift of
+ *  its orbital energy, the number of single-body force evaluations and the
+ *  wall time.
+ *
+ *  Then integrates a clustered system of planets around a sun, one of them a
+ *  tight binary, with block time steps, and compares the number of force
+ *  evaluations with a shared step as small as the binary needs.
+ *
+ *  Usage: integratorBench [script] [planets]
+ */
+
+namespace {
+// 365 days, a whole multiple of every step below.
+const double duration = 365.0 * 86400.0;
+const double steps[] = { 1, 10, 60, 600, 3600, 21600, 86400 };
+
+/**
+ *  Returns the position at time t after (pos, vel) on the Kepler ellipse of a
+ *  body orbiting a fixed mass with gravitational parameter mu.
+ */
+vector2 keplerPosition(const vector2& pos, const vector2& vel, double mu, double t)
+{
+    const double r = pos.norm();
+    const double energy = 0.5 * vel.normSq() - mu / r;
+    const double a = -mu / (2.0 * energy);
+    const double radial = pos * vel;
+    // Eccentricity vector, pointing at the periapsis.
+    vector2 ecc = pos * (vel.normSq() / mu - 1.0 / r) - vel * (radial / mu);
+    const double e = ecc.norm();
+    vector2 p = e > 0.0 ? ecc / e : pos / r;
+    vector2 q;
+    const double h = pos[0] * vel[1] - pos[1] * vel[0];
+    q[0] = h >= 0.0 ? -p[1] : p[1];
+    q[1] = h >= 0.0 ? p[0] : -p[0];
+
+    const double n = std::sqrt(mu / (a * a * a));
+    const double e0 = std::atan2(radial / std::sqrt(mu * a), 1.0 - r / a);
+    const double mean = e0 - e * std::sin(e0) + n * t;
+    double anomaly = mean;
+    for (int i = 0; i < 50; ++i) {
+        anomaly -= (anomaly - e * std::sin(anomaly) - mean) / (1.0 - e * std::cos(anomaly));
+    }
+    return p * (a * (std::cos(anomaly) - e))
+        + q * (a * std::sqrt(1.0 - e * e) * std::sin(anomaly));
+}
+
+/**
+ *  Returns the orbital energy per unit mass of a body about a fixed mass.
+ */
+double orbitalEnergy(const vector2& pos, const vector2& vel, double mu)
+{
+    return 0.5 * vel.normSq() - mu / pos.norm();
+}
+
+/**
+ *  Returns a new integrator of the given kind.
+ */
+std::unique_ptr<Integrator> makeIntegrator(int kind)
+{
+    switch (kind) {
+    case 0:
+        return std::unique_ptr<Integrator>(new EulerIntegrator());
+    case 1:
+        return std::unique_ptr<Integrator>(new LeapfrogIntegrator());
+    case 2:
+        return std::unique_ptr<Integrator>(new VerletIntegrator());
+    case 3:
+        return std::unique_ptr<Integrator>(new YoshidaIntegrator());
+    default:
+        return std::unique_ptr<Integrator>(new BlockIntegrator());
+    }
+}
+
+const char* const names[] = { "euler", "leapfrog", "verlet", "yoshida4", "hermite" };
+
+/**
+ *  Runs the clustered system for a year with block time steps and prints
+ *  the cost against a shared step.
+ */
+void clustered(uint32_t planets)
+{
+    const double sun = 1.98892e30;
+    std::unique_ptr<Universe> univ(Universe::instance());
+    ObjectFactory::makeObject("sun", sun);
+    for (uint32_t i = 0; i < planets; ++i) {
+        double radius = 1.496e11 * (1.0 + 4.0 * i / planets);
+        double angle = 2.399963 * i;
+        double speed = std::sqrt(Universe::G * sun / radius);
+        vector2 pos;
+        pos[0] = radius * std::cos(angle);
+        pos[1] = radius * std::sin(angle);
+        vector2 vel;
+        vel[0] = -speed * std::sin(angle);
+        vel[1] = speed * std::cos(angle);
+        ObjectFactory::makeObject("planet", 1.0e24, pos, vel);
+    }
+    const double radius = 9.0e11;
+    const double separation = 1.0e7;
+    const double orbital = std::sqrt(Universe::G * sun / radius);
+    const double internal = 0.5 * std::sqrt(Universe::G * 2.0e24 / separation);
+    vector2 pos;
+    vector2 vel;
+    pos[0] = radius + 0.5 * separation;
+    vel[1] = orbital + internal;
+    ObjectFactory::makeObject("a", 1.0e24, pos, vel);
+    pos[0] = radius - 0.5 * separation;
+    vel[1] = orbital - internal;
+    ObjectFactory::makeObject("b", 1.0e24, pos, vel);
+
+    BlockIntegrator* block = new BlockIntegrator();
+    univ->setIntegrator(std::unique_ptr<Integrator>(block));
+    auto start = std::chrono::steady_clock::now();
+    univ->advance(86400, 365);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double moving = planets + 2;
+    const vector2 gap = (**(univ->end() - 2)).getPosition() - (**(univ->end() - 1)).getPosition();
+    std::printf("\nclustered: %u planets and a binary %g m wide, one year\n", planets, separation);
+    std::printf("  block times          %llu\n",
+        static_cast<unsigned long long>(block->getBlockSteps()));
+    std::printf("  block evaluations    %llu\n",
+        static_cast<unsigned long long>(block->getEvaluations()));
+    std::printf("  shared evaluations   %.0f\n", moving * block->getBlockSteps());
+    std::printf("  saving               %.1fx\n",
+        moving * block->getBlockSteps() / block->getEvaluations());
+    std::printf("  binary width error   %.3g\n", std::fabs(gap.norm() - separation) / separation);
+    std::printf("  time (ms)            %.1f\n", elapsed.count());
+}
+}
+
+int main(int argc, char** argv)
+{
+    const char* script = argc > 1 ? argv[1] : "../tests/UCMtest.txt";
+
+    std::printf("%-9s %8s %12s %14s %12s %10s\n", "scheme", "dt (s)", "body evals",
+        "pos error (m)", "energy drift", "time (ms)");
+    for (int kind = 0; kind < 5; ++kind) {
+        for (double dt : steps) {
+            std::unique_ptr<Universe> univ(Universe::instance());
+            Parser parser;
+            parser.loadFile(script);
+            if (univ->getBodies().size() < 2) {
+                std::fprintf(stderr, "%s does not describe a sun and a planet\n", script);
+                return 1;
+            }
+            univ->setIntegrator(makeIntegrator(kind));
+            const double mu = Universe::G * (**univ->begin()).getMass();
+            const Object& planet = **(++univ->begin());
+            const vector2 pos = planet.getPosition();
+            const vector2 vel = planet.getVelocity();
+
+            const uint64_t count = static_cast<uint64_t>(duration / dt);
+            auto start = std::chrono::steady_clock::now();
+            univ->advance(dt, count);
+            std::chrono::duration<double, std::milli> elapsed
+                = std::chrono::steady_clock::now() - start;
+
+            const vector2 exact = keplerPosition(pos, vel, mu, duration);
+            const double error = (planet.getPosition() - exact).norm();
+            const double energy = orbitalEnergy(pos, vel, mu);
+            const double drift
+                = std::fabs(orbitalEnergy(planet.getPosition(), planet.getVelocity(), mu) - energy)
+                / std::fabs(energy);
+            std::printf("%-9s %8.0f %12llu %14.4g %12.3g %10.1f\n", names[kind], dt,
+                static_cast<unsigned long long>(univ->getIntegrator().getEvaluations()),
+                error, drift, elapsed.count());
+        }
+    }
+    clustered(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256);
+    return 0;
+}
@@ -0,0 +1,408 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./benchHelper.h"
+#include "BarnesHutEngine.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "Universe.h"
+#include "Vector.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ *  Microbenchmarks of the building blocks of a step: the Vector operations,
+ *  Object::getForce, a getSnapshot and swap round trip, and whole calls to
+ *  stepSimulation from 2 to a million bodies. The direct summation the
+ *  Universe steps with by default is timed up to directLimit bodies, and a
+ *  Barnes-Hut engine beyond.
+ *
+ *  Every case is run with an iteration count grown until it takes at
+ *  least the minimum time, and the best of three such runs is reported as
+ *  nanoseconds per item (an operation, an interaction or a body) and, for
+ *  steps, bodies times steps per second. With --json the results are also
+ *  written as JSON to the given file, "-" for stdout, to be tracked over
+ *  time.
+ *
+ *  Usage: microBench [--json file] [--filter text] [--max-bodies N]
+ *                    [--min-time seconds] [--threads T]
+ *
+ *  N, seconds and T must be positive numbers. An unknown option, a missing
+ *  value or an invalid one prints the usage and exits with 2.
+ */
+
+#include "revision.h"
+
+namespace {
+const char* const usage = "usage: microBench [--json file] [--filter text] [--max-bodies N]\n"
+                          "                  [--min-time seconds] [--threads T]\n";
+
+// Steps with direct summation beyond this many bodies take seconds each.
+const size_t directLimit = 20000;
+// Vectors every iteration of a Vector case works through.
+const size_t vectorCount = 1024;
+// Bodies every iteration of the getForce case sums over.
+const size_t forceBodies = 256;
+
+// Results are stored here, so the compiler cannot drop the work producing them.
+volatile double sink;
+
+/**
+ *  Parses the whole of text as a decimal integer between 1 and limit into
+ *  value. Returns false, leaving value as it was, otherwise.
+ */
+template <typename T> bool parseCount(const char* text, T limit, T& value)
+{
+    // strtoull accepts a sign and wraps negative numbers around.
+    if (*text < '0' || *text > '9')
+        return false;
+    char* end;
+    errno = 0;
+    const unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed == 0 || parsed > limit)
+        return false;
+    value = static_cast<T>(parsed);
+    return true;
+}
+
+/**
+ *  Parses the whole of text as a finite positive number of seconds into
+ *  value. Returns false, leaving value as it was, otherwise.
+ */
+bool parseSeconds(const char* text, double& value)
+{
+    char* end;
+    const double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !std::isfinite(parsed) || !(parsed > 0.0))
+        return false;
+    value = parsed;
+    return true;
+}
+
+/**
+ *  One measured case.
+ */
+struct Result {
+    std::string name;
+    size_t bodies;
+    uint64_t iterations;
+    // Best wall time of one iteration, and what it processes.
+    double seconds;
+    double items;
+    const char* item;
+    double bodySteps;
+};
+
+/**
+ *  Runs and records the cases whose name contains the filter.
+ */
+class Harness {
+public:
+    Harness(double minTime, const std::string& filter, std::FILE* log)
+        : minTime(minTime)
+        , filter(filter)
+        , log(log)
+    {
+    }
+
+    /**
+     *  Times body(iterations), which must do iterations times the work of
+     *  processing items of the given kind and bodySteps bodies times steps.
+     */
+    template <typename Body>
+    void run(const std::string& name, size_t bodies, double items, const char* item,
+        double bodySteps, Body body)
+    {
+        if (name.find(filter) == std::string::npos)
+            return;
+        uint64_t iterations = 1;
+        double elapsed = time(body, iterations);
+        while (elapsed < minTime) {
+            // Aim a little past the minimum so the next run usually suffices.
+            const double factor = elapsed > 0.0 ? 1.4 * minTime / elapsed : 10.0;
+            iterations *= static_cast<uint64_t>(std::min(10.0, std::max(2.0, factor)));
+            elapsed = time(body, iterations);
+        }
+        double best = elapsed;
+        // Cases taking seconds are noisy enough already to need no repeats.
+        for (int repeat = 1; repeat < 3 && elapsed < 1.0; ++repeat) {
+            best = std::min(best, time(body, iterations));
+        }
+        results.push_back(Result { name, bodies, iterations, best / iterations, items, item,
+            bodySteps });
+        const Result& result = results.back();
+        std::fprintf(log, "%-28s %9zu %12llu %14.3f %10s", name.c_str(), bodies,
+            static_cast<unsigned long long>(iterations), result.seconds * 1e9 / items, item);
+        if (bodySteps > 0.0)
+            std::fprintf(log, " %14.4g", bodySteps / result.seconds);
+        std::fprintf(log, "\n");
+        std::fflush(log);
+    }
+
+    /**
+     *  Writes the results as JSON to out.
+     */
+    void writeJson(std::FILE* out, uint32_t threads) const
+    {
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        std::fprintf(out, "{\n  \"context\": {\n");
+        std::fprintf(out, "    \"date\": \"%s\",\n", date);
+        std::fprintf(out, "    \"revision\": \"%s\",\n", NBODY_REVISION);
+        std::fprintf(out, "    \"threads\": %u,\n", threads);
+        std::fprintf(out, "    \"min_time\": %g\n  },\n  \"benchmarks\": [", minTime);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            std::fprintf(out, "%s\n    {\"name\": \"%s\", \"bodies\": %zu, \"iterations\": %llu, ",
+                i == 0 ? "" : ",", result.name.c_str(), result.bodies,
+                static_cast<unsigned long long>(result.iterations));
+            std::fprintf(out, "\"ns_per_iteration\": %.6g, \"item\": \"%s\", ",
+                result.seconds * 1e9, result.item);
+            std::fprintf(out, "\"ns_per_item\": %.6g, \"items_per_second\": %.6g",
+                result.seconds * 1e9 / result.items, result.items / result.seconds);
+            if (result.bodySteps > 0.0)
+                std::fprintf(out, ", \"body_steps_per_second\": %.6g",
+                    result.bodySteps / result.seconds);
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+private:
+    /**
+     *  Returns the wall time in seconds of body(iterations).
+     */
+    template <typename Body> static double time(Body& body, uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    double minTime;
+    std::string filter;
+    // Stream of the table, stderr when the JSON goes to stdout.
+    std::FILE* log;
+    std::vector<Result> results;
+};
+
+/**
+ *  Returns count random vectors with components in [-1, 1).
+ */
+template <uint32_t DIM> std::vector<Vector<DIM>> randomVectors(size_t count, uint64_t seed)
+{
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<> unit(-1.0, 1.0);
+    std::vector<Vector<DIM>> vectors(count);
+    for (Vector<DIM>& vector : vectors) {
+        for (uint32_t axis = 0; axis < DIM; ++axis) {
+            vector[axis] = unit(generator);
+        }
+    }
+    return vectors;
+}
+
+/**
+ *  Times the Vector operations a force evaluation is made of.
+ */
+template <uint32_t DIM> void benchVector(Harness& harness)
+{
+    const std::vector<Vector<DIM>> a = randomVectors<DIM>(vectorCount, 1);
+    const std::vector<Vector<DIM>> b = randomVectors<DIM>(vectorCount, 2);
+    std::vector<Vector<DIM>> c(vectorCount);
+    const std::string prefix = "Vector<" + std::to_string(DIM) + ">::";
+    const double items = vectorCount;
+
+    harness.run(prefix + "operator+", 0, items, "op", 0.0, [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; ++n) {
+            for (size_t i = 0; i < vectorCount; ++i) {
+                c[i] = a[i] + b[i];
+            }
+            sink = c[n % vectorCount][0];
+        }
+    });
+    harness.run(prefix + "operator*(double)", 0, items, "op", 0.0, [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; ++n) {
+            const double scale = 1.0 + 1e-9 * n;
+            for (size_t i = 0; i < vectorCount; ++i) {
+                c[i] = a[i] * scale;
+            }
+            sink = c[n % vectorCount][0];
+        }
+    });
+    harness.run(prefix + "dot", 0, items, "op", 0.0, [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; ++n) {
+            double sum = 0.0;
+            for (size_t i = 0; i < vectorCount; ++i) {
+                sum += a[i].dot(b[i]);
+            }
+            sink = sum;
+        }
+    });
+    harness.run(prefix + "norm", 0, items, "op", 0.0, [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; ++n) {
+            double sum = 0.0;
+            for (size_t i = 0; i < vectorCount; ++i) {
+                sum += a[i].norm();
+            }
+            sink = sum;
+        }
+    });
+    harness.run(prefix + "normalize", 0, items, "op", 0.0, [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; ++n) {
+            for (size_t i = 0; i < vectorCount; ++i) {
+                c[i] = a[i].normalize();
+            }
+            sink = c[n % vectorCount][0];
+        }
+    });
+}
+
+/**
+ *  Times Object::getForce over every pair of a small universe.
+ */
+void benchForce(Harness& harness)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    addObjects(makePlanets(forceBodies - 1, 1.0e20));
+    const std::vector<Object*> objects(univ->begin(), univ->end());
+    const double pairs = double(forceBodies) * (forceBodies - 1);
+    harness.run("Object::getForce", forceBodies, pairs, "pair", 0.0, [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; ++n) {
+            vector2 total;
+            for (const Object* lhs : objects) {
+                for (const Object* rhs : objects) {
+                    if (lhs != rhs)
+                        total += lhs->getForce(*rhs);
+                }
+            }
+            sink = total[0];
+        }
+    });
+}
+
+/**
+ *  Times a getSnapshot and swap round trip, as the Prototype based stepping
+ *  loop does once per step.
+ */
+void benchSnapshot(Harness& harness, size_t maxBodies)
+{
+    for (size_t count = 1000; count <= std::min<size_t>(maxBodies, 100000); count *= 100) {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        addObjects(makePlanets(count - 1, 1.0e20));
+        harness.run("Universe::getSnapshot+swap", count, double(count), "body", 0.0,
+            [&](uint64_t iterations) {
+                for (uint64_t n = 0; n < iterations; ++n) {
+                    std::vector<Object*> snapshot = univ->getSnapshot();
+                    univ->swap(snapshot);
+                }
+                sink = univ->getBodies().position[0][count - 1];
+            });
+    }
+}
+
+/**
+ *  Times stepSimulation with the default direct summation while it takes
+ *  less than seconds a step, and with Barnes-Hut from a thousand bodies on.
+ */
+void benchStep(Harness& harness, size_t maxBodies, uint32_t threads)
+{
+    for (size_t count : { size_t(2), size_t(10), size_t(100), size_t(1000), size_t(10000),
+             size_t(100000), size_t(1000000) }) {
+        if (count > maxBodies)
+            break;
+        std::unique_ptr<Universe> univ(Universe::instance());
+        univ->setThreadCount(threads);
+        addObjects(makePlanets(count - 1, 1.0e20));
+        if (count <= directLimit) {
+            harness.run("Universe::stepSimulation", count, double(count) * (count - 1),
+                "pair", double(count), [&](uint64_t iterations) {
+                    for (uint64_t n = 0; n < iterations; ++n) {
+                        univ->stepSimulation(60.0);
+                    }
+                    sink = univ->getBodies().position[0][count - 1];
+                });
+        }
+        if (count < 1000)
+            continue;
+        univ->setForceEngine(std::unique_ptr<ForceEngine>(new BarnesHutEngine()));
+        harness.run("Universe::stepSimulation/bh", count, double(count), "body", double(count),
+            [&](uint64_t iterations) {
+                for (uint64_t n = 0; n < iterations; ++n) {
+                    univ->stepSimulation(60.0);
+                }
+                sink = univ->getBodies().position[0][count - 1];
+            });
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    const char* json = nullptr;
+    std::string filter;
+    size_t maxBodies = 1000000;
+    double minTime = 0.1;
+    uint32_t threads = 1;
+    for (int i = 1; i < argc; ++i) {
+        const char* option = argv[i];
+        const bool known = std::strcmp(option, "--json") == 0
+            || std::strcmp(option, "--filter") == 0 || std::strcmp(option, "--max-bodies") == 0
+            || std::strcmp(option, "--min-time") == 0 || std::strcmp(option, "--threads") == 0;
+        if (!known || i + 1 == argc) {
+            std::fprintf(stderr, "%s %s\n%s", known ? "missing value for" : "unknown option",
+                option, usage);
+            return 2;
+        }
+        const char* value = argv[++i];
+        bool valid = true;
+        if (std::strcmp(option, "--json") == 0) {
+            json = value;
+        } else if (std::strcmp(option, "--filter") == 0) {
+            filter = value;
+        } else if (std::strcmp(option, "--max-bodies") == 0) {
+            valid = parseCount<size_t>(value, SIZE_MAX, maxBodies);
+        } else if (std::strcmp(option, "--min-time") == 0) {
+            valid = parseSeconds(value, minTime);
+        } else {
+            valid = parseCount<uint32_t>(value, UINT32_MAX, threads);
+        }
+        if (!valid) {
+            std::fprintf(stderr, "invalid value %s for %s\n%s", value, option, usage);
+            return 2;
+        }
+    }
+
+    std::FILE* log = json && std::strcmp(json, "-") == 0 ? stderr : stdout;
+    Harness harness(minTime, filter, log);
+    std::fprintf(log, "%-28s %9s %12s %14s %10s %14s\n", "case", "bodies", "iterations", "ns/item",
+        "item", "body-steps/s");
+    benchVector<2>(harness);
+    benchVector<3>(harness);
+    benchForce(harness);
+    benchSnapshot(harness, maxBodies);
+    benchStep(harness, maxBodies, threads);
+
+    if (json) {
+        std::FILE* out = std::strcmp(json, "-") == 0 ? stdout : std::fopen(json, "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", json);
+            return 1;
+        }
+        harness.writeJson(out, threads);
+        if (out != stdout)
+            std::fclose(out);
+    }
+    return 0;
+}
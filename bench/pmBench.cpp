@@ -0,0 +1,138 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./benchHelper.h"
+#include "BodyStore.h"
+#include "ForceEngine.h"
+#include "PmEngine.h"
+#include "Universe.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/**
+ *  Compares the throughput of the particle-mesh engine with direct summation
+ *  on a uniform disk of N = 10^5 .. 10^7 bodies, for a range of grid sizes
+ *  and each assignment scheme. Direct summation is timed on a smaller disk and
+ *  extrapolated as N^2.
+ *
+ *  Inside a thin disk the inverse-square force is dominated by the nearest
+ *  neighbours, which no mesh resolves, so accuracy is measured on massless
+ *  tracers outside the disk that only feel its smooth field. Their exact
+ *  accelerations are summed directly against all the bodies.
+ *
+ *  Usage: pmBench [maxBodies] [threads]
+ */
+
+namespace {
+// Direct summation is timed at this size and extrapolated.
+const size_t directBodies = 16384;
+// Massless tracers appended after the disk to measure the error.
+const size_t tracers = 64;
+// Radius of the disk.
+const double radius = 1.0e12;
+
+/**
+ *  Returns count bodies of equal mass scattered uniformly over a disk,
+ *  followed by the tracers on a ring around it.
+ */
+BodyStore makeTracedDisk(size_t count)
+{
+    BodyStore bodies = makeDisk(count, radius);
+    std::fill(bodies.mass.begin(), bodies.mass.end(), 1.0e30 / count);
+    bodies.touch();
+    std::mt19937_64 generator(3251);
+    std::uniform_real_distribution<> unit(0.0, 1.0);
+    bodies.reserve(count + tracers);
+    for (size_t i = 0; i < tracers; ++i) {
+        double r = radius * (1.5 + unit(generator));
+        double a = 6.283185307179586 * unit(generator);
+        bodies.add("tracer", 0.0, makeVector2(r * std::cos(a), r * std::sin(a)), vector2());
+    }
+    return bodies;
+}
+
+/**
+ *  Returns the best wall time in seconds of one evaluation, repeating for at
+ *  least a second.
+ */
+double timeEngine(ForceEngine& engine, const BodyStore& bodies, ThreadPool& pool)
+{
+    ForceEngine::Accelerations acc;
+    double best = 1e300;
+    double total = 0.0;
+    do {
+        auto start = std::chrono::steady_clock::now();
+        engine.computeAccelerations(bodies, acc, pool);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        total += elapsed.count();
+    } while (total < 1.0);
+    return best;
+}
+
+/**
+ *  Returns the RMS error of acc over the tracers, normalized by the RMS
+ *  magnitude of their exact accelerations.
+ */
+double tracerError(const BodyStore& bodies, const ForceEngine::Accelerations& acc)
+{
+    const size_t count = bodies.size();
+    double error = 0.0;
+    double norm = 0.0;
+    for (size_t i = count - tracers; i < count; ++i) {
+        double sumX = 0.0;
+        double sumY = 0.0;
+        for (size_t j = 0; j < count; ++j) {
+            double dx = bodies.position[0][j] - bodies.position[0][i];
+            double dy = bodies.position[1][j] - bodies.position[1][i];
+            double distSq = dx * dx + dy * dy;
+            if (distSq == 0.0)
+                continue;
+            double scale = Universe::G * bodies.mass[j] / (distSq * std::sqrt(distSq));
+            sumX += scale * dx;
+            sumY += scale * dy;
+        }
+        double dx = acc[0][i] - sumX;
+        double dy = acc[1][i] - sumY;
+        error += dx * dx + dy * dy;
+        norm += sumX * sumX + sumY * sumY;
+    }
+    return std::sqrt(error / norm);
+}
+}
+
+int main(int argc, char** argv)
+{
+    size_t maxBodies = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    uint32_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+    ThreadPool pool(threads);
+
+    DirectEngine direct;
+    double directTime = timeEngine(direct, makeTracedDisk(directBodies), pool);
+    std::printf("direct summation of %zu bodies: %.1f ms on %u threads\n\n", directBodies,
+        directTime * 1e3, pool.size());
+
+    const char* const schemes[] = { "ngp", "cic", "tsc" };
+    std::printf("%10s %6s %6s %12s %14s %12s %10s\n", "bodies", "grid", "scheme", "pm (ms)",
+        "bodies/s", "direct (s)", "far error");
+    for (size_t count = 100000; count <= maxBodies; count *= 10) {
+        BodyStore bodies = makeTracedDisk(count);
+        const double scale = static_cast<double>(count) / directBodies;
+        for (uint32_t grid : { 256u, 512u, 1024u }) {
+            for (PmEngine::Assignment assignment : { PmEngine::Assignment::Ngp,
+                     PmEngine::Assignment::Cic, PmEngine::Assignment::Tsc }) {
+                PmEngine engine(grid, assignment);
+                double time = timeEngine(engine, bodies, pool);
+                ForceEngine::Accelerations acc;
+                engine.computeAccelerations(bodies, acc, pool);
+                std::printf("%10zu %6u %6s %12.1f %14.3g %12.4g %10.3g\n", count, grid,
+                    schemes[static_cast<int>(assignment)], time * 1e3, count / time,
+                    directTime * scale * scale, tracerError(bodies, acc));
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+# Writes OUTPUT defining NBODY_REVISION as the revision of SOURCE_DIR checked
+# out now. Run on every build; the file is only rewritten when the revision
+# changes, so nothing recompiles otherwise.
+set(revision unknown)
+if(GIT_EXECUTABLE)
+    execute_process(COMMAND ${GIT_EXECUTABLE} rev-parse --short HEAD
+        WORKING_DIRECTORY ${SOURCE_DIR}
+        OUTPUT_VARIABLE head OUTPUT_STRIP_TRAILING_WHITESPACE ERROR_QUIET)
+    if(head)
+        set(revision ${head})
+    endif()
+endif()
+set(content "#define NBODY_REVISION \"${revision}\"\n")
+set(previous "")
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+endif()
+if(NOT previous STREQUAL content)
+    file(WRITE ${OUTPUT} "${content}")
+endif()
@@ -0,0 +1,453 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./benchHelper.h"
+#include "BarnesHutEngine.h"
+#include "BodyStore.h"
+#include "Integrator.h"
+#include "ObjectFactory.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Universe.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ *  End-to-end throughput of whole runs on realistic inputs: the sun-earth
+ *  year of tests/UCMtest.txt in steps of a second, a disk of 1000 planets
+ *  and a cluster of 100000 asteroids. Each scenario runs in a forked child, so
+ *  its peak resident set is its own, and reports the wall time and steps
+ *  per second of its steps, that peak and the relative drift of the total
+ *  energy from the first step to the last. Every run is pinned to the first
+ *  T processors it may use. The time is the median of R runs, 5 by default,
+ *  the spread the range of their times relative to it, and the peak the
+ *  largest.
+ *
+ *  The results are compared with a baseline file of one line per scenario,
+ *
+ *      name wallSeconds stepsPerSecond peakRssKb energyDrift
+ *
+ *  and the run fails if any scenario is slower, or peaks at more memory, by
+ *  more than the threshold, or if its energy drift more than doubles. The
+ *  default threshold of 0.4 sits above the noise measured on a shared
+ *  single-processor machine: over seven invocations the median of five
+ *  runs came out up to 24% slower than the median of all seven, while a
+ *  single run spread by up to 45%. With --update the baselines are
+ *  rewritten from this run instead.
+ *
+ *  With --trace, the first steps of each scenario are then run once more
+ *  with tracing enabled and written to dir/name.json, to be opened in
+ *  chrome://tracing or Perfetto.
+ *
+ *  With --diagnostics every run updates the conserved quantities of the
+ *  Universe after each step, so comparing with a run without shows what
+ *  they cost.
+ *
+ *  Usage: scenarioBench [--baseline file] [--threshold fraction] [--update]
+ *                       [--only name] [--data dir] [--threads T] [--repeat R]
+ *                       [--trace dir] [--diagnostics]
+ *
+ *  Exits with 0 if every scenario is within its baseline, 1 on a regression
+ *  and 2 on an error.
+ */
+
+namespace {
+const double au = 1.495978707e11;
+const double solarMass = 1.98892e30;
+
+/**
+ *  A whole run: how to populate the Universe, and the steps to take.
+ */
+struct Scenario {
+    const char* name;
+    std::function<void(Universe&, const std::string&)> setup;
+    double dt;
+    uint64_t steps;
+};
+
+/**
+ *  What a run measured, or what its baseline says.
+ */
+struct Measurement {
+    double wall;
+    double stepsPerSecond;
+    long peakRss;
+    double drift;
+};
+
+/**
+ *  Returns the sum of m[row] m[j] / r over the rows j after row.
+ */
+double pairs(const BodyStore& bodies, size_t row)
+{
+    const size_t count = bodies.size();
+    const double* x = bodies.position[0].data();
+    const double* y = bodies.position[1].data();
+    const double* m = bodies.mass.data();
+    // Four partial sums let the compiler vectorize the reduction.
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t j = row + 1;
+    for (; j + 4 <= count; j += 4) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            const double dx = x[j + lane] - x[row];
+            const double dy = y[j + lane] - y[row];
+            sum[lane] += m[j + lane] / std::sqrt(dx * dx + dy * dy);
+        }
+    }
+    for (; j < count; ++j) {
+        const double dx = x[j] - x[row];
+        const double dy = y[j] - y[row];
+        sum[0] += m[j] / std::sqrt(dx * dx + dy * dy);
+    }
+    return m[row] * (sum[0] + sum[1] + sum[2] + sum[3]);
+}
+
+/**
+ *  Returns the total energy of bodies, summing the potential over every
+ *  pair on pool. The first row is the fixed sun, whose kinetic energy is
+ *  zero.
+ */
+double energy(const BodyStore& bodies, ThreadPool& pool)
+{
+    const size_t count = bodies.size();
+    double kinetic = 0.0;
+    for (size_t i = 1; i < count; ++i) {
+        double speed = 0.0;
+        for (uint32_t axis = 0; axis < BodyStore::DIM; ++axis) {
+            speed += bodies.velocity[axis][i] * bodies.velocity[axis][i];
+        }
+        kinetic += 0.5 * bodies.mass[i] * speed;
+    }
+    std::vector<double> partial(pool.size(), 0.0);
+    // Row k pairs with fewer rows the later it is, so k and count - 1 - k go together.
+    pool.parallelFor((count + 1) / 2, 64, [&](size_t begin, size_t end, uint32_t worker) {
+        for (size_t k = begin; k < end; ++k) {
+            partial[worker] += pairs(bodies, k);
+            if (count - 1 - k != k)
+                partial[worker] += pairs(bodies, count - 1 - k);
+        }
+    });
+    double potential = 0.0;
+    for (double sum : partial) {
+        potential -= Universe::G * sum;
+    }
+    return kinetic + potential;
+}
+
+/**
+ *  Loads the sun and the earth of the yearlong test.
+ */
+void sunEarth(Universe&, const std::string& data)
+{
+    Parser parser;
+    parser.loadFile((data + "/UCMtest.txt").c_str());
+}
+
+/**
+ *  Registers a sun with 999 planets of earth mass on circular orbits
+ *  between 0.5 and 5 AU, moved by leapfrog with direct summation.
+ */
+void disk(Universe& univ, const std::string&)
+{
+    addObjects(makePlanets(999, 5.9742e24));
+    univ.setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+}
+
+/**
+ *  Registers a sun with a cluster of 99999 asteroids on eccentric orbits
+ *  between 1 and 5 AU, moved by leapfrog with Barnes-Hut. Unlike stars of
+ *  a star cluster, asteroids are light enough that close pairs, which no
+ *  engine softens, stay resolved by steps of a day.
+ */
+void cluster(Universe& univ, const std::string&)
+{
+    std::mt19937_64 generator(3251);
+    std::uniform_real_distribution<> unit(0.0, 1.0);
+    std::normal_distribution<> normal(0.0, 0.1);
+    ObjectFactory::makeObject("sun", solarMass);
+    for (size_t i = 1; i < 100000; ++i) {
+        const double radius = au * (1.0 + 4.0 * unit(generator));
+        const double angle = 6.283185307179586 * unit(generator);
+        const double speed = std::sqrt(Universe::G * solarMass / radius);
+        // Circular velocities perturbed by a tenth of the speed along and across.
+        const double along = speed * (1.0 + normal(generator));
+        const double across = speed * normal(generator);
+        ObjectFactory::makeObject("asteroid", 1.0e18 * (0.5 + unit(generator)),
+            makeVector2(radius * std::cos(angle), radius * std::sin(angle)),
+            makeVector2(across * std::cos(angle) - along * std::sin(angle),
+                across * std::sin(angle) + along * std::cos(angle)));
+    }
+    univ.setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    univ.setForceEngine(std::unique_ptr<ForceEngine>(new BarnesHutEngine()));
+}
+
+/**
+ *  Pins the calling process to the first count processors it may run on,
+ *  so that the scheduler cannot move a measured run between cores. Leaves
+ *  it free if count is zero.
+ */
+void pin(uint32_t count)
+{
+    cpu_set_t allowed;
+    if (count == 0 || ::sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return;
+    cpu_set_t chosen;
+    CPU_ZERO(&chosen);
+    for (int cpu = 0; cpu < CPU_SETSIZE && count > 0; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            CPU_SET(cpu, &chosen);
+            --count;
+        }
+    }
+    ::sched_setaffinity(0, sizeof(chosen), &chosen);
+}
+
+/**
+ *  Sets up and runs scenario on threads threads in a forked child and
+ *  returns what it measured, with the energy drift only if withEnergy.
+ *  The Universe updates its diagnostics if diagnose. Exits with 2 if the
+ *  child fails.
+ */
+Measurement run(const Scenario& scenario, const std::string& data, uint32_t threads,
+    bool withEnergy, bool diagnose)
+{
+    int channel[2];
+    if (::pipe(channel) != 0) {
+        std::perror("pipe");
+        std::exit(2);
+    }
+    const pid_t child = ::fork();
+    if (child < 0) {
+        std::perror("fork");
+        std::exit(2);
+    }
+    if (child == 0) {
+        ::close(channel[0]);
+        Measurement measurement {};
+        {
+            // The energy is summed over every pair, on every hardware thread;
+            // its workers start before the pinning and keep every processor.
+            ThreadPool pool(0);
+            pin(threads);
+            std::unique_ptr<Universe> univ(Universe::instance());
+            univ->setThreadCount(threads);
+            scenario.setup(*univ, data);
+            univ->setDiagnostics(diagnose);
+            const double before = withEnergy ? energy(univ->getBodies(), pool) : 0.0;
+            auto start = std::chrono::steady_clock::now();
+            univ->advance(scenario.dt, scenario.steps);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            const double after = withEnergy ? energy(univ->getBodies(), pool) : 0.0;
+            measurement.wall = elapsed.count();
+            measurement.stepsPerSecond = scenario.steps / measurement.wall;
+            measurement.drift = withEnergy ? std::fabs((after - before) / before) : 0.0;
+        }
+        struct rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        measurement.peakRss = usage.ru_maxrss;
+        const bool written
+            = ::write(channel[1], &measurement, sizeof(measurement)) == sizeof(measurement);
+        ::_exit(written ? 0 : 1);
+    }
+    ::close(channel[1]);
+    Measurement measurement {};
+    const bool read = ::read(channel[0], &measurement, sizeof(measurement)) == sizeof(measurement);
+    ::close(channel[0]);
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    if (!read || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "scenario %s failed\n", scenario.name);
+        std::exit(2);
+    }
+    return measurement;
+}
+
+/**
+ *  Runs the first steps of scenario on threads threads with tracing
+ *  enabled and writes the trace to path. Exits with 2 if it cannot.
+ */
+void trace(const Scenario& scenario, const std::string& data, uint32_t threads,
+    const std::string& path)
+{
+    // A few hundred steps show the shape of a step without a huge trace.
+    const uint64_t steps = std::min<uint64_t>(scenario.steps, 200);
+    try {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        univ->setThreadCount(threads);
+        scenario.setup(*univ, data);
+        Trace::clear();
+        Trace::enable();
+        univ->advance(scenario.dt, steps);
+        Trace::disable();
+        Trace::writeChromeJson(path);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        std::exit(2);
+    }
+    std::printf("traced %llu steps of %s to %s\n", static_cast<unsigned long long>(steps),
+        scenario.name, path.c_str());
+}
+
+/**
+ *  Returns the baselines in path by scenario name, or none if it does not
+ *  exist. Lines starting with # are comments.
+ */
+std::map<std::string, Measurement> readBaselines(const std::string& path)
+{
+    std::map<std::string, Measurement> baselines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string name;
+        Measurement baseline {};
+        if (fields >> name >> baseline.wall >> baseline.stepsPerSecond >> baseline.peakRss
+            >> baseline.drift)
+            baselines[name] = baseline;
+        else
+            std::fprintf(stderr, "%s: ignoring malformed line: %s\n", path.c_str(), line.c_str());
+    }
+    return baselines;
+}
+
+/**
+ *  Writes results to path as baselines. Returns false if it cannot.
+ */
+bool writeBaselines(const std::string& path, const std::map<std::string, Measurement>& results)
+{
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out)
+        return false;
+    std::fprintf(out, "# Baselines of scenarioBench, rewritten by scenarioBench --update.\n");
+    std::fprintf(out, "# name wallSeconds stepsPerSecond peakRssKb energyDrift\n");
+    for (const auto& result : results) {
+        const Measurement& m = result.second;
+        std::fprintf(out, "%s %.4g %.6g %ld %.6g\n", result.first.c_str(), m.wall,
+            m.stepsPerSecond, m.peakRss, m.drift);
+    }
+    return std::fclose(out) == 0;
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::string baselinePath = "../bench/scenarioBaselines.txt";
+    std::string data = "../tests";
+    std::string only;
+    std::string traceDir;
+    double threshold = 0.4;
+    bool update = false;
+    bool diagnose = false;
+    uint32_t threads = 1;
+    uint32_t repeats = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (std::strcmp(argv[i], "--diagnostics") == 0) {
+            diagnose = true;
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--baseline") == 0) {
+            baselinePath = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--threshold") == 0) {
+            threshold = std::strtod(argv[++i], nullptr);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--only") == 0) {
+            only = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--data") == 0) {
+            data = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--repeat") == 0) {
+            repeats = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--threads") == 0) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--trace") == 0) {
+            traceDir = argv[++i];
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    const double year = 31554195.932106005998594489072144;
+    const std::vector<Scenario> scenarios = {
+        { "sun-earth-year", sunEarth, 1.0, static_cast<uint64_t>(std::ceil(year)) },
+        { "disk-1000", disk, 3600.0, 500 },
+        { "cluster-100k", cluster, 86400.0, 5 },
+    };
+    std::map<std::string, Measurement> baselines = readBaselines(baselinePath);
+    std::map<std::string, Measurement> results = baselines;
+
+    std::printf("%-16s %10s %12s %8s %10s %10s %12s %8s  %s\n", "scenario", "wall [s]",
+        "steps/s", "spread", "peak [MB]", "drift", "base steps/s", "change", "status");
+    bool regressed = false;
+    for (const Scenario& scenario : scenarios) {
+        if (!only.empty() && only != scenario.name)
+            continue;
+        // The median of several runs, each in a fresh child, rides out the
+        // stray slow or fast run of a noisy machine.
+        std::vector<Measurement> runs = { run(scenario, data, threads, true, diagnose) };
+        for (uint32_t repeat = 1; repeat < repeats; ++repeat) {
+            runs.push_back(run(scenario, data, threads, false, diagnose));
+        }
+        Measurement m = runs.front();
+        std::sort(runs.begin(), runs.end(),
+            [](const Measurement& a, const Measurement& b) { return a.wall < b.wall; });
+        m.wall = runs[runs.size() / 2].wall;
+        m.stepsPerSecond = runs[runs.size() / 2].stepsPerSecond;
+        for (const Measurement& next : runs) {
+            m.peakRss = std::max(m.peakRss, next.peakRss);
+        }
+        const double spread = (runs.back().wall - runs.front().wall) / m.wall;
+        results[scenario.name] = m;
+        std::printf("%-16s %10.3f %12.4g %7.1f%% %10.1f %10.2e", scenario.name, m.wall,
+            m.stepsPerSecond, 100.0 * spread, m.peakRss / 1024.0, m.drift);
+        auto baseline = baselines.find(scenario.name);
+        if (update || baseline == baselines.end()) {
+            std::printf(" %12s %8s  %s\n", "-", "-", update ? "updated" : "no baseline");
+            continue;
+        }
+        const Measurement& b = baseline->second;
+        const double slowdown = b.stepsPerSecond / m.stepsPerSecond - 1.0;
+        const double change = m.stepsPerSecond / b.stepsPerSecond - 1.0;
+        std::string status;
+        if (slowdown > threshold)
+            status += " slower";
+        if (m.peakRss > b.peakRss * (1.0 + threshold))
+            status += " memory";
+        // The drift is deterministic, so only a real change in the scheme moves it far.
+        if (m.drift > 2.0 * b.drift + 1e-15)
+            status += " drift";
+        regressed = regressed || !status.empty();
+        std::printf(" %12.4g %+7.1f%%  %s\n", b.stepsPerSecond, 100.0 * change,
+            status.empty() ? "ok" : ("REGRESSED:" + status).c_str());
+    }
+    // Traced after every measurement, so that no child inherits its memory.
+    for (const Scenario& scenario : scenarios) {
+        if (!traceDir.empty() && (only.empty() || only == scenario.name))
+            trace(scenario, data, threads, traceDir + "/" + scenario.name + ".json");
+    }
+
+    if (update) {
+        if (!writeBaselines(baselinePath, results)) {
+            std::fprintf(stderr, "cannot write %s\n", baselinePath.c_str());
+            return 2;
+        }
+        return 0;
+    }
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./benchHelper.h"
+#include "BodyStore.h"
+#include "Integrator.h"
+#include "SimdEngine.h"
+#include "ThreadPool.h"
+#include "Trajectory.h"
+#include "Universe.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/**
+ *  Integrates a sun with a disk of N planets on circular orbits between 0.5
+ *  and 5 AU in steps of an hour, and compares the size and encoding time of
+ *  compressed trajectory frames, sampled every stride steps, with the raw
+ *  frames and with the time of a step of the SIMD engine.
+ *
+ *  Usage: trajectoryBench [bodies] [threads]
+ */
+
+namespace {
+const double dt = 3600.0;
+// Frames encoded for every row of the table.
+const size_t frames = 64;
+
+/**
+ *  Returns the seconds elapsed since start.
+ */
+double since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16384;
+    uint32_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+    ThreadPool pool(threads);
+    SimdEngine engine;
+    LeapfrogIntegrator integrator;
+
+    std::printf("%zu bodies on %u threads\n", count + 1, pool.size());
+    std::printf("%8s %12s %12s %10s %14s %14s\n", "stride", "position", "velocity", "ratio",
+        "encode (ms)", "step (ms)");
+    for (uint64_t stride : { 1u, 10u, 100u }) {
+        for (double bound : { 1.0e3, 1.0 }) {
+            BodyStore bodies = makePlanets(count, 1.0e20);
+            TrajectoryCodec codec(bodies.size(), bound, bound * 1.0e-4);
+            TrajectoryCodec::Frame frame;
+            std::vector<uint8_t> bytes;
+            double encodeTime = 0.0;
+            double stepTime = 0.0;
+            size_t encoded = 0;
+            for (size_t f = 0; f < frames; ++f) {
+                auto start = std::chrono::steady_clock::now();
+                for (uint64_t s = 0; s < stride; ++s) {
+                    integrator.step(bodies, dt, engine, pool);
+                }
+                stepTime += since(start);
+                frame.time = static_cast<double>((f + 1) * stride) * dt;
+                for (uint32_t axis = 0; axis < 2; ++axis) {
+                    frame.position[axis].assign(
+                        bodies.position[axis].begin(), bodies.position[axis].end());
+                    frame.velocity[axis].assign(
+                        bodies.velocity[axis].begin(), bodies.velocity[axis].end());
+                }
+                start = std::chrono::steady_clock::now();
+                codec.encode(frame, bytes);
+                encodeTime += since(start);
+                // The first two frames have no full prediction yet.
+                if (f >= 2)
+                    encoded += bytes.size();
+            }
+            const double raw = (frames - 2) * 4.0 * bodies.size() * sizeof(double);
+            std::printf("%8llu %10.0e m %8.0e m/s %10.1f %14.3f %14.2f\n",
+                static_cast<unsigned long long>(stride), bound, bound * 1.0e-4, raw / encoded,
+                encodeTime / frames * 1e3, stepTime / (frames * stride) * 1e3);
+        }
+    }
+    return 0;
+}
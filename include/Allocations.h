@@ -0,0 +1,69 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *  Accounting of the heap allocations of every thread. Executables that
+ *  link src/AllocationHooks.cpp, the tests always and the benchmarks with
+ *  the NBODY_COUNT_ALLOCATIONS option, replace the global operator new and
+ *  delete with versions that count, while tracking is enabled, every
+ *  allocation, the bytes it asks for and every deallocation before handing
+ *  the memory to malloc and free. While tracking is disabled they only load
+ *  a flag. Memory taken from the system another way, like the huge page
+ *  columns of a BodyStore, is counted where it is taken.
+ *
+ *  Tracking nests: it stays enabled until disable has been called once for
+ *  every call to enable.
+ */
+class Allocations {
+public:
+    /**
+     *  Counts since the process started, of the time tracking was enabled.
+     */
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t deallocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    /**
+     *  Starts and stops tracking.
+     */
+    static void enable() noexcept;
+    static void disable() noexcept;
+
+    /**
+     *  Returns true while tracking.
+     */
+    static bool isEnabled() noexcept;
+
+    /**
+     *  Returns true if the counting operator new and delete are linked in,
+     *  so that the counts cover every allocation.
+     */
+    static bool isHooked() noexcept;
+
+    /**
+     *  Counts an allocation of bytes, or a deallocation, if tracking. Called
+     *  by the counting operator new and delete and by every allocator that
+     *  bypasses them.
+     */
+    static void countAllocation(std::size_t bytes) noexcept;
+    static void countDeallocation() noexcept;
+
+    /**
+     *  Records that the counting operator new and delete are linked in.
+     */
+    static void hook() noexcept;
+
+    /**
+     *  Returns the counts so far; the difference of two calls is what
+     *  happened in between.
+     */
+    static Counts get() noexcept;
+};
+
+#endif // ALLOCATIONS_H
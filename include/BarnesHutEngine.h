@@ -0,0 +1,111 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef BARNES_HUT_ENGINE_H
+#define BARNES_HUT_ENGINE_H
+
+#include "ForceEngine.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Barnes-Hut force engine. Every call builds a tree of 2^D-way cells (a
+ *  quadtree in the plane, an octree in space) over the current positions and
+ *  walks it once per body, replacing any cell that subtends an angle smaller
+ *  than theta with a point mass at its centre of mass. Runs in O(N log N);
+ *  theta = 0 degenerates to exact direct summation.
+ */
+template <uint32_t D> class BasicBarnesHutEngine : public BasicForceEngine<D> {
+public:
+    typedef typename BasicForceEngine<D>::Accelerations Accelerations;
+
+    /**
+     *  Creates an engine with the given opening angle. Cells holding at most
+     *  leafSize bodies are not subdivided any further.
+     */
+    explicit BasicBarnesHutEngine(double theta = 0.5, uint32_t leafSize = 8);
+
+    /**
+     *  Builds the tree and walks it for every body.
+     */
+    virtual void computeAccelerations(
+        const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Returns the opening angle.
+     */
+    double getTheta() const noexcept;
+
+    /**
+     *  Sets the opening angle. Larger values are faster but less accurate.
+     */
+    void setTheta(double theta) noexcept;
+
+    /**
+     *  Returns true: distant cells add the potential of their point mass.
+     */
+    virtual bool computesPotentials() const noexcept;
+
+private:
+    /**
+     *  Number of children of a subdivided cell.
+     */
+    static constexpr uint32_t CHILDREN = 1u << D;
+
+    /**
+     *  A square (cubic) cell of the tree.
+     */
+    struct Node {
+        double center[D];
+        double halfSize;
+        double mass;
+        double com[D];
+        // Range of order[] holding the bodies inside this cell.
+        uint32_t first;
+        uint32_t count;
+        // Index of the first of CHILDREN consecutive children, or 0 for a leaf.
+        uint32_t children;
+    };
+
+    /**
+     *  Recursively builds the cell at index node covering order[first, first + count).
+     */
+    void build(const BasicBodyStore<D>& bodies, uint32_t node, uint32_t depth);
+
+    /**
+     *  Stores the acceleration of body i in row i of acc, and its potential
+     *  in row i of phi unless phi is null, by walking the tree from the root.
+     */
+    void walk(const BasicBodyStore<D>& bodies, size_t i, Accelerations& acc, double* phi);
+
+    /**
+     *  Opening angle.
+     */
+    double theta;
+
+    /**
+     *  Maximum number of bodies held by an undivided cell.
+     */
+    uint32_t leafSize;
+
+    /**
+     *  Cells of the tree, the root at index 0. Reused across steps.
+     */
+    std::vector<Node> nodes;
+
+    /**
+     *  Body indices ordered so that each cell's bodies are contiguous.
+     */
+    std::vector<uint32_t> order;
+
+    /**
+     *  Traversal stack reused across walks.
+     */
+    std::vector<uint32_t> stack;
+};
+
+extern template class BasicBarnesHutEngine<2>;
+extern template class BasicBarnesHutEngine<3>;
+
+typedef BasicBarnesHutEngine<2> BarnesHutEngine;
+typedef BasicBarnesHutEngine<3> BarnesHutEngine3;
+
+#endif // BARNES_HUT_ENGINE_H
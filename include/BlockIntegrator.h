@@ -0,0 +1,135 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef BLOCK_INTEGRATOR_H
+#define BLOCK_INTEGRATOR_H
+
+#include "Integrator.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Fourth order Hermite predictor-corrector with individual block time steps.
+ *  Every body takes its own step of timeSec / 2^k, with k chosen from the
+ *  ratio of its acceleration to its jerk, so a close pair shrinks only its own
+ *  steps. At each block time only the bodies whose step ends there are
+ *  corrected; the others are predicted to that time from their last
+ *  acceleration and jerk and act as sources only. All bodies meet again at
+ *  the end of each call to step.
+ *
+ *  Hermite integration needs the jerk of every body, which no ForceEngine
+ *  provides, so the active bodies are evaluated here by direct summation
+ *  over all bodies; the engine passed to step is not used. The outer loop
+ *  over active bodies is split across the pool.
+ */
+template <uint32_t D> class BasicBlockIntegrator : public BasicIntegrator<D> {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+
+    /**
+     *  Creates an integrator taking steps of about eta |a| / |jerk|, but no
+     *  smaller than 2^-maxLevel of the step passed to step.
+     */
+    explicit BasicBlockIntegrator(double eta = 0.01, uint32_t maxLevel = 20);
+
+    /**
+     *  Advances every body through block steps that add up to timeSec.
+     */
+    virtual void step(BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool);
+
+    /**
+     *  Returns the number of block times processed so far. A shared time step
+     *  would have evaluated every body at each of them.
+     */
+    uint64_t getBlockSteps() const noexcept;
+
+    /**
+     *  Returns the accelerations of the last correction if state is the one
+     *  the last step left, and evaluates them through the engine otherwise.
+     */
+    virtual const typename ForceEngine::Accelerations& getAccelerations(
+        const BodyStore& state, ForceEngine& engine, ThreadPool& pool);
+
+private:
+    /**
+     *  Evaluates the acceleration and jerk of every body and picks the first
+     *  steps, for a state this integrator did not produce.
+     */
+    void start(const BodyStore& state, double timeSec, ThreadPool& pool);
+
+    /**
+     *  Predicts every body to tick now from its last correction.
+     */
+    void predict(const BodyStore& state, uint64_t now, double tick, ThreadPool& pool);
+
+    /**
+     *  Sums the acceleration and jerk of every active body over the predicted
+     *  state into nextAcc and nextJerk.
+     */
+    void evaluate(const BodyStore& state, ThreadPool& pool);
+
+    /**
+     *  Returns the step in ticks for a body with the given acceleration and
+     *  jerk, at most limit and never smaller than one tick.
+     */
+    uint64_t span(double accNorm, double jerkNorm, double tick, uint64_t limit) const noexcept;
+
+    /**
+     *  Step accuracy parameter.
+     */
+    double eta;
+
+    /**
+     *  Deepest level; the step passed to step is split into 2^maxLevel ticks.
+     */
+    uint32_t maxLevel;
+
+    /**
+     *  Acceleration and jerk at the last correction of every body.
+     */
+    std::array<typename BodyStore::Column, D> acc;
+    std::array<typename BodyStore::Column, D> jerk;
+
+    /**
+     *  Predicted positions and velocities at the current block time.
+     */
+    std::array<typename BodyStore::Column, D> predictedPosition;
+    std::array<typename BodyStore::Column, D> predictedVelocity;
+
+    /**
+     *  Acceleration and jerk of the active bodies at the current block time.
+     */
+    std::array<typename BodyStore::Column, D> nextAcc;
+    std::array<typename BodyStore::Column, D> nextJerk;
+
+    /**
+     *  Tick of the last correction and step in ticks of every body.
+     */
+    std::vector<uint64_t> time;
+    std::vector<uint64_t> steps;
+
+    /**
+     *  Rows corrected at the current block time.
+     */
+    std::vector<uint32_t> active;
+
+    /**
+     *  Generations of the state and step length left by the last call, to
+     *  tell whether the next call continues from it; zero before the first.
+     */
+    uint64_t lastGeneration = 0;
+    uint64_t lastVelocityGeneration = 0;
+    double lastStep = 0.0;
+
+    /**
+     *  Number of block times processed.
+     */
+    uint64_t blockSteps = 0;
+};
+
+extern template class BasicBlockIntegrator<2>;
+extern template class BasicBlockIntegrator<3>;
+
+typedef BasicBlockIntegrator<2> BlockIntegrator;
+typedef BasicBlockIntegrator<3> BlockIntegrator3;
+
+#endif // BLOCK_INTEGRATOR_H
@@ -0,0 +1,206 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef BODY_STORE_H
+#define BODY_STORE_H
+
+#include "Vector.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ *  Allocator of the BodyStore columns. A column of at least one huge page is
+ *  aligned to one and advised to be backed by transparent huge pages before
+ *  it is first touched. That cuts TLB misses when kernels stream through it,
+ *  and lets fork() hand it to a child in 1/512th of the page table entries,
+ *  so a background checkpoint stalls the simulation for far less time.
+ *  Smaller columns come from the heap as usual.
+ */
+template <typename T> class ColumnAllocator {
+public:
+    typedef T value_type;
+
+    /**
+     *  Size of a transparent huge page on x86-64 and aarch64.
+     */
+    static constexpr size_t HUGE_PAGE = 2 << 20;
+
+    ColumnAllocator() noexcept = default;
+    template <typename U> ColumnAllocator(const ColumnAllocator<U>&) noexcept
+    {
+    }
+
+    /**
+     *  Returns uninitialized storage for count values. Throws std::bad_alloc
+     *  if there is none.
+     */
+    T* allocate(size_t count);
+
+    /**
+     *  Releases storage returned by allocate for the same count.
+     */
+    void deallocate(T* values, size_t count) noexcept;
+};
+
+template <typename T, typename U>
+bool operator==(const ColumnAllocator<T>&, const ColumnAllocator<U>&) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const ColumnAllocator<T>&, const ColumnAllocator<U>&) noexcept
+{
+    return false;
+}
+
+extern template class ColumnAllocator<double>;
+extern template class ColumnAllocator<std::string>;
+
+/**
+ *  Returns a value greater than any returned before in this process. Stores
+ *  and force engines stamp every change of their contents with one, so an
+ *  unchanged stamp means unchanged contents, even across objects.
+ */
+uint64_t nextGeneration() noexcept;
+
+/**
+ *  Structure-of-arrays storage for the bodies registered with the Universe.
+ *  Every property lives in its own contiguous column, so kernels that only
+ *  need positions and masses stream through memory linearly instead of
+ *  chasing one heap pointer per body. Row i of every column describes the
+ *  same body. D is the number of spatial dimensions.
+ *
+ *  The store stamps its positions and masses, and its velocities, with a
+ *  generation that every member writing them renews. Code that writes the
+ *  public columns directly must renew it with touch or touchVelocity, or
+ *  caches keyed on the generation will not see the change.
+ */
+template <uint32_t D> class BasicBodyStore {
+public:
+    /**
+     *  Number of spatial dimensions stored per body.
+     */
+    static constexpr uint32_t DIM = D;
+
+    /**
+     *  A single contiguous column of per-body values.
+     */
+    typedef std::vector<double, ColumnAllocator<double>> Column;
+
+    /**
+     *  Returns the number of bodies (rows) in the store.
+     */
+    size_t size() const noexcept;
+
+    /**
+     *  Returns true if the store holds no bodies.
+     */
+    bool empty() const noexcept;
+
+    /**
+     *  Appends a body and returns the index of its row.
+     */
+    size_t add(const std::string& name, double mass, const Vector<D>& pos, const Vector<D>& vel);
+
+    /**
+     *  Overwrites every column of the given row.
+     */
+    void set(size_t row, const std::string& name, double mass, const Vector<D>& pos,
+        const Vector<D>& vel);
+
+    /**
+     *  Grows or shrinks every column to count rows. New rows are zeroed.
+     */
+    void resize(size_t count);
+
+    /**
+     *  Reserves capacity for count rows in every column.
+     */
+    void reserve(size_t count);
+
+    /**
+     *  Removes every row.
+     */
+    void clear() noexcept;
+
+    /**
+     *  Copies the positions, velocities and masses of from, reusing the
+     *  capacity of the columns, and takes over its generations. The names
+     *  are left alone.
+     */
+    void copyState(const BasicBodyStore& from);
+
+    /**
+     *  Returns the generation of the positions and masses.
+     */
+    uint64_t getGeneration() const noexcept;
+
+    /**
+     *  Returns the generation of the velocities.
+     */
+    uint64_t getVelocityGeneration() const noexcept;
+
+    /**
+     *  Renews the generation after the positions or masses were written.
+     */
+    void touch() noexcept;
+
+    /**
+     *  Renews the generation after the velocities were written.
+     */
+    void touchVelocity() noexcept;
+
+    /**
+     *  Gathers the position columns of a row into a vector.
+     */
+    Vector<D> getPosition(size_t row) const noexcept;
+
+    /**
+     *  Scatters pos into the position columns of a row.
+     */
+    void setPosition(size_t row, const Vector<D>& pos) noexcept;
+
+    /**
+     *  Gathers the velocity columns of a row into a vector.
+     */
+    Vector<D> getVelocity(size_t row) const noexcept;
+
+    /**
+     *  Scatters vel into the velocity columns of a row.
+     */
+    void setVelocity(size_t row, const Vector<D>& vel) noexcept;
+
+    /**
+     *  Position columns in meters, one per axis.
+     */
+    std::array<Column, DIM> position;
+
+    /**
+     *  Velocity columns in meters/second, one per axis.
+     */
+    std::array<Column, DIM> velocity;
+
+    /**
+     *  Mass column in kilograms.
+     */
+    Column mass;
+
+    /**
+     *  Name column.
+     */
+    std::vector<std::string, ColumnAllocator<std::string>> name;
+
+private:
+    uint64_t generation = nextGeneration();
+    uint64_t velocityGeneration = nextGeneration();
+};
+
+extern template class BasicBodyStore<2>;
+extern template class BasicBodyStore<3>;
+
+typedef BasicBodyStore<2> BodyStore;
+typedef BasicBodyStore<3> BodyStore3;
+
+#endif // BODY_STORE_H
@@ -0,0 +1,202 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "BodyStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+template <uint32_t D> class BasicCheckpoint;
+
+/**
+ *  A checkpoint being written by a forked child process. The child shares
+ *  the parent's memory copy-on-write, so it sees the bodies exactly as they
+ *  were at the fork while the parent goes on changing them; the parent only
+ *  pays for the fork itself, which copies page tables but no body data.
+ */
+class BackgroundCheckpoint {
+public:
+    BackgroundCheckpoint() = default;
+
+    /**
+     *  Waits for a checkpoint still being written, ignoring its outcome.
+     */
+    ~BackgroundCheckpoint();
+
+    /**
+     *  Deny copying - the child process is owned by a single object.
+     */
+    BackgroundCheckpoint(const BackgroundCheckpoint& rhs) = delete;
+    BackgroundCheckpoint& operator=(const BackgroundCheckpoint& rhs) = delete;
+
+    /**
+     *  Returns true while a checkpoint is being written. Throws
+     *  std::runtime_error, as wait does, if it has just failed.
+     */
+    bool pending();
+
+    /**
+     *  Blocks until the checkpoint being written, if any, is complete. Throws
+     *  std::runtime_error with the child's error message if it failed.
+     */
+    void wait();
+
+private:
+    /**
+     *  Forks a child that runs save, reports any exception through a pipe
+     *  and exits without unwinding. Waits for the previous child first.
+     */
+    void start(const std::string& path, const std::function<void()>& save);
+    template <uint32_t D> friend class BasicCheckpoint;
+
+    /**
+     *  Collects the child's exit status and message once it has exited.
+     */
+    void finish(int status);
+
+    pid_t child = -1;
+    int messages = -1;
+    std::string path;
+};
+
+/**
+ *  Binary checkpoint of a BodyStore together with the simulation time and
+ *  step count, laid out so that it can be memory mapped and used in place.
+ *
+ *  The file starts with a 64 byte header:
+ *
+ *      offset  size  field
+ *           0     8  magic "NBODYCKP"
+ *           8     4  endianness tag 0x01020304 as written by the saving host
+ *          12     4  format version
+ *          16     4  number of dimensions D
+ *          20     4  reserved, zero
+ *          24     8  number of bodies N
+ *          32     8  simulation time in seconds (double)
+ *          40     8  number of steps taken
+ *          48     8  total length of the names in bytes
+ *          56     8  reserved, zero
+ *
+ *  followed by the columns, each starting on a 64 byte boundary: the D
+ *  position columns, the D velocity columns and the mass column of N doubles
+ *  each, N + 1 uint64 offsets of the names and the names themselves, not
+ *  terminated. A file whose tag reads 0x04030201 was written on a host of
+ *  the other byte order; it is byte swapped into memory when opened.
+ */
+template <uint32_t D> class BasicCheckpoint {
+public:
+    /**
+     *  Format version written by save and accepted when opening.
+     */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     *  Writes bodies, time and steps to a temporary file next to path, flushes
+     *  it to disk and renames it over path, so a crash never leaves a partial
+     *  checkpoint behind. Throws std::runtime_error on failure.
+     */
+    static void save(
+        const std::string& path, const BasicBodyStore<D>& bodies, double time, uint64_t steps);
+
+    /**
+     *  Saves as save does, but from a child process forked by job, and
+     *  returns as soon as the child exists. The checkpoint holds bodies as
+     *  they are now, however they change while it is written. Throws
+     *  std::runtime_error if the previous checkpoint of job failed or the
+     *  process cannot be forked.
+     */
+    static void saveInBackground(const std::string& path, const BasicBodyStore<D>& bodies,
+        double time, uint64_t steps, BackgroundCheckpoint& job);
+
+    /**
+     *  Maps the checkpoint at path read-only and validates it. Throws
+     *  std::runtime_error if it cannot be read, is not a checkpoint, or has
+     *  another version or number of dimensions.
+     */
+    explicit BasicCheckpoint(const std::string& path);
+
+    /**
+     *  Unmaps the file.
+     */
+    ~BasicCheckpoint();
+
+    /**
+     *  Deny copying - the mapping is owned by a single object.
+     */
+    BasicCheckpoint(const BasicCheckpoint& rhs) = delete;
+    BasicCheckpoint& operator=(const BasicCheckpoint& rhs) = delete;
+
+    /**
+     *  Returns the number of bodies.
+     */
+    size_t size() const noexcept;
+
+    /**
+     *  Returns the simulation time in seconds.
+     */
+    double getTime() const noexcept;
+
+    /**
+     *  Returns the number of steps taken.
+     */
+    uint64_t getSteps() const noexcept;
+
+    /**
+     *  Returns the given position, velocity or mass column, in place.
+     */
+    const double* position(uint32_t axis) const noexcept;
+    const double* velocity(uint32_t axis) const noexcept;
+    const double* mass() const noexcept;
+
+    /**
+     *  Returns the name of a row.
+     */
+    std::string name(size_t row) const;
+
+    /**
+     *  Copies every column into bodies, replacing its rows.
+     */
+    void restore(BasicBodyStore<D>& bodies) const;
+
+private:
+    /**
+     *  Returns the column at the given index in the file's column order.
+     */
+    const double* column(uint32_t index) const noexcept;
+
+    /**
+     *  Mapped file and its length.
+     */
+    void* mapping = nullptr;
+    size_t length = 0;
+
+    /**
+     *  Byte swapped copy of a file written with the other byte order.
+     */
+    std::vector<uint64_t> swapped;
+
+    /**
+     *  Start of the file contents, mapped or swapped.
+     */
+    const unsigned char* base = nullptr;
+
+    /**
+     *  Header fields.
+     */
+    size_t count = 0;
+    double time = 0.0;
+    uint64_t steps = 0;
+    uint64_t nameBytes = 0;
+};
+
+extern template class BasicCheckpoint<2>;
+extern template class BasicCheckpoint<3>;
+
+typedef BasicCheckpoint<2> Checkpoint;
+typedef BasicCheckpoint<3> Checkpoint3;
+
+#endif // CHECKPOINT_H
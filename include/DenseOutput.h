@@ -0,0 +1,137 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef DENSE_OUTPUT_H
+#define DENSE_OUTPUT_H
+
+#include "BodyStore.h"
+#include "Vector.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Dense output of the simulation: the positions, velocities and
+ *  accelerations of every body at the ends of the last few steps, from
+ *  which the state at any time in between is interpolated instead of being
+ *  stepped to.
+ *
+ *  Within a step of h seconds from t0 to t1 the position follows the cubic
+ *  Hermite polynomial through the positions and velocities at both ends,
+ *  and the velocity the one through the velocities and accelerations. Both
+ *  are exact at the ends and off by O(h^4) in between, below the error of
+ *  the second order integrators themselves.
+ */
+template <uint32_t D> class BasicDenseOutput {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef std::array<typename BodyStore::Column, D> Columns;
+
+    /**
+     *  Creates an output that interpolates over the last window steps.
+     *  Throws std::invalid_argument if window is zero.
+     */
+    explicit BasicDenseOutput(size_t window = 1);
+
+    /**
+     *  Adds the state at the end of a step at time, with the accelerations
+     *  of its bodies, dropping the oldest step beyond the window. A time not
+     *  after the last one, or another number of bodies, starts over with
+     *  this state alone. The first row is the fixed sun and is kept still.
+     *  Throws std::invalid_argument if the accelerations do not match the
+     *  bodies.
+     */
+    void record(const BodyStore& state, double time, const Columns& acceleration);
+
+    /**
+     *  Forgets every recorded state.
+     */
+    void clear() noexcept;
+
+    /**
+     *  Returns the number of steps interpolated over.
+     */
+    size_t getWindow() const noexcept;
+
+    /**
+     *  Returns the number of bodies recorded.
+     */
+    size_t getBodyCount() const noexcept;
+
+    /**
+     *  Returns the earliest and latest time that can be interpolated at.
+     *  Both are NaN until a state has been recorded.
+     */
+    double getStartTime() const noexcept;
+    double getEndTime() const noexcept;
+
+    /**
+     *  Returns true if time lies between the start and end times.
+     */
+    bool covers(double time) const noexcept;
+
+    /**
+     *  Returns the position and velocity of a body at time. Throws
+     *  std::out_of_range if the time is not covered or the row was not
+     *  recorded.
+     */
+    Vector<D> getPosition(size_t row, double time) const;
+    Vector<D> getVelocity(size_t row, double time) const;
+
+    /**
+     *  Fills position and velocity with the columns of every body at time,
+     *  reusing their capacity. Throws std::out_of_range if the time is not
+     *  covered.
+     */
+    void interpolate(double time, Columns& position, Columns& velocity) const;
+
+private:
+    /**
+     *  State at the end of a step.
+     */
+    struct Sample {
+        double time = 0.0;
+        Columns position;
+        Columns velocity;
+        Columns acceleration;
+    };
+
+    /**
+     *  Coefficients of the interpolation at a time within a step.
+     */
+    struct Weights {
+        const Sample* begin;
+        const Sample* end;
+        // Step length and the Hermite basis weights of the end value and of
+        // the slopes at both ends; the start value has weight 1 - toEnd.
+        double h;
+        double toEnd;
+        double fromStart;
+        double fromEnd;
+    };
+
+    /**
+     *  Returns the i-th retained sample, the oldest first.
+     */
+    const Sample& sample(size_t i) const noexcept;
+
+    /**
+     *  Finds the step containing time by binary search and returns its
+     *  weights. Throws std::out_of_range if the time is not covered.
+     */
+    Weights locate(double time) const;
+
+    /**
+     *  Ring of window + 1 samples, count of them used from first on.
+     */
+    std::vector<Sample> samples;
+    size_t first = 0;
+    size_t count = 0;
+};
+
+extern template class BasicDenseOutput<2>;
+extern template class BasicDenseOutput<3>;
+
+typedef BasicDenseOutput<2> DenseOutput;
+typedef BasicDenseOutput<3> DenseOutput3;
+
+#endif // DENSE_OUTPUT_H
@@ -0,0 +1,96 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "BodyStore.h"
+#include "Vector.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *  Conserved quantities of the simulation, updated once per step in a
+ *  single sweep over the bodies. The potential energy is not summed here,
+ *  which would cost as much as the step itself, but taken from the
+ *  potential of every body that the force engine computed along with the
+ *  accelerations of the step.
+ *
+ *  The first body is the fixed sun. It pulls the others without being
+ *  pulled back, so the momentum of the bodies is not conserved, but the
+ *  energy and the angular momentum about the sun are.
+ */
+template <uint32_t D> class BasicDiagnostics {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+
+    /**
+     *  Quantities of the bodies at one time. Energies are in joules; the
+     *  potential energy, and so the energy, is NaN if it was unknown.
+     */
+    struct Quantities {
+        double time = 0.0;
+        uint64_t step = 0;
+        double mass = 0.0;
+        double kinetic = 0.0;
+        double potential = 0.0;
+        double energy = 0.0;
+        Vector<D> momentum;
+        Vector<D> centerOfMass;
+        // About the first body; only z is used in the plane.
+        vector3 angularMomentum;
+    };
+
+    /**
+     *  Sweeps state once for the quantities at time after step steps. The
+     *  potential holds that of every body in J/kg, as filled by a force
+     *  engine, or is empty if it is unknown. The first update, and the
+     *  first after clear, sets the initial quantities. Throws
+     *  std::invalid_argument if potential holds neither no row nor one per
+     *  body.
+     */
+    void update(const BodyStore& state, const typename BodyStore::Column& potential,
+        double time, uint64_t step);
+
+    /**
+     *  Forgets every update.
+     */
+    void clear() noexcept;
+
+    /**
+     *  Returns the number of updates since the last clear.
+     */
+    uint64_t getUpdates() const noexcept;
+
+    /**
+     *  Returns the quantities of the last and of the first update.
+     */
+    const Quantities& getCurrent() const noexcept;
+    const Quantities& getInitial() const noexcept;
+
+    /**
+     *  Returns the change of the energy since the first update relative to
+     *  its initial magnitude, now and the largest in magnitude so far. NaN
+     *  if either energy is unknown.
+     */
+    double getEnergyDrift() const noexcept;
+    double getMaxEnergyDrift() const noexcept;
+
+    /**
+     *  Returns the length of the change of the angular momentum since the
+     *  first update relative to its initial length.
+     */
+    double getAngularMomentumDrift() const noexcept;
+
+private:
+    Quantities initial;
+    Quantities current;
+    uint64_t updates = 0;
+    double maxEnergyDrift = 0.0;
+};
+
+extern template class BasicDiagnostics<2>;
+extern template class BasicDiagnostics<3>;
+
+typedef BasicDiagnostics<2> Diagnostics;
+typedef BasicDiagnostics<3> Diagnostics3;
+
+#endif // DIAGNOSTICS_H
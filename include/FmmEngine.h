@@ -0,0 +1,160 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef FMM_ENGINE_H
+#define FMM_ENGINE_H
+
+#include "ForceEngine.h"
+#include "Vector.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Fast multipole method force engine. Bodies are binned into a uniform
+ *  quadtree whose depth grows with N so that leaves hold a roughly constant
+ *  number of bodies. Multipole expansions are built at the leaves, shifted
+ *  up the tree, converted to local expansions between well-separated cells
+ *  of the same level, shifted down and evaluated at the bodies; neighbouring
+ *  leaves interact directly. Runs in O(N) for reasonably uniform
+ *  distributions.
+ *
+ *  The force law is the inverse-square law restricted to the plane, whose
+ *  potential 1/r is not harmonic in 2D, so the expansions are Cartesian
+ *  Taylor expansions of 1/r (terms x^a y^b with a + b <= order) about the
+ *  cell centres rather than complex power series.
+ */
+class FmmEngine : public ForceEngine {
+public:
+    /**
+     *  Creates an engine with the given expansion order. The tree is refined
+     *  until the average leaf holds at most leafSize bodies.
+     */
+    explicit FmmEngine(uint32_t order = 4, uint32_t leafSize = 32);
+
+    /**
+     *  Runs the upward, interaction and downward passes for every body.
+     */
+    virtual void computeAccelerations(
+        const BodyStore& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Returns the expansion order.
+     */
+    uint32_t getOrder() const noexcept;
+
+    /**
+     *  Sets the expansion order. Higher orders are slower but more accurate.
+     */
+    void setOrder(uint32_t order);
+
+private:
+    /**
+     *  Rebuilds the index tables for the current order.
+     */
+    void buildTerms();
+
+    /**
+     *  Returns the index of the coefficient for x^a y^b.
+     */
+    uint32_t term(uint32_t a, uint32_t b) const noexcept;
+
+    /**
+     *  Fills out[term(a, b)] with the derivative d^a/dx^a d^b/dy^b of 1/r
+     *  evaluated at r for every a + b <= order.
+     */
+    void derivatives(const vector2& r, double* out) const;
+
+    /**
+     *  Fills out[term(a, b)] with d^a d^b / (a! b!) for every a + b <= order.
+     */
+    void scaledPowers(const vector2& d, double* out) const;
+
+    /**
+     *  Bins bodies into leaves, sorting a copy of the columns by leaf.
+     */
+    void sortBodies(const BodyStore& bodies);
+
+    /**
+     *  Builds multipoles at the leaves and shifts them up to every level.
+     */
+    void upwardPass();
+
+    /**
+     *  Converts multipoles of well-separated cells into local expansions.
+     */
+    void interactionPass();
+
+    /**
+     *  Shifts local expansions down to the leaves.
+     */
+    void downwardPass();
+
+    /**
+     *  Evaluates local expansions and direct near-field sums at the bodies.
+     */
+    void evaluate(Accelerations& acc);
+
+    /**
+     *  Returns the centre of cell (ix, iy) at the given level.
+     */
+    vector2 cellCenter(uint32_t level, uint32_t ix, uint32_t iy) const noexcept;
+
+    /**
+     *  Expansion order.
+     */
+    uint32_t order;
+
+    /**
+     *  Target average number of bodies per leaf.
+     */
+    uint32_t leafSize;
+
+    /**
+     *  Number of coefficients per expansion, (order + 1)(order + 2) / 2.
+     */
+    uint32_t terms;
+
+    /**
+     *  Exponents of x and y for every coefficient index.
+     */
+    std::vector<uint32_t> powerX;
+    std::vector<uint32_t> powerY;
+
+    /**
+     *  Depth of the tree; level 0 is the root, level depth holds the leaves.
+     */
+    uint32_t depth;
+
+    /**
+     *  Lower left corner and side length of the root cell.
+     */
+    vector2 origin;
+    double size;
+
+    /**
+     *  Coefficients of every cell's multipole and local expansion, one block
+     *  of terms per cell, one vector per level. Cells are stored row-major.
+     */
+    std::vector<std::vector<double>> multipoles;
+    std::vector<std::vector<double>> locals;
+
+    /**
+     *  Body columns sorted by leaf, and the original index of each.
+     */
+    std::vector<double> sortedX;
+    std::vector<double> sortedY;
+    std::vector<double> sortedMass;
+    std::vector<uint32_t> sortedIndex;
+
+    /**
+     *  Leaf cell c holds the sorted bodies [leafStart[c], leafStart[c + 1]).
+     */
+    std::vector<uint32_t> leafStart;
+
+    /**
+     *  Scratch space for the counting sort: leaf of every body and the next
+     *  free slot of every leaf.
+     */
+    std::vector<uint32_t> leafOf;
+    std::vector<uint32_t> cursor;
+};
+
+#endif // FMM_ENGINE_H
@@ -0,0 +1,168 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef FORCE_ENGINE_H
+#define FORCE_ENGINE_H
+
+#include "BodyStore.h"
+#include "ThreadPool.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Abstract base class for the Strategy used by the Universe to evaluate
+ *  gravity. An engine reads the current columns of a BodyStore and produces
+ *  the acceleration every body experiences due to all the others.
+ *
+ *  The engine stamps its parameters with a generation that every setter
+ *  renews, so that results cached against it are known to be stale.
+ */
+template <uint32_t D> class BasicForceEngine {
+public:
+    /**
+     *  Per-axis acceleration columns, row i belonging to body i.
+     */
+    typedef std::array<typename BasicBodyStore<D>::Column, D> Accelerations;
+
+    /**
+     *  Gravitational potential column, row i belonging to body i.
+     */
+    typedef typename BasicBodyStore<D>::Column Potentials;
+
+    /**
+     *  Pure virtual destructor. A necessary no-op since this is a base class.
+     */
+    virtual ~BasicForceEngine() = default;
+
+    /**
+     *  Resizes acc to the number of bodies and fills it with the acceleration
+     *  of every body in meters/second^2. Engines may spread the work over the
+     *  workers of pool.
+     */
+    virtual void computeAccelerations(
+        const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool)
+        = 0;
+
+    /**
+     *  Makes every later evaluation of an engine that computesPotentials
+     *  also resize potential to the number of bodies and fill it with the
+     *  potential of every body in J/kg, the sum of -G m / r over the
+     *  others, at little extra cost. Other engines leave it alone. A null
+     *  potential stops filling it.
+     */
+    void setPotentials(Potentials* potential) noexcept;
+
+    /**
+     *  Returns true if the engine fills the potentials it is given. The
+     *  default is false.
+     */
+    virtual bool computesPotentials() const noexcept;
+
+    /**
+     *  Returns true if the potentials given hold those of state as computed
+     *  by the last evaluation with the current parameters.
+     */
+    bool hasPotentials(const BasicBodyStore<D>& state) const noexcept;
+
+    /**
+     *  Returns the generation of the parameters, renewed by every setter.
+     */
+    virtual uint64_t getGeneration() const noexcept;
+
+protected:
+    /**
+     *  Renews the generation after a parameter changed.
+     */
+    void touch() noexcept;
+
+    /**
+     *  Resizes the potentials to the number of bodies and returns them to be
+     *  filled for bodies, or returns null if there are none to fill.
+     */
+    double* preparePotentials(const BasicBodyStore<D>& bodies);
+
+    /**
+     *  Column to fill with the potentials, or null.
+     */
+    Potentials* potential = nullptr;
+
+private:
+    uint64_t generation = nextGeneration();
+
+    /**
+     *  Generations of the state and of the engine the potentials were last
+     *  prepared for.
+     */
+    uint64_t potentialState = 0;
+    uint64_t potentialEngine = 0;
+};
+
+/**
+ *  Exact O(N^2) direct summation over every ordered pair of bodies. The outer
+ *  loop over bodies is split across the pool, each worker writing only the
+ *  rows it owns.
+ */
+template <uint32_t D> class BasicDirectEngine : public BasicForceEngine<D> {
+public:
+    typedef typename BasicForceEngine<D>::Accelerations Accelerations;
+
+    /**
+     *  Sums the contribution of every other body for each body.
+     */
+    virtual void computeAccelerations(
+        const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Returns true: the potentials are summed over the same pairs.
+     */
+    virtual bool computesPotentials() const noexcept;
+};
+
+/**
+ *  Exact direct summation that visits every unordered pair once and applies
+ *  Newton's third law, adding the pair's contribution to both bodies. This
+ *  halves the number of force evaluations of DirectEngine.
+ *
+ *  On a pool with several workers each worker takes every size()-th row, which
+ *  balances the triangular pair loop, and accumulates into a private set of
+ *  columns; the private columns are summed once all pairs are done. Results
+ *  differ from DirectEngine only by floating point summation order.
+ */
+template <uint32_t D> class BasicSymmetricEngine : public BasicForceEngine<D> {
+public:
+    typedef typename BasicForceEngine<D>::Accelerations Accelerations;
+
+    /**
+     *  Sums every unordered pair once.
+     */
+    virtual void computeAccelerations(
+        const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Returns true: the potentials are summed over the same pairs.
+     */
+    virtual bool computesPotentials() const noexcept;
+
+private:
+    /**
+     *  Per-worker partial acceleration columns, one block of rows per worker,
+     *  and potential columns laid out the same way.
+     */
+    std::array<std::vector<double>, D> partial;
+    std::vector<double> partialPotential;
+};
+
+extern template class BasicForceEngine<2>;
+extern template class BasicForceEngine<3>;
+extern template class BasicDirectEngine<2>;
+extern template class BasicDirectEngine<3>;
+extern template class BasicSymmetricEngine<2>;
+extern template class BasicSymmetricEngine<3>;
+
+typedef BasicForceEngine<2> ForceEngine;
+typedef BasicDirectEngine<2> DirectEngine;
+typedef BasicSymmetricEngine<2> SymmetricEngine;
+typedef BasicForceEngine<3> ForceEngine3;
+typedef BasicDirectEngine<3> DirectEngine3;
+typedef BasicSymmetricEngine<3> SymmetricEngine3;
+
+#endif // FORCE_ENGINE_H
@@ -0,0 +1,198 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "BodyStore.h"
+#include "ForceEngine.h"
+#include "ThreadPool.h"
+#include <cstdint>
+
+/**
+ *  Abstract base class for the Strategy used by the Universe to move bodies
+ *  forward in time. An integrator asks a ForceEngine for accelerations as
+ *  often as its scheme needs and updates the position and velocity columns.
+ *  The first row is the fixed sun and is never moved.
+ *
+ *  The accelerations of the last evaluation are kept together with the
+ *  positions and masses they were computed from. A scheme that needs the
+ *  accelerations at the start of a step reuses them if the state has not
+ *  changed since, so kick-drift-kick schemes cost one evaluation per drift.
+ */
+template <uint32_t D> class BasicIntegrator {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+
+    /**
+     *  Pure virtual destructor. A necessary no-op since this is a base class.
+     */
+    virtual ~BasicIntegrator() = default;
+
+    /**
+     *  Advances every body of state except the first by timeSec seconds.
+     */
+    virtual void step(BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool) = 0;
+
+    /**
+     *  Returns the number of times the acceleration of a single body has been
+     *  evaluated so far. A full evaluation of N bodies counts N.
+     */
+    uint64_t getEvaluations() const noexcept;
+
+    /**
+     *  Returns the accelerations at state. The ones a step ended with are
+     *  returned as they are, and any evaluation made here is reused by the
+     *  next step that starts from state, so asking after every step costs
+     *  no extra evaluation.
+     */
+    virtual const typename ForceEngine::Accelerations& getAccelerations(
+        const BodyStore& state, ForceEngine& engine, ThreadPool& pool);
+
+    /**
+     *  Takes acc as the accelerations engine evaluates at state, so that a
+     *  step restarted from a state whose accelerations the caller kept does
+     *  not evaluate them again.
+     */
+    void seedAccelerations(const BodyStore& state, const ForceEngine& engine,
+        const typename ForceEngine::Accelerations& acc);
+
+protected:
+    /**
+     *  Returns the accelerations at the current state, evaluating them only if
+     *  the generation of the positions and masses or of the engine differs
+     *  from the last evaluation.
+     */
+    const typename ForceEngine::Accelerations& accelerate(
+        const BodyStore& state, ForceEngine& engine, ThreadPool& pool);
+
+    /**
+     *  Adds h times the velocity to the position of every movable body.
+     */
+    static void drift(BodyStore& state, double h, ThreadPool& pool);
+
+    /**
+     *  Adds h times the last accelerations to the velocity of every movable
+     *  body.
+     */
+    void kick(BodyStore& state, double h, ThreadPool& pool);
+
+    /**
+     *  Performs one kick-drift-kick leapfrog step of h seconds.
+     */
+    void kickDriftKick(BodyStore& state, double h, ForceEngine& engine, ThreadPool& pool);
+
+    /**
+     *  Number of single-body acceleration evaluations so far.
+     */
+    uint64_t evaluations = 0;
+
+private:
+    /**
+     *  Accelerations of the last evaluation.
+     */
+    typename ForceEngine::Accelerations acceleration;
+
+    /**
+     *  Generations of the state and of the engine the last accelerations
+     *  were evaluated with; zero before the first evaluation.
+     */
+    uint64_t evaluatedState = 0;
+    uint64_t evaluatedEngine = 0;
+};
+
+/**
+ *  First order explicit Euler: the position moves with the velocity at the
+ *  start of the step, then the velocity with the acceleration at the start.
+ *  Not symplectic, so orbits spiral outwards; kept as the default because it
+ *  is what the assignment specifies.
+ */
+template <uint32_t D> class BasicEulerIntegrator : public BasicIntegrator<D> {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+
+    /**
+     *  Moves the positions, then the velocities, with the rates at the start.
+     */
+    virtual void step(BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool);
+};
+
+/**
+ *  Second order kick-drift-kick leapfrog: half a kick, a full drift and half
+ *  a kick with the accelerations at the new positions. Symplectic and time
+ *  reversible, so the energy error stays bounded instead of growing.
+ */
+template <uint32_t D> class BasicLeapfrogIntegrator : public BasicIntegrator<D> {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+
+    /**
+     *  Performs one kick-drift-kick step.
+     */
+    virtual void step(BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool);
+};
+
+/**
+ *  Second order velocity Verlet: the position moves with the velocity and
+ *  half the acceleration at the start, then the velocity with the mean of the
+ *  accelerations at both ends. Algebraically the same map as
+ *  LeapfrogIntegrator; only the rounding differs.
+ */
+template <uint32_t D> class BasicVerletIntegrator : public BasicIntegrator<D> {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+
+    /**
+     *  Performs one velocity Verlet step.
+     */
+    virtual void step(BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool);
+
+private:
+    /**
+     *  Accelerations at the start of the step.
+     */
+    typename ForceEngine::Accelerations start;
+};
+
+/**
+ *  Fourth order symplectic integrator of Forest-Ruth and Yoshida: three
+ *  leapfrog steps of w1, w0 and w1 times the step, with w1 = 1 / (2 - 2^1/3)
+ *  and w0 = 1 - 2 w1. The negative middle step cancels the third order error
+ *  of the outer two.
+ */
+template <uint32_t D> class BasicYoshidaIntegrator : public BasicIntegrator<D> {
+public:
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+
+    /**
+     *  Performs the three leapfrog sub-steps.
+     */
+    virtual void step(BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool);
+};
+
+extern template class BasicIntegrator<2>;
+extern template class BasicIntegrator<3>;
+extern template class BasicEulerIntegrator<2>;
+extern template class BasicEulerIntegrator<3>;
+extern template class BasicLeapfrogIntegrator<2>;
+extern template class BasicLeapfrogIntegrator<3>;
+extern template class BasicVerletIntegrator<2>;
+extern template class BasicVerletIntegrator<3>;
+extern template class BasicYoshidaIntegrator<2>;
+extern template class BasicYoshidaIntegrator<3>;
+
+typedef BasicIntegrator<2> Integrator;
+typedef BasicEulerIntegrator<2> EulerIntegrator;
+typedef BasicLeapfrogIntegrator<2> LeapfrogIntegrator;
+typedef BasicVerletIntegrator<2> VerletIntegrator;
+typedef BasicYoshidaIntegrator<2> YoshidaIntegrator;
+typedef BasicIntegrator<3> Integrator3;
+typedef BasicEulerIntegrator<3> EulerIntegrator3;
+typedef BasicLeapfrogIntegrator<3> LeapfrogIntegrator3;
+typedef BasicVerletIntegrator<3> VerletIntegrator3;
+typedef BasicYoshidaIntegrator<3> YoshidaIntegrator3;
+
+#endif // INTEGRATOR_H
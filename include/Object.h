@@ -3,33 +3,42 @@
 #define OBJECT_H
 
 #include "Vector.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 // Forward declaration.
-class Visitor;
-class ObjectFactory;
+template <uint32_t D> class BasicVisitor;
+template <uint32_t D> class BasicObjectFactory;
+template <uint32_t D> class BasicBodyStore;
+template <uint32_t D> class BasicUniverse;
 
 /**
  *  Representation of objects suitable for use in the simulation. For this
  *  assignment, this will be the only allowable type.
+ *
+ *  Once registered with the Universe an Object is a thin view over one row of
+ *  the Universe's BodyStore; all reads and writes go straight to the columns.
+ *  Objects that are not registered (e.g. the copies returned by clone()) own
+ *  their state. D is the number of spatial dimensions.
  */
-class Object {
+template <uint32_t D> class BasicObject {
 public:
     /**
      *  Destroys this object.
      */
-    virtual ~Object() = default;
+    virtual ~BasicObject() = default;
 
     /**
      *  An entry point for a visitor.
      */
-    virtual void accept(Visitor& visitor);
+    virtual void accept(BasicVisitor<D>& visitor);
 
     /**
      *  Implementation of the prototype. Returns a dynamically allocated deep
      *  copy of this object.
      */
-    virtual Object* clone() const;
+    virtual BasicObject* clone() const;
 
     /**
      *  Returns the mass.
@@ -44,47 +53,65 @@ public:
     /**
      *  Returns the position vector.
      */
-    virtual vector2 getPosition() const noexcept;
+    virtual Vector<D> getPosition() const noexcept;
 
     /**
      *  Returns the velocity vector.
      */
-    virtual vector2 getVelocity() const noexcept;
+    virtual Vector<D> getVelocity() const noexcept;
 
     /**
      *  Calculates the force vector between lhs and rhs. The direction of the
      *  result is as experienced by lhs. Negate the result to obtain force
      *  experienced by rhs.
      */
-    virtual vector2 getForce(const Object& rhs) const noexcept;
+    virtual Vector<D> getForce(const BasicObject& rhs) const noexcept;
 
     /**
      *  Sets the position vector.
      */
-    virtual void setPosition(const vector2& pos);
+    virtual void setPosition(const Vector<D>& pos);
 
     /**
      *  Sets the velocity vector.
      */
-    virtual void setVelocity(const vector2& vel);
+    virtual void setVelocity(const Vector<D>& vel);
 
     /**
      *  Returns true if this object is member-wise equal to rhs.
      */
-    bool operator==(const Object& rhs) const;
+    bool operator==(const BasicObject& rhs) const;
 
     /**
      *  Returns !(*this == rhs).
      */
-    bool operator!=(const Object& rhs) const;
+    bool operator!=(const BasicObject& rhs) const;
 
 private:
-    friend class ObjectFactory;
+    friend class BasicObjectFactory<D>;
+    friend class BasicUniverse<D>;
     /**
      *  Initializes an object with the provided properties - really only called by
      * the ObjectFactory
      */
-    Object(const std::string& name, double mass, const vector2& pos, const vector2& vel);
+    BasicObject(
+        const std::string& name, double mass, const Vector<D>& pos, const Vector<D>& vel);
+
+    /**
+     *  Turns this object into a view over the given row of store. The state
+     *  held by the object itself is ignored from then on.
+     */
+    void bind(BasicBodyStore<D>* store, size_t row) noexcept;
+
+    /**
+     *  Store this object is a view into, or nullptr if it owns its state.
+     */
+    BasicBodyStore<D>* store;
+
+    /**
+     *  Row of store described by this object.
+     */
+    size_t row;
 
     /**
      *  Name of the object.
@@ -99,12 +126,18 @@ private:
     /**
      *  Position vector of the object in meters.
      */
-    vector2 position;
+    Vector<D> position;
 
     /**
      *  Velocity vector of the object in meters/second.
      */
-    vector2 velocity;
+    Vector<D> velocity;
 };
 
+extern template class BasicObject<2>;
+extern template class BasicObject<3>;
+
+typedef BasicObject<2> Object;
+typedef BasicObject<3> Object3;
+
 #endif // OBJECT_H
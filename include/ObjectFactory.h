@@ -3,27 +3,35 @@
 #define OBJECT_FACTORY_H
 
 #include "Vector.h"
+#include <cstdint>
+#include <string>
 
 // Forward declaration.
-class Object;
+template <uint32_t D> class BasicObject;
 
 /**
  *  A factory class used to make Object creation easier.
  */
-class ObjectFactory {
+template <uint32_t D> class BasicObjectFactory {
 public:
     /*
      * Deny access to the default constructor - must be used as static factory
      */
-    ObjectFactory() = delete;
+    BasicObjectFactory() = delete;
 
     /**
      *  Creates an object with the provided parameters. Default values of zero
      *  will be assigned to everything except for name.  Also adds the object to
-     * the singleton Universe
+     * the singleton Universe of the same dimension
      */
-    static Object* makeObject(std::string name, double mass = 0, const vector2& pos = vector2(),
-        const vector2& vel = vector2());
+    static BasicObject<D>* makeObject(std::string name, double mass = 0,
+        const Vector<D>& pos = Vector<D>(), const Vector<D>& vel = Vector<D>());
 };
 
+extern template class BasicObjectFactory<2>;
+extern template class BasicObjectFactory<3>;
+
+typedef BasicObjectFactory<2> ObjectFactory;
+typedef BasicObjectFactory<3> ObjectFactory3;
+
 #endif // OBJECT_FACTORY_H
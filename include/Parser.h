@@ -2,11 +2,14 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <cstdint>
+
 /**
  *  Class responsible for loading in custom setup scripts and configuring the
- *  Universe appropriately.
+ *  Universe appropriately. Positions and velocities are read with D
+ *  components each, so scripts for the 3D Universe list [x y z].
  */
-class Parser {
+template <uint32_t D> class BasicParser {
 public:
     /**
      *  Loads the script file and configures the Universe. Consult the
@@ -20,7 +23,17 @@ private:
         return "{}[], ";
     }
 
+    /**
+     *  Returns the next token of the line being parsed as a double, or zero if
+     *  the line has no more tokens.
+     */
     double getDouble();
 };
 
+extern template class BasicParser<2>;
+extern template class BasicParser<3>;
+
+typedef BasicParser<2> Parser;
+typedef BasicParser<3> Parser3;
+
 #endif // PARSER_H
@@ -0,0 +1,187 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ *  Hardware and kernel counters of the calling thread, opened through
+ *  Linux perf_event_open and counting user space only. Counters the kernel
+ *  or the machine does not provide, as in most containers and virtual
+ *  machines, are left unavailable and read as zero; nothing throws.
+ *
+ *  Only the thread that created the counters is counted. Work handed to
+ *  the other workers of a ThreadPool is not, so a pool of one thread shows
+ *  the whole of a step. The exception are the heap allocations and their
+ *  bytes, which are counted on every thread by the tracking of Allocations
+ *  while the counters exist, and are available wherever the counting
+ *  operator new and delete are linked in.
+ */
+class PerfCounters {
+public:
+    enum Counter : uint32_t {
+        Cycles,
+        Instructions,
+        L1dMisses,
+        LlcMisses,
+        BranchMisses,
+        // Nanoseconds the thread ran, a software counter nearly always there.
+        TaskClock,
+        Allocations,
+        AllocatedBytes,
+    };
+    static constexpr uint32_t COUNTERS = AllocatedBytes + 1;
+    // The counters opened through perf_event_open come first.
+    static constexpr uint32_t PERF_COUNTERS = TaskClock + 1;
+    typedef std::array<uint64_t, COUNTERS> Values;
+
+    /**
+     *  Opens and starts every counter available to the calling thread and
+     *  enables tracking the allocations.
+     */
+    PerfCounters();
+
+    /**
+     *  Closes every counter and disables tracking the allocations.
+     */
+    ~PerfCounters();
+
+    /**
+     *  Deny copying - each counter is owned once.
+     */
+    PerfCounters(const PerfCounters& rhs) = delete;
+    PerfCounters& operator=(const PerfCounters& rhs) = delete;
+
+    /**
+     *  Returns true if counter, or any counter of perf_event_open at all,
+     *  could be opened.
+     */
+    bool isAvailable(Counter counter) const noexcept;
+    bool isAvailable() const noexcept;
+
+    /**
+     *  Returns why the first unavailable counter could not be opened, or an
+     *  empty string if all of them are available.
+     */
+    const std::string& getError() const noexcept;
+
+    /**
+     *  Returns the count of every counter so far, scaled up for the time it
+     *  was not scheduled on the hardware. Unavailable counters read zero.
+     */
+    Values read() const noexcept;
+
+    /**
+     *  Returns the name of counter.
+     */
+    static const char* name(Counter counter) noexcept;
+
+private:
+    /**
+     *  File descriptor of each perf counter, or -1.
+     */
+    std::array<int, PERF_COUNTERS> fds;
+
+    std::string error;
+};
+
+/**
+ *  Counts of the phases of the simulation, in the last step and summed
+ *  since the statistics were reset, and ratios of them. Ratios involving
+ *  an unavailable counter, or dividing by zero, are NaN.
+ */
+class PerfStats {
+public:
+    typedef PerfCounters::Counter Counter;
+    typedef PerfCounters::Values Values;
+
+    enum Phase : uint32_t {
+        // The whole of a step, including the phases below.
+        Step,
+        // Every evaluation of the force engine.
+        Force,
+        // Recording the trajectory and sampling the dense output.
+        Output,
+    };
+    static constexpr uint32_t PHASES = Output + 1;
+
+    /**
+     *  Counts of one phase.
+     */
+    struct Counts {
+        uint64_t calls = 0;
+        // Pairs of bodies a direct sum over the bodies of each call visits.
+        uint64_t interactions = 0;
+        Values values {};
+    };
+
+    /**
+     *  Creates empty statistics of the counters available in counters.
+     */
+    explicit PerfStats(const PerfCounters& counters);
+
+    /**
+     *  Returns true if counter is counted.
+     */
+    bool isAvailable(Counter counter) const noexcept;
+
+    /**
+     *  Returns why the counters that are not counted are unavailable.
+     */
+    const std::string& getError() const noexcept;
+
+    /**
+     *  Returns the number of steps counted.
+     */
+    uint64_t getSteps() const noexcept;
+
+    /**
+     *  Returns the counts of phase in the last step, or summed over every
+     *  step if cumulative.
+     */
+    const Counts& getCounts(Phase phase, bool cumulative = false) const noexcept;
+
+    /**
+     *  Returns numerator per denominator over phase.
+     */
+    double getRatio(Counter numerator, Counter denominator, Phase phase,
+        bool cumulative = false) const noexcept;
+
+    /**
+     *  Returns the instructions per cycle of phase.
+     */
+    double getIpc(Phase phase, bool cumulative = false) const noexcept;
+
+    /**
+     *  Returns counter over phase per interaction the force engine
+     *  evaluated in the same step or steps.
+     */
+    double getPerInteraction(
+        Counter counter, Phase phase = Force, bool cumulative = false) const noexcept;
+
+    /**
+     *  Starts a step, forgetting the counts of the last one.
+     */
+    void beginStep() noexcept;
+
+    /**
+     *  Adds a call of phase that counted delta over interactions pairs.
+     */
+    void add(Phase phase, const Values& delta, uint64_t interactions) noexcept;
+
+    /**
+     *  Forgets every count.
+     */
+    void reset() noexcept;
+
+private:
+    std::array<bool, PerfCounters::COUNTERS> available;
+    std::string error;
+    uint64_t steps = 0;
+    std::array<Counts, PHASES> last;
+    std::array<Counts, PHASES> total;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,120 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef PM_ENGINE_H
+#define PM_ENGINE_H
+
+#include "ForceEngine.h"
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Particle-mesh force engine. Masses are assigned to a square grid spanning
+ *  the bodies, the grid is convolved with the acceleration of a unit point
+ *  mass using FFTs, and the resulting field is interpolated back to every
+ *  body with the same assignment scheme. Runs in O(N + M log M) for a grid of
+ *  M cells, independent of how the bodies are arranged.
+ *
+ *  The force law is the inverse-square law in the plane, whose Green's
+ *  function is not that of the 2D Poisson equation, so the convolution uses
+ *  the exact 1 / r^2 kernel sampled at cell offsets. The grid is zero padded
+ *  to twice its size (Hockney's method), so no periodic images are felt.
+ *  Forces are smoothed below a few cells: accurate for dense, smooth
+ *  distributions, not for close encounters.
+ */
+class PmEngine : public ForceEngine {
+public:
+    /**
+     *  Mass assignment and interpolation schemes: nearest grid point,
+     *  cloud-in-cell and triangular-shaped cloud, spreading each body over
+     *  1, 2 and 3 cells per axis.
+     */
+    enum class Assignment { Ngp, Cic, Tsc };
+
+    /**
+     *  Creates an engine with a grid of gridSize by gridSize cells, rounded up
+     *  to a power of two.
+     */
+    explicit PmEngine(uint32_t gridSize = 256, Assignment assignment = Assignment::Cic);
+
+    /**
+     *  Assigns the masses, convolves and interpolates the field.
+     */
+    virtual void computeAccelerations(
+        const BodyStore& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Returns the number of cells along each axis.
+     */
+    uint32_t getGridSize() const noexcept;
+
+    /**
+     *  Sets the number of cells along each axis, rounded up to a power of two
+     *  no smaller than 8.
+     */
+    void setGridSize(uint32_t gridSize);
+
+    /**
+     *  Returns the assignment scheme.
+     */
+    Assignment getAssignment() const noexcept;
+
+    /**
+     *  Sets the assignment scheme.
+     */
+    void setAssignment(Assignment assignment) noexcept;
+
+private:
+    typedef std::complex<double> Complex;
+
+    /**
+     *  Samples the acceleration of a unit mass one cell wide on the padded
+     *  grid, x in the real and y in the imaginary part, and transforms it.
+     */
+    void buildKernel(ThreadPool& pool);
+
+    /**
+     *  Transforms the first rows rows of the padded grid, then every column.
+     *  The inverse transforms the columns first and is not normalized.
+     */
+    void transform(std::vector<Complex>& data, uint32_t rows, bool inverse, ThreadPool& pool);
+
+    /**
+     *  Transforms one contiguous line of the padded grid in place.
+     */
+    void transformLine(Complex* line, bool inverse) const;
+
+    /**
+     *  Number of cells along each axis of the unpadded grid.
+     */
+    uint32_t gridSize;
+
+    /**
+     *  Mass assignment and interpolation scheme.
+     */
+    Assignment assignment;
+
+    /**
+     *  Padded grid holding the masses, then the accelerations.
+     */
+    std::vector<Complex> grid;
+
+    /**
+     *  Transformed kernel for a cell size of one, built for kernelSize.
+     */
+    std::vector<Complex> kernel;
+    uint32_t kernelSize = 0;
+
+    /**
+     *  Twiddle factors and bit reversal permutation of a padded line.
+     */
+    std::vector<Complex> twiddle;
+    std::vector<uint32_t> reversal;
+
+    /**
+     *  Per-worker mass grids and column buffers.
+     */
+    std::vector<double> partialMass;
+    std::vector<Complex> columns;
+};
+
+#endif // PM_ENGINE_H
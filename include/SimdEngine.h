@@ -0,0 +1,147 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef SIMD_ENGINE_H
+#define SIMD_ENGINE_H
+
+#include "ForceEngine.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ *  Vectorized direct summation. Positions and G * mass are packed into
+ *  contiguous arrays padded to a multiple of eight bodies, and the pair loop
+ *  is tiled so that each block of sources stays in L1 while every target row
+ *  streams over it, evaluating 2 (SSE2), 4 (AVX2) or 8 (AVX-512) interactions
+ *  per instruction. The widest instruction set the CPU supports is picked at
+ *  run time through CPUID; binaries built for baseline x86-64 still use it.
+ *
+ *  Results agree with DirectEngine to within 1e-12 of the RMS acceleration:
+ *  the lanes only change the order of summation and the use of fused
+ *  multiply-add. The outer loop over targets is split across the pool.
+ *
+ *  In mixed precision the sources are sorted along a Morton curve, so each
+ *  tile holds nearby bodies, and stored as float offsets from the centroid
+ *  of their tile. Each target is expressed relative to the same centroid,
+ *  so close pairs keep their separation to float precision however far they
+ *  are from the origin. Pairs then run at float width, 4, 8 or 16 per
+ *  instruction, on half the bytes; every tile is summed in float and the
+ *  tiles in double. The error of each pair is float rounding relative to
+ *  the size of its tile, about 1e-5 of the RMS acceleration on a uniform
+ *  cluster and far less for a few well separated bodies.
+ *
+ *  Potentials, when asked for, are summed in the same lanes at one more
+ *  operation a pair; each kernel is also built without them, so that
+ *  evaluations without potentials pay nothing.
+ */
+template <uint32_t D> class BasicSimdEngine : public BasicForceEngine<D> {
+public:
+    typedef typename BasicForceEngine<D>::Accelerations Accelerations;
+
+    /**
+     *  Instruction sets the kernel can be compiled for, narrowest first.
+     */
+    enum class Level { Scalar, Sse2, Avx2, Avx512 };
+
+    /**
+     *  Floating point formats the pairs can be evaluated in.
+     */
+    enum class Precision { Double, Mixed };
+
+    /**
+     *  Creates an engine using the widest level supported by this CPU.
+     */
+    explicit BasicSimdEngine(Precision precision = Precision::Double);
+
+    /**
+     *  Evaluates every pair with the selected kernel.
+     */
+    virtual void computeAccelerations(
+        const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Returns true: the potentials are summed over the same pairs.
+     */
+    virtual bool computesPotentials() const noexcept;
+
+    /**
+     *  Returns the kernel in use.
+     */
+    Level getLevel() const noexcept;
+
+    /**
+     *  Selects a kernel, falling back to the widest supported level not wider
+     *  than the requested one. Returns the level actually selected.
+     */
+    Level setLevel(Level level) noexcept;
+
+    /**
+     *  Returns true if this CPU and OS can run the given level.
+     */
+    static bool isSupported(Level level) noexcept;
+
+    /**
+     *  Returns the widest level this CPU and OS can run.
+     */
+    static Level detect() noexcept;
+
+    /**
+     *  Returns a printable name of level.
+     */
+    static const char* name(Level level) noexcept;
+
+    /**
+     *  Returns the format the pairs are evaluated in.
+     */
+    Precision getPrecision() const noexcept;
+
+    /**
+     *  Selects the format the pairs are evaluated in.
+     */
+    void setPrecision(Precision precision) noexcept;
+
+private:
+    /**
+     *  Evaluates every pair at float width on tile-relative offsets.
+     */
+    void computeMixed(const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool);
+
+    /**
+     *  Kernel in use.
+     */
+    Level level;
+
+    /**
+     *  Format the pairs are evaluated in.
+     */
+    Precision precision;
+
+    /**
+     *  Packed positions and G * mass, padded with massless bodies.
+     */
+    std::array<std::vector<double>, D> packed;
+    std::vector<double> packedMass;
+
+    /**
+     *  Morton key and row of every body, sorted along the curve.
+     */
+    std::vector<std::pair<uint64_t, uint32_t>> keys;
+
+    /**
+     *  Mixed precision sources: scaled offsets from their tile's centroid and
+     *  scaled G * mass, in Morton order and padded with massless bodies,
+     *  followed by the centroid of every tile.
+     */
+    std::array<std::vector<float>, D> offsets;
+    std::vector<float> scaledMass;
+    std::array<std::vector<double>, D> centroids;
+};
+
+extern template class BasicSimdEngine<2>;
+extern template class BasicSimdEngine<3>;
+
+typedef BasicSimdEngine<2> SimdEngine;
+typedef BasicSimdEngine<3> SimdEngine3;
+
+#endif // SIMD_ENGINE_H
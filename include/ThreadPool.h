@@ -0,0 +1,159 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  A fixed set of worker threads that live as long as the pool and are handed
+ *  one job at a time. The calling thread always takes part as worker 0, so a
+ *  pool of size 1 owns no threads and runs every job inline. Dispatching a job
+ *  does not allocate.
+ */
+class ThreadPool {
+public:
+    /**
+     *  Creates a pool of the given size. Zero selects one worker per hardware
+     *  thread.
+     */
+    explicit ThreadPool(uint32_t count = 1);
+
+    /**
+     *  Stops and joins every worker.
+     */
+    ~ThreadPool();
+
+    /**
+     *  Deny copying - the workers hold a pointer to this pool.
+     */
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+    /**
+     *  Returns the number of workers, counting the calling thread.
+     */
+    uint32_t size() const noexcept;
+
+    /**
+     *  Restarts the pool with the given number of workers. Zero selects one
+     *  worker per hardware thread.
+     */
+    void resize(uint32_t count);
+
+    /**
+     *  Calls task(worker) once on each of the first `workers` workers and
+     *  returns when all of them are done.
+     */
+    template <typename Task> void run(uint32_t workers, const Task& task);
+
+    /**
+     *  Splits [0, count) into contiguous ranges of at least minChunk indices,
+     *  at most one per worker, and calls body(begin, end, worker) on each.
+     */
+    template <typename Body> void parallelFor(size_t count, size_t minChunk, const Body& body);
+
+private:
+    /**
+     *  Type-erased entry point of the current job.
+     */
+    typedef void (*Invoker)(const void* task, uint32_t worker);
+
+    /**
+     *  Publishes a job to the workers, runs worker 0 inline and waits.
+     */
+    void dispatch(uint32_t workers, Invoker invoker, const void* task);
+
+    /**
+     *  Body of background worker index. Jobs up to generation seen were
+     *  published before the worker existed.
+     */
+    void workerLoop(uint32_t index, uint64_t seen);
+
+    /**
+     *  Stops and joins every worker.
+     */
+    void stop();
+
+    /**
+     *  Background workers 1 .. size() - 1.
+     */
+    std::vector<std::thread> threads;
+
+    /**
+     *  Guards every field below.
+     */
+    std::mutex mutex;
+
+    /**
+     *  Signalled when a job is published or the pool stops.
+     */
+    std::condition_variable wake;
+
+    /**
+     *  Signalled when the last background worker finishes a job.
+     */
+    std::condition_variable finished;
+
+    /**
+     *  The current job and the number of workers taking part in it.
+     */
+    Invoker invoker = nullptr;
+    const void* task = nullptr;
+    uint32_t active = 0;
+
+    /**
+     *  Incremented for every job so that workers can tell a new one apart.
+     */
+    uint64_t generation = 0;
+
+    /**
+     *  Background workers still running the current job.
+     */
+    uint32_t remaining = 0;
+
+    /**
+     *  Set when the workers should exit.
+     */
+    bool stopping = false;
+};
+
+/**
+ *  Calls task(worker) once on each of the first `workers` workers and
+ *  returns when all of them are done.
+ */
+template <typename Task> void ThreadPool::run(uint32_t workers, const Task& task)
+{
+    workers = std::min(workers, size());
+    if (workers <= 1) {
+        task(0);
+        return;
+    }
+    dispatch(
+        workers,
+        [](const void* erased, uint32_t worker) { (*static_cast<const Task*>(erased))(worker); },
+        &task);
+}
+
+/**
+ *  Splits [0, count) into contiguous ranges of at least minChunk indices,
+ *  at most one per worker, and calls body(begin, end, worker) on each.
+ */
+template <typename Body>
+void ThreadPool::parallelFor(size_t count, size_t minChunk, const Body& body)
+{
+    if (count == 0)
+        return;
+    size_t chunks = std::max<size_t>(1, count / std::max<size_t>(minChunk, 1));
+    uint32_t workers = static_cast<uint32_t>(std::min<size_t>(size(), chunks));
+    run(workers, [&](uint32_t worker) {
+        body(count * worker / workers, count * (worker + 1) / workers, worker);
+    });
+}
+
+#endif // THREAD_POOL_H
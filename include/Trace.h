@@ -0,0 +1,119 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ *  Process-wide recorder of the phases the simulation spends its time in.
+ *  Every thread appends the phases it completes to a buffer of its own, so
+ *  recording takes no lock, and the buffers are exported together as
+ *  Chrome trace-event JSON, which chrome://tracing and Perfetto open.
+ *
+ *  Phases are marked with TRACE_SCOPE. While tracing is disabled a scope
+ *  only loads the flag on entry and tests its own name on exit, both
+ *  branches predicted not taken.
+ *
+ *  clear and writeChromeJson read every buffer and must not run while
+ *  another thread is inside a scope; between steps the workers are idle.
+ */
+class Trace {
+public:
+    /**
+     *  Starts and stops recording. Events recorded so far are kept.
+     */
+    static void enable() noexcept;
+    static void disable() noexcept;
+
+    /**
+     *  Returns true while recording.
+     */
+    static bool isEnabled() noexcept;
+
+    /**
+     *  Drops every recorded event, keeping the buffers' capacity.
+     */
+    static void clear();
+
+    /**
+     *  Returns the number of events recorded on every thread.
+     */
+    static size_t getEventCount();
+
+    /**
+     *  Writes every recorded event as a complete ("X") event of the Chrome
+     *  trace-event format, one track per thread. Throws std::runtime_error
+     *  if the file cannot be written.
+     */
+    static void writeChromeJson(std::ostream& out);
+    static void writeChromeJson(const std::string& path);
+
+    /**
+     *  Returns the nanoseconds elapsed since the process started tracing
+     *  time.
+     */
+    static uint64_t now() noexcept;
+
+    /**
+     *  Appends a phase called name, which must outlive the trace, that ran
+     *  from begin to end on the calling thread. Drops it if memory runs out.
+     */
+    static void record(const char* name, uint64_t begin, uint64_t end) noexcept;
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/**
+ *  Returns true while recording.
+ */
+inline bool Trace::isEnabled() noexcept
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ *  Records the lifetime of the scope it is declared in while tracing is
+ *  enabled at its start.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) noexcept
+    {
+        if (Trace::isEnabled()) {
+            this->name = name;
+            begin = Trace::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (name != nullptr)
+            Trace::record(name, begin, Trace::now());
+    }
+
+    /**
+     *  Deny copying - a scope is recorded once.
+     */
+    TraceScope(const TraceScope& rhs) = delete;
+    TraceScope& operator=(const TraceScope& rhs) = delete;
+
+private:
+    const char* name = nullptr;
+    uint64_t begin = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/**
+ *  Traces the rest of the enclosing scope as a phase called name, a string
+ *  literal.
+ */
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif // TRACE_H
@@ -0,0 +1,467 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "BodyStore.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *  The state of a subset of the bodies at one step. Row i of every column
+ *  describes body rows[i] of the recorded BodyStore.
+ */
+template <uint32_t D> struct BasicTrajectoryFrame {
+    uint64_t step = 0;
+    double time = 0.0;
+    std::array<std::vector<double>, D> position;
+    std::array<std::vector<double>, D> velocity;
+};
+
+/**
+ *  Entry of the index at the end of a trajectory file: the step, time and
+ *  byte offset of a keyframe.
+ */
+struct TrajectoryKeyframe {
+    uint64_t step;
+    double time;
+    uint64_t offset;
+};
+
+/**
+ *  Lossy codec of trajectory frames for smooth orbits. Every value is
+ *  rounded to a multiple of twice its column's error bound, so it is
+ *  reconstructed within the bound. Each body's next velocity quantum is
+ *  predicted from its previous two by a second difference, which is exact
+ *  under constant jerk, and then its position by the trapezoid rule over
+ *  the previous and new velocities, whose error grows with the jerk and the
+ *  cube of the time between frames instead of the acceleration and its
+ *  square. The residuals are Rice coded with one parameter per column and
+ *  frame chosen from their mean.
+ *
+ *  Frames must be decoded in the order they were encoded, starting from the
+ *  first or from the last reset. Encoder and decoder round identically on
+ *  any IEEE 754 host as long as floating-point contraction stays off, which
+ *  is the default in ISO C++ mode.
+ */
+template <uint32_t D> class BasicTrajectoryCodec {
+public:
+    typedef BasicTrajectoryFrame<D> Frame;
+
+    /**
+     *  Creates a codec of frames of the given number of rows, with the
+     *  given absolute error bounds on positions and velocities. Throws
+     *  std::invalid_argument unless both bounds are positive and finite.
+     */
+    BasicTrajectoryCodec(size_t rows, double positionBound, double velocityBound);
+
+    /**
+     *  Returns the error bound of positions in meters.
+     */
+    double getPositionBound() const noexcept;
+
+    /**
+     *  Returns the error bound of velocities in meters/second.
+     */
+    double getVelocityBound() const noexcept;
+
+    /**
+     *  Replaces bytes with the columns of frame. Throws std::range_error if
+     *  a value is too large, or not finite, to be quantized to its bound.
+     */
+    void encode(const Frame& frame, std::vector<uint8_t>& bytes);
+
+    /**
+     *  Decodes the columns of the next frame from bytes into frame. Throws
+     *  std::runtime_error if bytes are not a valid frame.
+     */
+    void decode(const uint8_t* bytes, size_t count, Frame& frame);
+
+    /**
+     *  Forgets the previous frames, so that the next one is coded on its own.
+     */
+    void reset() noexcept;
+
+private:
+    /**
+     *  Returns the order the columns are coded in: the velocities first, so
+     *  that the positions can be predicted from them.
+     */
+    static std::array<uint32_t, 2 * D> codingOrder() noexcept;
+
+    /**
+     *  Returns the factor that turns the sum of a body's velocity quanta in
+     *  the previous and this frame into its displacement in quanta of the
+     *  given position column, or zero for velocity columns.
+     */
+    double displacementFactor(uint32_t column, double time) const noexcept;
+
+    /**
+     *  Returns the predicted quantum of a row of a column.
+     */
+    int64_t predict(uint32_t column, size_t row, double factor) const noexcept;
+
+    /**
+     *  Size of a quantum of each column: twice its error bound.
+     */
+    std::array<double, 2 * D> quantum;
+
+    /**
+     *  Quanta of the previous two frames, per column, and how many of them
+     *  are known.
+     */
+    std::array<std::vector<int64_t>, 2 * D> last;
+    std::array<std::vector<int64_t>, 2 * D> beforeLast;
+    uint32_t history = 0;
+    double lastTime = 0.0;
+
+    /**
+     *  Residuals of the column being coded.
+     */
+    std::vector<uint64_t> residuals;
+};
+
+/**
+ *  Records the positions and velocities of a subset of the bodies every
+ *  stride steps to a file, without doing I/O or compression on the
+ *  simulation thread.
+ *
+ *  record copies the sampled rows into a preallocated slot of a bounded
+ *  single-producer, single-consumer ring buffer and publishes it with one
+ *  atomic store; a dedicated writer thread drains the slots to disk. When
+ *  the writer falls behind and the ring is full, the policy decides what
+ *  the simulation does:
+ *
+ *      Block       wait for a free slot; the frame is counted as late
+ *      Drop        discard the frame
+ *      Downsample  discard the frame and record only every other sampled
+ *                  step from then on, until the writer has caught up
+ *
+ *  The file starts with the magic "NBODYTRJ", the endianness tag
+ *  0x01020304, the format version, D and the codec as uint32, the number
+ *  of rows N as uint64 and the N recorded rows as uint64. Codec 0 stores
+ *  every frame as its step (uint64), time (double) and the D position and
+ *  D velocity columns of N doubles each. Codec 1, selected by setting an
+ *  error bound, adds the position and velocity bounds as doubles to the
+ *  header and stores every frame as its step, time, the length of its
+ *  BasicTrajectoryCodec encoding in bytes (uint64) and the encoding. The
+ *  header ends with the keyframe interval K as uint64.
+ *
+ *  Every K-th frame, starting with the first, is a keyframe that the codec
+ *  encodes on its own. When the recorder is closed it appends an index of
+ *  the keyframes as TrajectoryKeyframe entries of three 64 bit words each,
+ *  then their number and the offset of the index as uint64, and the magic
+ *  "NBODYIDX", so that a reader can seek without scanning the frames.
+ */
+template <uint32_t D> class BasicTrajectoryRecorder {
+public:
+    typedef BasicTrajectoryFrame<D> Frame;
+
+    /**
+     *  What record does when the ring buffer is full.
+     */
+    enum class Policy { Block, Drop, Downsample };
+
+    /**
+     *  Format version written to the file.
+     */
+    static constexpr uint32_t VERSION = 3;
+
+    /**
+     *  Frames from one keyframe to the next unless set otherwise.
+     */
+    static constexpr uint64_t KEYFRAME_INTERVAL = 128;
+
+    /**
+     *  Creates path and records the given rows, or every body if rows is
+     *  empty, every stride steps through a ring of capacity frames. Throws
+     *  std::invalid_argument if stride or capacity is zero and
+     *  std::runtime_error if path cannot be created.
+     */
+    BasicTrajectoryRecorder(const std::string& path, uint64_t stride = 1,
+        const std::vector<size_t>& rows = std::vector<size_t>(), Policy policy = Policy::Block,
+        size_t capacity = 64);
+
+    /**
+     *  Closes the recorder, ignoring a write error.
+     */
+    ~BasicTrajectoryRecorder();
+
+    /**
+     *  Deny copying - the writer thread holds a pointer to this recorder.
+     */
+    BasicTrajectoryRecorder(const BasicTrajectoryRecorder& rhs) = delete;
+    BasicTrajectoryRecorder& operator=(const BasicTrajectoryRecorder& rhs) = delete;
+
+    /**
+     *  Compresses the frames with a BasicTrajectoryCodec of the given
+     *  error bounds, or stores them exactly if both are zero. Throws
+     *  std::invalid_argument for other bounds the codec rejects, and
+     *  std::logic_error once the first frame has been recorded.
+     */
+    void setErrorBound(double positionBound, double velocityBound);
+
+    /**
+     *  Makes every frames-th frame a keyframe. Shorter intervals make
+     *  seeking decode fewer frames and compressed files larger. Throws
+     *  std::invalid_argument if frames is zero and std::logic_error once
+     *  the first frame has been recorded.
+     */
+    void setKeyframeInterval(uint64_t frames);
+
+    /**
+     *  Offers the state of bodies at the given step. It is recorded if step
+     *  is a multiple of the stride, subject to the policy. Throws
+     *  std::out_of_range if a recorded row does not exist in bodies,
+     *  std::logic_error once closed and std::runtime_error once the writer
+     *  has failed.
+     */
+    void record(const BasicBodyStore<D>& bodies, uint64_t step, double time);
+
+    /**
+     *  Writes every recorded frame, stops the writer and closes the file.
+     *  Throws std::runtime_error if any write failed. Later calls do nothing.
+     */
+    void close();
+
+    /**
+     *  Returns the number of steps between recorded frames.
+     */
+    uint64_t getStride() const noexcept;
+
+    /**
+     *  Returns the recorded rows; empty until the first frame if every body
+     *  is recorded.
+     */
+    const std::vector<size_t>& getRows() const noexcept;
+
+    /**
+     *  Returns the number of frames handed to the writer.
+     */
+    uint64_t getRecorded() const noexcept;
+
+    /**
+     *  Returns the number of sampled frames discarded by the Drop or
+     *  Downsample policy.
+     */
+    uint64_t getDropped() const noexcept;
+
+    /**
+     *  Returns the number of frames the Block policy had to wait for.
+     */
+    uint64_t getLate() const noexcept;
+
+private:
+    /**
+     *  Resolves the rows for bodies, allocates the slots, writes the file
+     *  header and starts the writer.
+     */
+    void start(const BasicBodyStore<D>& bodies);
+
+    /**
+     *  Writes the file header for the recorded rows.
+     */
+    void writeHeader();
+
+    /**
+     *  Body of the writer thread: drains the ring until stopped and empty.
+     */
+    void writerLoop();
+
+    /**
+     *  Appends a frame to the file.
+     */
+    void write(const Frame& frame);
+
+    /**
+     *  Appends the keyframe index to the file.
+     */
+    void writeIndex();
+
+    /**
+     *  Throws the writer's error once it has failed.
+     */
+    void checkWriter() const;
+
+    /**
+     *  Recording parameters. current is the stride in effect, a power of two
+     *  multiple of stride while the Downsample policy is backing off.
+     */
+    std::string path;
+    uint64_t stride;
+    uint64_t current;
+    std::vector<size_t> rows;
+    size_t maxRow = 0;
+    Policy policy;
+
+    /**
+     *  Ring buffer slots, allocated once for the recorded rows.
+     */
+    std::vector<Frame> slots;
+
+    /**
+     *  Number of frames published by record and drained by the writer. Each
+     *  is written by one thread only and kept on its own cache line.
+     */
+    alignas(64) std::atomic<uint64_t> head { 0 };
+    alignas(64) std::atomic<uint64_t> tail { 0 };
+
+    /**
+     *  Set by close to let the writer exit once the ring is empty.
+     */
+    alignas(64) std::atomic<bool> stopping { false };
+
+    /**
+     *  Set by the writer after storing error.
+     */
+    std::atomic<bool> failed { false };
+    std::string error;
+
+    /**
+     *  Codec of the frames and the bounds to create it with, zero if none.
+     *  Only the writer uses the codec.
+     */
+    double positionBound = 0.0;
+    double velocityBound = 0.0;
+    std::unique_ptr<BasicTrajectoryCodec<D>> codec;
+    std::vector<uint8_t> encoded;
+
+    /**
+     *  Keyframe interval, the keyframes written so far, and the number of
+     *  frames and the offset of the end of the file. Once the writer has
+     *  started only it uses them.
+     */
+    uint64_t keyframeInterval = KEYFRAME_INTERVAL;
+    std::vector<TrajectoryKeyframe> keyframes;
+    uint64_t written = 0;
+    uint64_t offset = 0;
+
+    std::ofstream out;
+    std::thread writer;
+    bool started = false;
+    bool closed = false;
+
+    /**
+     *  Counters, only touched by the simulation thread.
+     */
+    uint64_t recorded = 0;
+    uint64_t dropped = 0;
+    uint64_t late = 0;
+};
+
+/**
+ *  Reads back the frames written by a BasicTrajectoryRecorder in order,
+ *  decoding compressed ones a frame at a time, and seeks to any step or
+ *  time by binary search in the keyframe index. A file without an index,
+ *  such as one cut short by a crash, is indexed by skipping over its
+ *  complete frames once when opened.
+ */
+template <uint32_t D> class BasicTrajectoryReader {
+public:
+    typedef BasicTrajectoryFrame<D> Frame;
+
+    /**
+     *  Opens path and reads its header. Throws std::runtime_error if it
+     *  cannot be read, is not a trajectory, or has another version or
+     *  number of dimensions.
+     */
+    explicit BasicTrajectoryReader(const std::string& path);
+
+    /**
+     *  Returns the rows of the recorded BodyStore, in column order.
+     */
+    const std::vector<size_t>& getRows() const noexcept;
+
+    /**
+     *  Reads the next frame into frame and returns true, or returns false at
+     *  the end of the file. Throws std::runtime_error if the frame is cut
+     *  short.
+     */
+    bool next(Frame& frame);
+
+    /**
+     *  Positions the reader on the first frame at or after step, so that
+     *  next returns it, and returns true; or returns false if there is none.
+     *  Only the frames from the closest keyframe before it are decoded.
+     */
+    bool seek(uint64_t step);
+
+    /**
+     *  Positions the reader on the first frame at or after time, as seek.
+     */
+    bool seekTime(double time);
+
+    /**
+     *  Returns the keyframe index.
+     */
+    const std::vector<TrajectoryKeyframe>& getKeyframes() const noexcept;
+
+private:
+    /**
+     *  Reads the index at the end of the file, or builds it by scanning the
+     *  frames if there is none.
+     */
+    void readIndex(uint32_t version);
+
+    /**
+     *  Returns the number of bytes of a frame whose header starts at the
+     *  current offset, leaving the stream after the header, or zero if the
+     *  frame is cut short.
+     */
+    uint64_t frameBytes();
+
+    /**
+     *  Moves to the given keyframe and reads up to the first frame for which
+     *  reached is true, keeping it for next.
+     */
+    template <typename Reached> bool seekFrom(size_t keyframe, const Reached& reached);
+
+    std::string path;
+    std::ifstream in;
+    std::vector<size_t> rows;
+
+    /**
+     *  Codec of compressed files and the encoding of the current frame.
+     */
+    std::unique_ptr<BasicTrajectoryCodec<D>> codec;
+    std::vector<uint8_t> encoded;
+
+    /**
+     *  Keyframe interval and index, the offsets of the first frame and of
+     *  the end of the frames, and the number and offset of the next frame.
+     */
+    uint64_t keyframeInterval = 1;
+    std::vector<TrajectoryKeyframe> keyframes;
+    uint64_t framesStart = 0;
+    uint64_t framesEnd = 0;
+    uint64_t frameIndex = 0;
+    uint64_t offset = 0;
+
+    /**
+     *  Frame found by a seek, returned by the next call to next.
+     */
+    Frame pending;
+    bool hasPending = false;
+};
+
+extern template class BasicTrajectoryCodec<2>;
+extern template class BasicTrajectoryCodec<3>;
+extern template class BasicTrajectoryRecorder<2>;
+extern template class BasicTrajectoryRecorder<3>;
+extern template class BasicTrajectoryReader<2>;
+extern template class BasicTrajectoryReader<3>;
+
+typedef BasicTrajectoryCodec<2> TrajectoryCodec;
+typedef BasicTrajectoryCodec<3> TrajectoryCodec3;
+typedef BasicTrajectoryRecorder<2> TrajectoryRecorder;
+typedef BasicTrajectoryRecorder<3> TrajectoryRecorder3;
+typedef BasicTrajectoryReader<2> TrajectoryReader;
+typedef BasicTrajectoryReader<3> TrajectoryReader3;
+
+#endif // TRAJECTORY_H
@@ -2,35 +2,63 @@
 #ifndef UNIVERSE_H
 #define UNIVERSE_H
 
+#include <BodyStore.h>
+#include <Checkpoint.h>
+#include <DenseOutput.h>
+#include <Diagnostics.h>
+#include <ForceEngine.h>
+#include <Integrator.h>
+#include <PerfCounters.h>
+#include <ThreadPool.h>
+#include <Trajectory.h>
 #include <Vector.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 // Forward declaration
-class Object;
-class ObjectFactory;
+template <uint32_t D> class BasicObject;
+template <uint32_t D> class BasicObjectFactory;
 
 /**
  *  A singleton class representing the Universe. For this assignment, the first
  *  object added to the Universe will be considered unmovable and so its
  *  position should not be changed.
+ *
+ *  Body state lives in a structure-of-arrays BodyStore; the Objects reachable
+ *  through the iterators are views over its rows.
+ *
+ *  D is the number of spatial dimensions; each dimension has its own
+ *  singleton, engines and integrators.
  */
-class Universe {
+template <uint32_t D> class BasicUniverse {
 public:
+    typedef BasicObject<D> Object;
+    typedef BasicBodyStore<D> BodyStore;
+    typedef BasicForceEngine<D> ForceEngine;
+    typedef BasicIntegrator<D> Integrator;
+    typedef BasicTrajectoryRecorder<D> Recorder;
+    typedef BasicDenseOutput<D> DenseOutput;
+    typedef BasicDiagnostics<D> Diagnostics;
+
     // Iterator typedefs
-    typedef std::vector<Object*>::iterator iterator;
-    typedef std::vector<Object*>::const_iterator const_iterator;
+    typedef typename std::vector<Object*>::iterator iterator;
+    typedef typename std::vector<Object*>::const_iterator const_iterator;
 
     static constexpr double G = 6.67428e-11;
 
     /**
      *  Returns the only instance of the Universe
      */
-    static Universe* instance();
+    static BasicUniverse* instance();
 
     /**
      *  Releases all the dynamic objects still registered with the Universe.
      */
-    ~Universe();
+    ~BasicUniverse();
 
     /**
      *  Returns the begin iterator to the actual Objects. The order of itetarion
@@ -74,24 +102,199 @@ public:
      */
     void stepSimulation(const double& timeSec);
 
+    /**
+     *  Advances the simulation by steps consecutive time steps of timeSec,
+     *  producing the same state as that many calls to stepSimulation. The
+     *  steps run on private scratch columns: the registered Objects are only
+     *  updated every stride steps and after the last one, and sample is then
+     *  called with the number of steps taken so far. A stride of zero updates
+     *  the Objects once, at the end.
+     */
+    void advance(const double& timeSec, uint64_t steps, uint64_t stride = 0,
+        const std::function<void(uint64_t)>& sample = nullptr);
+
+    /**
+     *  Advances the simulation to endTime in steps of its own choosing,
+     *  publishing the Objects as advance does: every stride steps and after
+     *  the last one, which ends on endTime. Each step keeps the relative
+     *  change of the acceleration of every body over it within tolerance,
+     *  estimated from the accelerations at both of its ends, which the
+     *  integrator needs anyway. A step that exceeds it is undone and retried
+     *  shorter, and the next step is sized from the same estimate so that
+     *  this stays rare. With a leapfrog the energy error per orbit is about
+     *  the square of tolerance. Returns the number of steps taken. Throws
+     *  std::invalid_argument if tolerance is not positive or endTime lies
+     *  before the current time, and std::runtime_error, after publishing the
+     *  bodies, if the step shrinks below the resolution of the time, as when
+     *  two bodies collide.
+     */
+    uint64_t advanceTo(double endTime, double tolerance, uint64_t stride = 0,
+        const std::function<void(uint64_t)>& sample = nullptr);
+
+    /**
+     *  Returns the number of steps advanceTo has rejected and retried.
+     */
+    uint64_t getRejectedSteps() const noexcept;
+
+    /**
+     *  Returns the simulated time in seconds: the sum of the time steps taken
+     *  since the Universe was created, or of those recorded in the last
+     *  checkpoint loaded plus the steps taken since.
+     */
+    double getTime() const noexcept;
+
+    /**
+     *  Returns the number of steps taken, counted the same way.
+     */
+    uint64_t getStepCount() const noexcept;
+
+    /**
+     *  Writes every body, the time and the step count to a binary checkpoint
+     *  at path; see BasicCheckpoint for the format. Throws std::runtime_error
+     *  if the file cannot be written.
+     */
+    void saveCheckpoint(const std::string& path) const;
+
+    /**
+     *  Replaces every body, the time and the step count with those of the
+     *  checkpoint at path. Throws std::runtime_error, leaving the Universe
+     *  unchanged, if it cannot be loaded.
+     */
+    void loadCheckpoint(const std::string& path);
+
+    /**
+     *  Starts writing the same checkpoint as saveCheckpoint from a forked
+     *  child process and returns while it is written, so stepping can go on
+     *  meanwhile; the file holds the state at the time of this call. A
+     *  checkpoint still being written is waited for first. Throws
+     *  std::runtime_error if that one failed or the fork does.
+     */
+    void saveCheckpointInBackground(const std::string& path);
+
+    /**
+     *  Returns true while a background checkpoint is being written. Throws
+     *  std::runtime_error if it has failed.
+     */
+    bool checkpointPending();
+
+    /**
+     *  Blocks until the background checkpoint, if any, is written. Throws
+     *  std::runtime_error if it failed.
+     */
+    void waitForCheckpoint();
+
     /**
      *  Swaps the contents of the provided container with the Universe's Object
      *  store and releases the old Objects.
      */
     void swap(std::vector<Object*>& snapshot);
 
+    /**
+     *  Returns the column store backing the registered Objects.
+     */
+    const BodyStore& getBodies() const noexcept;
+
+    /**
+     *  Replaces the strategy used to evaluate gravity in stepSimulation. The
+     *  default is a DirectEngine.
+     */
+    void setForceEngine(std::unique_ptr<ForceEngine> engine);
+
+    /**
+     *  Returns the strategy used to evaluate gravity.
+     */
+    ForceEngine& getForceEngine() noexcept;
+
+    /**
+     *  Replaces the scheme stepSimulation and advance move the bodies with.
+     *  The default is an EulerIntegrator.
+     */
+    void setIntegrator(std::unique_ptr<Integrator> integrator);
+
+    /**
+     *  Returns the scheme the bodies are moved with.
+     */
+    Integrator& getIntegrator() noexcept;
+
+    /**
+     *  Attaches a recorder that the state after every step is offered to,
+     *  including the steps advance takes between updates of the Objects.
+     *  The current state is offered at once. A previous recorder is detached
+     *  and closed; a null one only detaches it.
+     */
+    void setRecorder(std::unique_ptr<Recorder> recorder);
+
+    /**
+     *  Returns the attached recorder, or null.
+     */
+    Recorder* getRecorder() noexcept;
+
+    /**
+     *  Keeps the state and accelerations at the ends of the last window
+     *  steps, including those advance takes between updates of the Objects,
+     *  so the bodies can be interpolated at any time in between without
+     *  stepping there. The current state is kept at once. Zero stops
+     *  keeping them.
+     */
+    void setDenseOutput(size_t window);
+
+    /**
+     *  Returns the dense output, or null.
+     */
+    const DenseOutput* getDenseOutput() const noexcept;
+
+    /**
+     *  Starts updating the conserved quantities after every step, including
+     *  those advance takes between updates of the Objects, from the current
+     *  state, or stops if not enabled. The potential energy is a by-product
+     *  of the force engines that computesPotentials, and is NaN with the
+     *  others and with integrators that do not use the engine.
+     */
+    void setDiagnostics(bool enabled);
+
+    /**
+     *  Returns the conserved quantities, or null if not updating them.
+     */
+    const Diagnostics* getDiagnostics() const noexcept;
+
+    /**
+     *  Sets the number of threads stepSimulation runs on, counting the calling
+     *  thread. Zero selects one per hardware thread. The workers are created
+     *  here and reused by every step.
+     */
+    void setThreadCount(uint32_t threads);
+
+    /**
+     *  Returns the number of threads stepSimulation runs on.
+     */
+    uint32_t getThreadCount() const noexcept;
+
+    /**
+     *  Starts counting the hardware events of every step from zero, or
+     *  stops if not enabled. The counters belong to the calling thread,
+     *  which should be the one stepping; see PerfCounters for what is
+     *  counted and what happens where counters are unavailable.
+     */
+    void setPerfCounters(bool enabled);
+
+    /**
+     *  Returns the counts of the steps taken since counting started, or
+     *  null if not counting.
+     */
+    const PerfStats* getPerfStats() const noexcept;
+
 private:
     /**
      *  Private constructor. Ensures access control.
      */
-    Universe() = default;
+    BasicUniverse();
 
     /**
      *  Registers an Object with the universe. The Universe will clean up this
      *  object when it deems necessary.
      */
     Object* addObject(Object* ptr);
-    friend class ObjectFactory;
+    friend class BasicObjectFactory<D>;
 
     /**
      *  Calls delete on each pointer and removes it from the container.
@@ -99,14 +302,139 @@ private:
     void release(std::vector<Object*>& objects);
 
     /**
-     *  Container for pointers to the registered Objects.
+     *  Makes objects hold exactly one view per row of bodies.
+     */
+    void rebindViews();
+
+    /**
+     *  Adds state at the current time to the dense output, if any.
+     */
+    void sampleDense(const BodyStore& state);
+
+    /**
+     *  Updates the diagnostics, if any, with state at the current time.
+     */
+    void diagnose(const BodyStore& state);
+
+    /**
+     *  Takes one step of timeSec on state, then offers it to the recorder,
+     *  the dense output and the diagnostics, counting each phase if
+     *  counters are enabled.
+     */
+    void takeStep(BodyStore& state, const double& timeSec);
+
+    /**
+     *  Moves state by timeSec with the integrator, without counting the
+     *  step.
+     */
+    void integrate(BodyStore& state, const double& timeSec);
+
+    /**
+     *  Counts the step just integrated on state up to endTime and offers it
+     *  to the recorder, the dense output and the diagnostics.
+     */
+    void finishStep(BodyStore& state, double endTime);
+
+    /**
+     *  Copies the scratch positions, velocities and masses to the bodies.
+     */
+    void sync();
+
+    /**
+     *  Returns the engine the integrator is handed: the force engine, or
+     *  the one counting it.
+     */
+    ForceEngine& forces() noexcept;
+
+    /**
+     *  Primary storage for the state of every registered body.
+     */
+    BodyStore bodies;
+
+    /**
+     *  Container for pointers to the registered Objects, each a view over the
+     *  row of bodies with the same index.
      */
     std::vector<Object*> objects;
 
+    /**
+     *  Strategy used to evaluate gravity.
+     */
+    std::unique_ptr<ForceEngine> engine;
+
+    /**
+     *  Persistent workers shared by the force engine and the integrator.
+     */
+    ThreadPool pool;
+
+    /**
+     *  Strategy used to move the bodies.
+     */
+    std::unique_ptr<Integrator> integrator;
+
+    /**
+     *  Trajectory recorder offered every step, if any.
+     */
+    std::unique_ptr<Recorder> recorder;
+
+    /**
+     *  Interpolant over the last steps, if any.
+     */
+    std::unique_ptr<DenseOutput> dense;
+
+    /**
+     *  Conserved quantities, if updated, and the potential of every body
+     *  the force engine fills for them.
+     */
+    std::unique_ptr<Diagnostics> diagnostics;
+    typename ForceEngine::Potentials potential;
+
+    /**
+     *  Private copy of the dynamic columns that advance integrates.
+     */
+    BodyStore scratch;
+
+    /**
+     *  Scratch positions and velocities before the step advanceTo tries,
+     *  and the accelerations it starts from.
+     */
+    BodyStore backup;
+    typename ForceEngine::Accelerations startAcceleration;
+
+    /**
+     *  Number of steps advanceTo has rejected.
+     */
+    uint64_t rejected = 0;
+
+    /**
+     *  Simulated time in seconds and number of steps taken.
+     */
+    double time = 0.0;
+    uint64_t stepCount = 0;
+
+    /**
+     *  Counters of the stepping thread, the counts of the phases of the
+     *  steps and the engine counting the force engine, if counting.
+     */
+    std::unique_ptr<PerfCounters> counters;
+    std::unique_ptr<PerfStats> stats;
+    std::unique_ptr<ForceEngine> counting;
+
+    /**
+     *  Checkpoint being written in the background, waited for on destruction.
+     */
+    BackgroundCheckpoint background;
+
     /**
      *  Static pointer that ensures only a single instance of this class exists.
      */
-    static Universe* inst;
+    static BasicUniverse* inst;
 };
 
+extern template class BasicUniverse<2>;
+extern template class BasicUniverse<3>;
+
+typedef BasicUniverse<2> Universe;
+typedef BasicUniverse<3> Universe3;
+
 #endif // UNIVERSE_H
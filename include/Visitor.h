@@ -2,43 +2,44 @@
 #ifndef VISITOR_H
 #define VISITOR_H
 
+#include <cstdint>
 #include <ostream>
 
 // Forward declaration.
-class Object;
+template <uint32_t D> class BasicObject;
 
 /**
  *  Abstract base class for the Visitor pattern.
  */
-class Visitor {
+template <uint32_t D> class BasicVisitor {
 public:
     /**
      *  Pure virtual destructor. A necessary no-op since this is a base class.
      */
-    virtual ~Visitor() = default;
+    virtual ~BasicVisitor() = default;
 
     /**
      *  The worker method of the visitor. For this assignment, Object is the
      *  only concrete class we can visit.
      */
-    virtual void visit(Object& object) = 0;
+    virtual void visit(BasicObject<D>& object) = 0;
 };
 
 /**
  *  A visitor that accepts an ostream reference during construction. Its visit
  *  method simply prints out the object's name.
  */
-class PrintVisitor : public Visitor {
+template <uint32_t D> class BasicPrintVisitor : public BasicVisitor<D> {
 public:
     /**
      *  Construct a visitor that prints to the provided ostream.
      */
-    explicit PrintVisitor(std::ostream& os);
+    explicit BasicPrintVisitor(std::ostream& os);
 
     /**
      *  Prints the object's name.
      */
-    virtual void visit(Object& object);
+    virtual void visit(BasicObject<D>& object);
 
 private:
     /**
@@ -47,4 +48,12 @@ private:
     std::ostream& os;
 };
 
+extern template class BasicPrintVisitor<2>;
+extern template class BasicPrintVisitor<3>;
+
+typedef BasicVisitor<2> Visitor;
+typedef BasicPrintVisitor<2> PrintVisitor;
+typedef BasicVisitor<3> Visitor3;
+typedef BasicPrintVisitor<3> PrintVisitor3;
+
 #endif // VISITOR_H
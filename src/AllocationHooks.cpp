@@ -0,0 +1,92 @@
+// File name: AllocationHooks.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This file implements the counting global operator new and delete linked into the
+// executables that account for every heap allocation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef ALLOCATION_HOOKS_CPP
+#define ALLOCATION_HOOKS_CPP
+#include "../include/Allocations.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// Set before main, so that Allocations knows the counts are complete.
+const bool hooked = (Allocations::hook(), true);
+
+/**
+ *  Returns size bytes aligned to alignment, calling the new handler until
+ *  they are found. Throws std::bad_alloc if there is no handler.
+ */
+void* allocate(std::size_t size, std::size_t alignment)
+{
+    Allocations::countAllocation(size);
+    if (size == 0)
+        size = 1;
+    while (true) {
+        void* ptr = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+            ptr = std::malloc(size);
+        else if (::posix_memalign(&ptr, alignment, size) != 0)
+            ptr = nullptr;
+        if (ptr != nullptr)
+            return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+/**
+ *  Counts and frees ptr.
+ */
+void release(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        Allocations::countDeallocation();
+    std::free(ptr);
+}
+}
+
+// The array and nothrow forms of the library call these.
+
+void* operator new(std::size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    release(ptr);
+}
+
+#endif
+// comment
@@ -0,0 +1,98 @@
+// File name: Allocations.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the accounting of the heap allocations of the simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef ALLOCATIONS_CPP
+#define ALLOCATIONS_CPP
+#include "../include/Allocations.h"
+#include <atomic>
+
+namespace {
+std::atomic<int> tracking(0);
+std::atomic<bool> hooked(false);
+std::atomic<uint64_t> allocations(0);
+std::atomic<uint64_t> deallocations(0);
+std::atomic<uint64_t> bytes(0);
+}
+
+/**
+ *  Starts tracking.
+ */
+void Allocations::enable() noexcept
+{
+    tracking.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ *  Stops tracking once every enable is matched.
+ */
+void Allocations::disable() noexcept
+{
+    tracking.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ *  Returns true while tracking.
+ */
+bool Allocations::isEnabled() noexcept
+{
+    return tracking.load(std::memory_order_relaxed) > 0;
+}
+
+/**
+ *  Returns the counts so far.
+ */
+Allocations::Counts Allocations::get() noexcept
+{
+    Counts counts;
+    counts.allocations = allocations.load(std::memory_order_relaxed);
+    counts.deallocations = deallocations.load(std::memory_order_relaxed);
+    counts.bytes = bytes.load(std::memory_order_relaxed);
+    return counts;
+}
+
+/**
+ *  Returns true if the counting operator new and delete are linked in.
+ */
+bool Allocations::isHooked() noexcept
+{
+    return hooked.load(std::memory_order_relaxed);
+}
+
+/**
+ *  Counts an allocation of size bytes if tracking.
+ */
+void Allocations::countAllocation(std::size_t size) noexcept
+{
+    if (tracking.load(std::memory_order_relaxed) > 0) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+/**
+ *  Counts a deallocation if tracking.
+ */
+void Allocations::countDeallocation() noexcept
+{
+    if (tracking.load(std::memory_order_relaxed) > 0)
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ *  Records that the counting operator new and delete are linked in.
+ */
+void Allocations::hook() noexcept
+{
+    hooked.store(true, std::memory_order_relaxed);
+}
+
+#endif
+// comment
@@ -0,0 +1,271 @@
+// File name: BarnesHutEngine.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements a Barnes-Hut quadtree force engine for the simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef BARNES_HUT_ENGINE_CPP
+#define BARNES_HUT_ENGINE_CPP
+#include "../include/BarnesHutEngine.h"
+#include "../include/Trace.h"
+#include "../include/Universe.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Bodies that cannot be separated within this many subdivisions share a leaf.
+const uint32_t maxDepth = 48;
+}
+
+/**
+ *  Creates an engine with the given opening angle. Cells holding at most
+ *  leafSize bodies are not subdivided any further.
+ */
+template <uint32_t D>
+BasicBarnesHutEngine<D>::BasicBarnesHutEngine(double theta, uint32_t leafSize)
+    : theta(theta)
+    , leafSize(std::max<uint32_t>(leafSize, 1))
+{
+}
+
+/**
+ *  Returns the opening angle.
+ */
+template <uint32_t D> double BasicBarnesHutEngine<D>::getTheta() const noexcept
+{
+    return theta;
+}
+
+/**
+ *  Sets the opening angle. Larger values are faster but less accurate.
+ */
+template <uint32_t D> void BasicBarnesHutEngine<D>::setTheta(double theta) noexcept
+{
+    this->theta = theta;
+    this->touch();
+}
+
+/**
+ *  Builds the tree and walks it for every body.
+ */
+template <uint32_t D>
+void BasicBarnesHutEngine<D>::computeAccelerations(
+    const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& /* pool */)
+{
+    TRACE_SCOPE("BarnesHutEngine::computeAccelerations");
+    const size_t count = bodies.size();
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        acc[axis].resize(count);
+    }
+    nodes.clear();
+    if (count == 0)
+        return;
+
+    Node root;
+    double extent = 0.0;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        const typename BasicBodyStore<D>::Column& column = bodies.position[axis];
+        auto range = std::minmax_element(column.begin(), column.end());
+        extent = std::max(extent, *range.second - *range.first);
+        root.center[axis] = (*range.first + *range.second) * 0.5;
+    }
+    // Pad the root slightly so that bodies on the upper edge fall strictly inside.
+    root.halfSize = extent > 0.0 ? extent * 0.5 * (1.0 + 1e-9) : 1.0;
+    root.first = 0;
+    root.count = static_cast<uint32_t>(count);
+    root.children = 0;
+
+    order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    nodes.push_back(root);
+    {
+        TRACE_SCOPE("BarnesHutEngine::build");
+        build(bodies, 0, 0);
+    }
+
+    double* phi = this->preparePotentials(bodies);
+    TRACE_SCOPE("BarnesHutEngine::walk");
+    for (size_t i = 0; i < count; ++i) {
+        walk(bodies, i, acc, phi);
+    }
+}
+
+/**
+ *  Recursively builds the cell at index node covering order[first, first + count).
+ */
+template <uint32_t D>
+void BasicBarnesHutEngine<D>::build(const BasicBodyStore<D>& bodies, uint32_t node, uint32_t depth)
+{
+    std::array<const double*, D> pos;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        pos[axis] = bodies.position[axis].data();
+    }
+    const double* mass = bodies.mass.data();
+    const Node cell = nodes[node];
+
+    if (cell.count <= leafSize || depth >= maxDepth) {
+        double total = 0.0;
+        double weighted[D] = {};
+        for (uint32_t k = cell.first; k < cell.first + cell.count; ++k) {
+            uint32_t body = order[k];
+            total += mass[body];
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                weighted[axis] += mass[body] * pos[axis][body];
+            }
+        }
+        Node& leaf = nodes[node];
+        leaf.mass = total;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            leaf.com[axis] = total > 0.0 ? weighted[axis] / total : cell.center[axis];
+        }
+        return;
+    }
+
+    // Split on each axis in turn, so that bit D - 1 - axis of a child's index
+    // tells on which side of the centre it lies along that axis. In the plane
+    // this gives the quadrants (-x -y), (-x +y), (+x -y), (+x +y).
+    uint32_t* bounds[CHILDREN + 1];
+    bounds[0] = order.data() + cell.first;
+    bounds[CHILDREN] = bounds[0] + cell.count;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        const uint32_t group = CHILDREN >> axis;
+        for (uint32_t c = 0; c < CHILDREN; c += group) {
+            bounds[c + group / 2] = std::partition(bounds[c], bounds[c + group],
+                [&](uint32_t body) { return pos[axis][body] < cell.center[axis]; });
+        }
+    }
+
+    const uint32_t children = static_cast<uint32_t>(nodes.size());
+    const double quarter = cell.halfSize * 0.5;
+    for (uint32_t c = 0; c < CHILDREN; ++c) {
+        Node child;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            bool upper = (c >> (D - 1 - axis)) & 1;
+            child.center[axis] = cell.center[axis] + (upper ? quarter : -quarter);
+        }
+        child.halfSize = quarter;
+        child.first = static_cast<uint32_t>(bounds[c] - order.data());
+        child.count = static_cast<uint32_t>(bounds[c + 1] - bounds[c]);
+        child.children = 0;
+        nodes.push_back(child);
+    }
+    nodes[node].children = children;
+
+    double total = 0.0;
+    double weighted[D] = {};
+    for (uint32_t c = 0; c < CHILDREN; ++c) {
+        build(bodies, children + c, depth + 1);
+        const Node& child = nodes[children + c];
+        total += child.mass;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            weighted[axis] += child.mass * child.com[axis];
+        }
+    }
+    Node& parent = nodes[node];
+    parent.mass = total;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        parent.com[axis] = total > 0.0 ? weighted[axis] / total : cell.center[axis];
+    }
+}
+
+/**
+ *  Stores the acceleration of body i in row i of acc, and its potential
+ *  in row i of phi unless phi is null, by walking the tree from the root.
+ */
+template <uint32_t D>
+void BasicBarnesHutEngine<D>::walk(
+    const BasicBodyStore<D>& bodies, size_t i, Accelerations& acc, double* phi)
+{
+    std::array<const double*, D> pos;
+    double at[D];
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        pos[axis] = bodies.position[axis].data();
+        at[axis] = pos[axis][i];
+    }
+    const double* mass = bodies.mass.data();
+    const double thetaSq = theta * theta;
+    double sum[D] = {};
+    // G m / r is scale * distSq; summing it costs one operation a pair.
+    double energy = 0.0;
+
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node& cell = nodes[stack.back()];
+        stack.pop_back();
+        if (cell.mass == 0.0)
+            continue;
+
+        if (cell.children == 0) {
+            for (uint32_t k = cell.first; k < cell.first + cell.count; ++k) {
+                uint32_t body = order[k];
+                double d[D];
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    d[axis] = pos[axis][body] - at[axis];
+                }
+                double distSq = d[0] * d[0];
+                for (uint32_t axis = 1; axis < D; ++axis) {
+                    distSq += d[axis] * d[axis];
+                }
+                if (distSq == 0.0)
+                    continue;
+                double scale = BasicUniverse<D>::G * mass[body] / (distSq * std::sqrt(distSq));
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    sum[axis] += scale * d[axis];
+                }
+                energy -= scale * distSq;
+            }
+            continue;
+        }
+
+        // A cell containing the body itself is always opened.
+        bool inside = true;
+        double d[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            inside = inside && std::abs(at[axis] - cell.center[axis]) <= cell.halfSize;
+            d[axis] = cell.com[axis] - at[axis];
+        }
+        double distSq = d[0] * d[0];
+        for (uint32_t axis = 1; axis < D; ++axis) {
+            distSq += d[axis] * d[axis];
+        }
+        double size = 2.0 * cell.halfSize;
+        if (!inside && size * size < thetaSq * distSq) {
+            double scale = BasicUniverse<D>::G * cell.mass / (distSq * std::sqrt(distSq));
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                sum[axis] += scale * d[axis];
+            }
+            energy -= scale * distSq;
+        } else {
+            for (uint32_t c = 0; c < CHILDREN; ++c) {
+                stack.push_back(cell.children + c);
+            }
+        }
+    }
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        acc[axis][i] = sum[axis];
+    }
+    if (phi)
+        phi[i] = energy;
+}
+
+/**
+ *  Returns true: distant cells add the potential of their point mass.
+ */
+template <uint32_t D> bool BasicBarnesHutEngine<D>::computesPotentials() const noexcept
+{
+    return true;
+}
+
+template class BasicBarnesHutEngine<2>;
+template class BasicBarnesHutEngine<3>;
+
+#endif
+// comment
\ No newline at end of file
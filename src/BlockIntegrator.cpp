@@ -0,0 +1,275 @@
+// File name: BlockIntegrator.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements a Hermite integrator with individual block time steps
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef BLOCK_INTEGRATOR_CPP
+#define BLOCK_INTEGRATOR_CPP
+#include "../include/BlockIntegrator.h"
+#include "../include/Universe.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ *  Creates an integrator taking steps of about eta |a| / |jerk|, but no
+ *  smaller than 2^-maxLevel of the step passed to step.
+ */
+template <uint32_t D>
+BasicBlockIntegrator<D>::BasicBlockIntegrator(double eta, uint32_t maxLevel)
+    : eta(eta)
+    , maxLevel(std::min<uint32_t>(maxLevel, 62))
+{
+}
+
+/**
+ *  Returns the number of block times processed so far. A shared time step
+ *  would have evaluated every body at each of them.
+ */
+template <uint32_t D> uint64_t BasicBlockIntegrator<D>::getBlockSteps() const noexcept
+{
+    return blockSteps;
+}
+
+/**
+ *  Returns the accelerations of the last correction if state is the one the
+ *  last step left, and evaluates them through the engine otherwise.
+ */
+template <uint32_t D>
+const typename BasicForceEngine<D>::Accelerations& BasicBlockIntegrator<D>::getAccelerations(
+    const BodyStore& state, ForceEngine& engine, ThreadPool& pool)
+{
+    // Every body is corrected at the end of a step, so acc is at state.
+    if (lastGeneration == state.getGeneration()
+        && lastVelocityGeneration == state.getVelocityGeneration())
+        return acc;
+    return BasicIntegrator<D>::getAccelerations(state, engine, pool);
+}
+
+/**
+ *  Advances every body through block steps that add up to timeSec.
+ */
+template <uint32_t D>
+void BasicBlockIntegrator<D>::step(
+    BodyStore& state, double timeSec, ForceEngine&, ThreadPool& pool)
+{
+    const size_t count = state.size();
+    if (count < 2 || !(timeSec > 0.0))
+        return;
+    const uint64_t whole = uint64_t(1) << maxLevel;
+    const double tick = timeSec / static_cast<double>(whole);
+    // A state left by the previous call already has its accelerations and steps.
+    if (lastStep != timeSec || lastGeneration != state.getGeneration()
+        || lastVelocityGeneration != state.getVelocityGeneration())
+        start(state, timeSec, pool);
+
+    uint64_t now = 0;
+    while (now < whole) {
+        now = whole;
+        for (size_t i = 1; i < count; ++i) {
+            if (time[i] < whole)
+                now = std::min(now, time[i] + steps[i]);
+        }
+        active.clear();
+        for (size_t i = 1; i < count; ++i) {
+            if (time[i] + steps[i] == now)
+                active.push_back(static_cast<uint32_t>(i));
+        }
+        predict(state, now, tick, pool);
+        evaluate(state, pool);
+        ++blockSteps;
+
+        const uint32_t* rows = active.data();
+        pool.parallelFor(active.size(), 4096, [&, rows](size_t begin, size_t end, uint32_t) {
+            for (size_t k = begin; k < end; ++k) {
+                const uint32_t i = rows[k];
+                const double dt = static_cast<double>(steps[i]) * tick;
+                double accNorm = 0.0;
+                double jerkNorm = 0.0;
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    const double a0 = acc[axis][i];
+                    const double a1 = nextAcc[axis][i];
+                    const double j0 = jerk[axis][i];
+                    const double j1 = nextJerk[axis][i];
+                    const double v0 = state.velocity[axis][i];
+                    const double v1 = v0 + 0.5 * (a0 + a1) * dt + (j0 - j1) * dt * dt / 12.0;
+                    state.position[axis][i]
+                        += 0.5 * (v0 + v1) * dt + (a0 - a1) * dt * dt / 12.0;
+                    state.velocity[axis][i] = v1;
+                    acc[axis][i] = a1;
+                    jerk[axis][i] = j1;
+                    accNorm += a1 * a1;
+                    jerkNorm += j1 * j1;
+                }
+                time[i] += steps[i];
+                // A step may only double where the doubled block starts.
+                uint64_t limit = std::min(whole, 2 * steps[i]);
+                if (time[i] % limit != 0)
+                    limit = steps[i];
+                steps[i] = span(std::sqrt(accNorm), std::sqrt(jerkNorm), tick, limit);
+            }
+        });
+    }
+
+    std::fill(time.begin(), time.end(), 0);
+    state.touch();
+    state.touchVelocity();
+    lastGeneration = state.getGeneration();
+    lastVelocityGeneration = state.getVelocityGeneration();
+    lastStep = timeSec;
+}
+
+/**
+ *  Evaluates the acceleration and jerk of every body and picks the first
+ *  steps, for a state this integrator did not produce.
+ */
+template <uint32_t D>
+void BasicBlockIntegrator<D>::start(const BodyStore& state, double timeSec, ThreadPool& pool)
+{
+    const size_t count = state.size();
+    const uint64_t whole = uint64_t(1) << maxLevel;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        acc[axis].assign(count, 0.0);
+        jerk[axis].assign(count, 0.0);
+        predictedPosition[axis].resize(count);
+        predictedVelocity[axis].resize(count);
+        nextAcc[axis].resize(count);
+        nextJerk[axis].resize(count);
+    }
+    time.assign(count, 0);
+    steps.assign(count, whole);
+
+    active.clear();
+    for (size_t i = 1; i < count; ++i) {
+        active.push_back(static_cast<uint32_t>(i));
+    }
+    predict(state, 0, 0.0, pool);
+    evaluate(state, pool);
+    const double tick = timeSec / static_cast<double>(whole);
+    for (size_t i = 1; i < count; ++i) {
+        double accNorm = 0.0;
+        double jerkNorm = 0.0;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            acc[axis][i] = nextAcc[axis][i];
+            jerk[axis][i] = nextJerk[axis][i];
+            accNorm += acc[axis][i] * acc[axis][i];
+            jerkNorm += jerk[axis][i] * jerk[axis][i];
+        }
+        steps[i] = span(std::sqrt(accNorm), std::sqrt(jerkNorm), tick, whole);
+    }
+}
+
+/**
+ *  Predicts every body to tick now from its last correction.
+ */
+template <uint32_t D>
+void BasicBlockIntegrator<D>::predict(
+    const BodyStore& state, uint64_t now, double tick, ThreadPool& pool)
+{
+    const size_t count = state.size();
+    // The sun never moves, so it acts with its position and no velocity.
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        predictedPosition[axis][0] = state.position[axis][0];
+        predictedVelocity[axis][0] = 0.0;
+    }
+    pool.parallelFor(count - 1, 16384, [&](size_t begin, size_t end, uint32_t) {
+        for (size_t i = begin + 1; i < end + 1; ++i) {
+            const double dt = static_cast<double>(now - time[i]) * tick;
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                const double a = acc[axis][i];
+                const double j = jerk[axis][i];
+                const double v = state.velocity[axis][i];
+                predictedPosition[axis][i]
+                    = state.position[axis][i] + dt * (v + dt * (0.5 * a + dt * j / 6.0));
+                predictedVelocity[axis][i] = v + dt * (a + 0.5 * dt * j);
+            }
+        }
+    });
+}
+
+/**
+ *  Sums the acceleration and jerk of every active body over the predicted
+ *  state into nextAcc and nextJerk.
+ */
+template <uint32_t D>
+void BasicBlockIntegrator<D>::evaluate(const BodyStore& state, ThreadPool& pool)
+{
+    const size_t count = state.size();
+    std::array<const double*, D> pos;
+    std::array<const double*, D> vel;
+    std::array<double*, D> outAcc;
+    std::array<double*, D> outJerk;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        pos[axis] = predictedPosition[axis].data();
+        vel[axis] = predictedVelocity[axis].data();
+        outAcc[axis] = nextAcc[axis].data();
+        outJerk[axis] = nextJerk[axis].data();
+    }
+    const double* mass = state.mass.data();
+    const uint32_t* rows = active.data();
+    const size_t minRows = std::max<size_t>(1, 32768 / count);
+    pool.parallelFor(active.size(), minRows, [=](size_t begin, size_t end, uint32_t) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = rows[k];
+            double sumA[D] = {};
+            double sumJ[D] = {};
+            for (size_t j = 0; j < count; ++j) {
+                double d[D];
+                double dv[D];
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    d[axis] = pos[axis][j] - pos[axis][i];
+                    dv[axis] = vel[axis][j] - vel[axis][i];
+                }
+                double distSq = d[0] * d[0];
+                double rv = d[0] * dv[0];
+                for (uint32_t axis = 1; axis < D; ++axis) {
+                    distSq += d[axis] * d[axis];
+                    rv += d[axis] * dv[axis];
+                }
+                // Skips i == j as well as coincident bodies, whose direction is undefined.
+                if (distSq == 0.0)
+                    continue;
+                double scale = BasicUniverse<D>::G * mass[j] / (distSq * std::sqrt(distSq));
+                double radial = 3.0 * rv / distSq;
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    sumA[axis] += scale * d[axis];
+                    sumJ[axis] += scale * (dv[axis] - radial * d[axis]);
+                }
+            }
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                outAcc[axis][i] = sumA[axis];
+                outJerk[axis][i] = sumJ[axis];
+            }
+        }
+    });
+    this->evaluations += active.size();
+}
+
+/**
+ *  Returns the step in ticks for a body with the given acceleration and
+ *  jerk, at most limit and never smaller than one tick.
+ */
+template <uint32_t D>
+uint64_t BasicBlockIntegrator<D>::span(
+    double accNorm, double jerkNorm, double tick, uint64_t limit) const noexcept
+{
+    if (!(jerkNorm > 0.0))
+        return limit;
+    const double ticks = eta * accNorm / jerkNorm / tick;
+    uint64_t result = limit;
+    while (result > 1 && static_cast<double>(result) > ticks) {
+        result >>= 1;
+    }
+    return result;
+}
+
+template class BasicBlockIntegrator<2>;
+template class BasicBlockIntegrator<3>;
+
+#endif
+// comment
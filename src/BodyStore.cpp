@@ -0,0 +1,252 @@
+// File name: BodyStore.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the structure-of-arrays column store that holds the state of
+// every body in the simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef BODY_STORE_CPP
+#define BODY_STORE_CPP
+#include "../include/BodyStore.h"
+#include "../include/Allocations.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+/**
+ *  Returns uninitialized storage for count values. Throws std::bad_alloc
+ *  if there is none.
+ */
+template <typename T> T* ColumnAllocator<T>::allocate(size_t count)
+{
+    size_t bytes = count * sizeof(T);
+    if (count > SIZE_MAX / sizeof(T))
+        throw std::bad_alloc();
+    if (bytes < HUGE_PAGE)
+        return std::allocator<T>().allocate(count);
+    // Bypasses operator new, so the accounting has to be told.
+    Allocations::countAllocation(bytes);
+    bytes = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    void* values = std::aligned_alloc(HUGE_PAGE, bytes);
+    if (values == nullptr)
+        throw std::bad_alloc();
+    // Only a hint: without transparent huge pages the column keeps small ones.
+    ::madvise(values, bytes, MADV_HUGEPAGE);
+    return static_cast<T*>(values);
+}
+
+/**
+ *  Releases storage returned by allocate for the same count.
+ */
+template <typename T> void ColumnAllocator<T>::deallocate(T* values, size_t count) noexcept
+{
+    if (count * sizeof(T) < HUGE_PAGE) {
+        std::allocator<T>().deallocate(values, count);
+    } else {
+        Allocations::countDeallocation();
+        std::free(values);
+    }
+}
+
+template class ColumnAllocator<double>;
+template class ColumnAllocator<std::string>;
+
+/**
+ *  Returns a value greater than any returned before in this process.
+ */
+uint64_t nextGeneration() noexcept
+{
+    static std::atomic<uint64_t> last(0);
+    return last.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/**
+ *  Returns the number of bodies (rows) in the store.
+ */
+template <uint32_t D> size_t BasicBodyStore<D>::size() const noexcept
+{
+    return mass.size();
+}
+
+/**
+ *  Returns true if the store holds no bodies.
+ */
+template <uint32_t D> bool BasicBodyStore<D>::empty() const noexcept
+{
+    return mass.empty();
+}
+
+/**
+ *  Appends a body and returns the index of its row.
+ */
+template <uint32_t D>
+size_t BasicBodyStore<D>::add(
+    const std::string& name, double mass, const Vector<D>& pos, const Vector<D>& vel)
+{
+    size_t row = size();
+    resize(row + 1);
+    set(row, name, mass, pos, vel);
+    return row;
+}
+
+/**
+ *  Overwrites every column of the given row.
+ */
+template <uint32_t D> void BasicBodyStore<D>::set(
+    size_t row, const std::string& name, double mass, const Vector<D>& pos, const Vector<D>& vel)
+{
+    this->name[row] = name;
+    this->mass[row] = mass;
+    setPosition(row, pos);
+    setVelocity(row, vel);
+    touch();
+}
+
+/**
+ *  Grows or shrinks every column to count rows. New rows are zeroed.
+ */
+template <uint32_t D> void BasicBodyStore<D>::resize(size_t count)
+{
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        position[axis].resize(count, 0.0);
+        velocity[axis].resize(count, 0.0);
+    }
+    mass.resize(count, 0.0);
+    name.resize(count);
+    touch();
+    touchVelocity();
+}
+
+/**
+ *  Reserves capacity for count rows in every column.
+ */
+template <uint32_t D> void BasicBodyStore<D>::reserve(size_t count)
+{
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        position[axis].reserve(count);
+        velocity[axis].reserve(count);
+    }
+    mass.reserve(count);
+    name.reserve(count);
+}
+
+/**
+ *  Removes every row.
+ */
+template <uint32_t D> void BasicBodyStore<D>::clear() noexcept
+{
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        position[axis].clear();
+        velocity[axis].clear();
+    }
+    mass.clear();
+    name.clear();
+    touch();
+    touchVelocity();
+}
+
+/**
+ *  Copies the positions, velocities and masses of from, reusing the capacity
+ *  of the columns, and takes over its generations.
+ */
+template <uint32_t D> void BasicBodyStore<D>::copyState(const BasicBodyStore& from)
+{
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        position[axis].assign(from.position[axis].begin(), from.position[axis].end());
+        velocity[axis].assign(from.velocity[axis].begin(), from.velocity[axis].end());
+    }
+    mass.assign(from.mass.begin(), from.mass.end());
+    generation = from.generation;
+    velocityGeneration = from.velocityGeneration;
+}
+
+/**
+ *  Returns the generation of the positions and masses.
+ */
+template <uint32_t D> uint64_t BasicBodyStore<D>::getGeneration() const noexcept
+{
+    return generation;
+}
+
+/**
+ *  Returns the generation of the velocities.
+ */
+template <uint32_t D> uint64_t BasicBodyStore<D>::getVelocityGeneration() const noexcept
+{
+    return velocityGeneration;
+}
+
+/**
+ *  Renews the generation after the positions or masses were written.
+ */
+template <uint32_t D> void BasicBodyStore<D>::touch() noexcept
+{
+    generation = nextGeneration();
+}
+
+/**
+ *  Renews the generation after the velocities were written.
+ */
+template <uint32_t D> void BasicBodyStore<D>::touchVelocity() noexcept
+{
+    velocityGeneration = nextGeneration();
+}
+
+/**
+ *  Gathers the position columns of a row into a vector.
+ */
+template <uint32_t D> Vector<D> BasicBodyStore<D>::getPosition(size_t row) const noexcept
+{
+    Vector<D> pos;
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        pos[axis] = position[axis][row];
+    }
+    return pos;
+}
+
+/**
+ *  Scatters pos into the position columns of a row.
+ */
+template <uint32_t D> void BasicBodyStore<D>::setPosition(size_t row, const Vector<D>& pos) noexcept
+{
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        position[axis][row] = pos[axis];
+    }
+    touch();
+}
+
+/**
+ *  Gathers the velocity columns of a row into a vector.
+ */
+template <uint32_t D> Vector<D> BasicBodyStore<D>::getVelocity(size_t row) const noexcept
+{
+    Vector<D> vel;
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        vel[axis] = velocity[axis][row];
+    }
+    return vel;
+}
+
+/**
+ *  Scatters vel into the velocity columns of a row.
+ */
+template <uint32_t D> void BasicBodyStore<D>::setVelocity(size_t row, const Vector<D>& vel) noexcept
+{
+    for (uint32_t axis = 0; axis < DIM; ++axis) {
+        velocity[axis][row] = vel[axis];
+    }
+    touchVelocity();
+}
+
+template class BasicBodyStore<2>;
+template class BasicBodyStore<3>;
+
+#endif
+// comment
\ No newline at end of file
@@ -0,0 +1,477 @@
+// File name: Checkpoint.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the memory mappable binary checkpoint format of the simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef CHECKPOINT_CPP
+#define CHECKPOINT_CPP
+#include "../include/Checkpoint.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+const char magic[8] = { 'N', 'B', 'O', 'D', 'Y', 'C', 'K', 'P' };
+const uint32_t nativeTag = 0x01020304;
+const uint32_t swappedTag = 0x04030201;
+// Every column starts on a boundary of this many bytes.
+const size_t alignment = 64;
+
+/**
+ *  The first bytes of every checkpoint.
+ */
+struct Header {
+    char magic[8];
+    uint32_t endian;
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t reserved;
+    uint64_t count;
+    double time;
+    uint64_t steps;
+    uint64_t nameBytes;
+    uint64_t padding;
+};
+static_assert(sizeof(Header) == alignment, "the header fills exactly one boundary");
+
+/**
+ *  Returns bytes rounded up to the column alignment.
+ */
+size_t aligned(size_t bytes)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+/**
+ *  Returns the std::runtime_error reporting that the operation on path
+ *  failed with the current errno.
+ */
+std::runtime_error failure(const std::string& path, const char* operation)
+{
+    return std::runtime_error(path + ": " + operation + " failed: " + std::strerror(errno));
+}
+
+/**
+ *  Writes all bytes to fd, retrying short writes.
+ */
+void writeAll(int fd, const void* data, size_t bytes, const std::string& path)
+{
+    const char* next = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = ::write(fd, next, bytes);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw failure(path, "write");
+        }
+        next += written;
+        bytes -= static_cast<size_t>(written);
+    }
+}
+
+/**
+ *  Writes a column followed by the zeros that align the next one.
+ */
+void writeColumn(int fd, const void* data, size_t bytes, const std::string& path)
+{
+    static const char zeros[alignment] = {};
+    writeAll(fd, data, bytes, path);
+    writeAll(fd, zeros, aligned(bytes) - bytes, path);
+}
+
+uint32_t swap32(uint32_t value)
+{
+    return __builtin_bswap32(value);
+}
+
+uint64_t swap64(uint64_t value)
+{
+    return __builtin_bswap64(value);
+}
+}
+
+/**
+ *  Waits for a checkpoint still being written, ignoring its outcome.
+ */
+BackgroundCheckpoint::~BackgroundCheckpoint()
+{
+    try {
+        wait();
+    } catch (const std::exception&) {
+    }
+}
+
+/**
+ *  Returns true while a checkpoint is being written. Throws
+ *  std::runtime_error, as wait does, if it has just failed.
+ */
+bool BackgroundCheckpoint::pending()
+{
+    if (child < 0)
+        return false;
+    int status = 0;
+    pid_t done = ::waitpid(child, &status, WNOHANG);
+    if (done == 0 || (done < 0 && errno == EINTR))
+        return true;
+    finish(done < 0 ? 0 : status);
+    return false;
+}
+
+/**
+ *  Blocks until the checkpoint being written, if any, is complete. Throws
+ *  std::runtime_error with the child's error message if it failed.
+ */
+void BackgroundCheckpoint::wait()
+{
+    if (child < 0)
+        return;
+    int status = 0;
+    pid_t done;
+    do {
+        done = ::waitpid(child, &status, 0);
+    } while (done < 0 && errno == EINTR);
+    // The status is lost if SIGCHLD is ignored; the message still reports failures.
+    finish(done < 0 ? 0 : status);
+}
+
+/**
+ *  Forks a child that runs save, reports any exception through a pipe
+ *  and exits without unwinding. Waits for the previous child first.
+ */
+void BackgroundCheckpoint::start(const std::string& path, const std::function<void()>& save)
+{
+    wait();
+    int ends[2];
+    if (::pipe(ends) != 0)
+        throw failure(path, "pipe");
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(ends[0]);
+        ::close(ends[1]);
+        throw failure(path, "fork");
+    }
+    if (pid == 0) {
+        // The child must not return into the caller, nor run its exit handlers.
+        ::close(ends[0]);
+        int status = 0;
+        try {
+            save();
+        } catch (const std::exception& error) {
+            status = ::write(ends[1], error.what(), std::strlen(error.what())) < 0 ? 2 : 1;
+        } catch (...) {
+            status = 1;
+        }
+        ::_exit(status);
+    }
+    ::close(ends[1]);
+    child = pid;
+    messages = ends[0];
+    this->path = path;
+}
+
+/**
+ *  Collects the child's exit status and message once it has exited.
+ */
+void BackgroundCheckpoint::finish(int status)
+{
+    std::string message;
+    char buffer[256];
+    for (;;) {
+        ssize_t got = ::read(messages, buffer, sizeof(buffer));
+        if (got > 0)
+            message.append(buffer, static_cast<size_t>(got));
+        else if (got == 0 || errno != EINTR)
+            break;
+    }
+    ::close(messages);
+    child = -1;
+    messages = -1;
+    if (!message.empty())
+        throw std::runtime_error(message);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw std::runtime_error(path + ": background checkpoint failed");
+}
+
+/**
+ *  Writes bodies, time and steps to a temporary file next to path, flushes
+ *  it to disk and renames it over path, so a crash never leaves a partial
+ *  checkpoint behind. Throws std::runtime_error on failure.
+ */
+template <uint32_t D>
+void BasicCheckpoint<D>::save(
+    const std::string& path, const BasicBodyStore<D>& bodies, double time, uint64_t steps)
+{
+    const size_t count = bodies.size();
+    std::vector<uint64_t> offsets(count + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i + 1] = offsets[i] + bodies.name[i].size();
+    }
+    std::string names;
+    names.reserve(offsets[count]);
+    for (const std::string& name : bodies.name) {
+        names += name;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.endian = nativeTag;
+    header.version = VERSION;
+    header.dimension = D;
+    header.count = count;
+    header.time = time;
+    header.steps = steps;
+    header.nameBytes = names.size();
+
+    const std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw failure(temporary, "open");
+    try {
+        const size_t bytes = count * sizeof(double);
+        writeAll(fd, &header, sizeof(header), temporary);
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            writeColumn(fd, bodies.position[axis].data(), bytes, temporary);
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            writeColumn(fd, bodies.velocity[axis].data(), bytes, temporary);
+        }
+        writeColumn(fd, bodies.mass.data(), bytes, temporary);
+        writeColumn(fd, offsets.data(), offsets.size() * sizeof(uint64_t), temporary);
+        writeAll(fd, names.data(), names.size(), temporary);
+        if (::fsync(fd) != 0)
+            throw failure(temporary, "fsync");
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        throw;
+    }
+    if (::close(fd) != 0) {
+        ::unlink(temporary.c_str());
+        throw failure(temporary, "close");
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        throw failure(path, "rename");
+    }
+}
+
+/**
+ *  Saves as save does, but from a child process forked by job, and
+ *  returns as soon as the child exists. The checkpoint holds bodies as
+ *  they are now, however they change while it is written. Throws
+ *  std::runtime_error if the previous checkpoint of job failed or the
+ *  process cannot be forked.
+ */
+template <uint32_t D>
+void BasicCheckpoint<D>::saveInBackground(const std::string& path,
+    const BasicBodyStore<D>& bodies, double time, uint64_t steps, BackgroundCheckpoint& job)
+{
+    job.start(path, [&]() { save(path, bodies, time, steps); });
+}
+
+/**
+ *  Maps the checkpoint at path read-only and validates it. Throws
+ *  std::runtime_error if it cannot be read, is not a checkpoint, or has
+ *  another version or number of dimensions.
+ */
+template <uint32_t D> BasicCheckpoint<D>::BasicCheckpoint(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw failure(path, "open");
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw failure(path, "stat");
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length < sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error(path + ": not a checkpoint");
+    }
+    mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw failure(path, "mmap");
+    }
+    // Restoring reads every column front to back.
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+    base = static_cast<const unsigned char*>(mapping);
+
+    try {
+        Header header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0
+            || (header.endian != nativeTag && header.endian != swappedTag))
+            throw std::runtime_error(path + ": not a checkpoint");
+        if (header.endian == swappedTag) {
+            header.version = swap32(header.version);
+            header.dimension = swap32(header.dimension);
+            header.count = swap64(header.count);
+            header.steps = swap64(header.steps);
+            header.nameBytes = swap64(header.nameBytes);
+            uint64_t bits;
+            std::memcpy(&bits, &header.time, sizeof(bits));
+            bits = swap64(bits);
+            std::memcpy(&header.time, &bits, sizeof(bits));
+        }
+        if (header.version != VERSION)
+            throw std::runtime_error(
+                path + ": unsupported checkpoint version " + std::to_string(header.version));
+        if (header.dimension != D)
+            throw std::runtime_error(path + ": checkpoint has "
+                + std::to_string(header.dimension) + " dimensions, expected " + std::to_string(D));
+        count = header.count;
+        time = header.time;
+        steps = header.steps;
+        nameBytes = header.nameBytes;
+
+        const size_t namesStart = sizeof(Header) + (2 * D + 1) * aligned(count * sizeof(double))
+            + aligned((count + 1) * sizeof(uint64_t));
+        // Compared without a sum, which a crafted nameBytes could wrap.
+        if (count > length / sizeof(double) || namesStart > length
+            || nameBytes != length - namesStart)
+            throw std::runtime_error(path + ": truncated checkpoint");
+
+        if (header.endian == swappedTag) {
+            // Every field before the names is a whole 64 bit word.
+            swapped.resize((length + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            std::memcpy(swapped.data(), base, length);
+            for (size_t word = sizeof(Header) / sizeof(uint64_t);
+                 word < namesStart / sizeof(uint64_t); ++word) {
+                swapped[word] = swap64(swapped[word]);
+            }
+            ::munmap(mapping, length);
+            mapping = nullptr;
+            base = reinterpret_cast<const unsigned char*>(swapped.data());
+        }
+
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(column(2 * D + 1));
+        if (offsets[0] != 0 || offsets[count] != nameBytes
+            || !std::is_sorted(offsets, offsets + count + 1))
+            throw std::runtime_error(path + ": corrupt checkpoint names");
+    } catch (...) {
+        if (mapping != nullptr)
+            ::munmap(mapping, length);
+        throw;
+    }
+}
+
+/**
+ *  Unmaps the file.
+ */
+template <uint32_t D> BasicCheckpoint<D>::~BasicCheckpoint()
+{
+    if (mapping != nullptr)
+        ::munmap(mapping, length);
+}
+
+/**
+ *  Returns the number of bodies.
+ */
+template <uint32_t D> size_t BasicCheckpoint<D>::size() const noexcept
+{
+    return count;
+}
+
+/**
+ *  Returns the simulation time in seconds.
+ */
+template <uint32_t D> double BasicCheckpoint<D>::getTime() const noexcept
+{
+    return time;
+}
+
+/**
+ *  Returns the number of steps taken.
+ */
+template <uint32_t D> uint64_t BasicCheckpoint<D>::getSteps() const noexcept
+{
+    return steps;
+}
+
+/**
+ *  Returns the column at the given index in the file's column order.
+ */
+template <uint32_t D> const double* BasicCheckpoint<D>::column(uint32_t index) const noexcept
+{
+    return reinterpret_cast<const double*>(
+        base + sizeof(Header) + index * aligned(count * sizeof(double)));
+}
+
+/**
+ *  Returns the given position column, in place.
+ */
+template <uint32_t D> const double* BasicCheckpoint<D>::position(uint32_t axis) const noexcept
+{
+    return column(axis);
+}
+
+/**
+ *  Returns the given velocity column, in place.
+ */
+template <uint32_t D> const double* BasicCheckpoint<D>::velocity(uint32_t axis) const noexcept
+{
+    return column(D + axis);
+}
+
+/**
+ *  Returns the mass column, in place.
+ */
+template <uint32_t D> const double* BasicCheckpoint<D>::mass() const noexcept
+{
+    return column(2 * D);
+}
+
+/**
+ *  Returns the name of a row.
+ */
+template <uint32_t D> std::string BasicCheckpoint<D>::name(size_t row) const
+{
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(column(2 * D + 1));
+    const char* names
+        = reinterpret_cast<const char*>(offsets) + aligned((count + 1) * sizeof(uint64_t));
+    return std::string(names + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+/**
+ *  Copies every column into bodies, replacing its rows.
+ */
+template <uint32_t D> void BasicCheckpoint<D>::restore(BasicBodyStore<D>& bodies) const
+{
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        bodies.position[axis].assign(position(axis), position(axis) + count);
+        bodies.velocity[axis].assign(velocity(axis), velocity(axis) + count);
+    }
+    bodies.mass.assign(mass(), mass() + count);
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(column(2 * D + 1));
+    const char* names
+        = reinterpret_cast<const char*>(offsets) + aligned((count + 1) * sizeof(uint64_t));
+    bodies.name.resize(count);
+    for (size_t row = 0; row < count; ++row) {
+        bodies.name[row].assign(names + offsets[row], offsets[row + 1] - offsets[row]);
+    }
+    bodies.touch();
+    bodies.touchVelocity();
+}
+
+template class BasicCheckpoint<2>;
+template class BasicCheckpoint<3>;
+
+#endif
+// comment
@@ -0,0 +1,234 @@
+// File name: DenseOutput.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the interpolation of the bodies between the steps of the
+// simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef DENSE_OUTPUT_CPP
+#define DENSE_OUTPUT_CPP
+#include "../include/DenseOutput.h"
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+/**
+ *  Creates an output that interpolates over the last window steps. Throws
+ *  std::invalid_argument if window is zero.
+ */
+template <uint32_t D>
+BasicDenseOutput<D>::BasicDenseOutput(size_t window)
+    : samples(window + 1)
+{
+    if (window == 0)
+        throw std::invalid_argument("dense output window must be positive");
+}
+
+/**
+ *  Adds the state at the end of a step at time, with the accelerations of
+ *  its bodies, dropping the oldest step beyond the window. A time not after
+ *  the last one, or another number of bodies, starts over with this state
+ *  alone. Throws std::invalid_argument if the accelerations do not match
+ *  the bodies.
+ */
+template <uint32_t D>
+void BasicDenseOutput<D>::record(const BodyStore& state, double time, const Columns& acceleration)
+{
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        if (acceleration[axis].size() != state.size())
+            throw std::invalid_argument("dense output needs an acceleration for every body");
+    }
+    if (count > 0) {
+        const Sample& last = sample(count - 1);
+        if (!(time > last.time) || last.position[0].size() != state.size())
+            clear();
+    }
+    Sample* next;
+    if (count == samples.size()) {
+        next = &samples[first];
+        first = (first + 1) % samples.size();
+    } else {
+        next = &samples[(first + count) % samples.size()];
+        ++count;
+    }
+    // Assignment reuses the capacity of the sample this one replaces.
+    next->time = time;
+    next->position = state.position;
+    next->velocity = state.velocity;
+    next->acceleration = acceleration;
+    // The sun never moves, whatever pull the engine reports on it.
+    if (!state.empty()) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            next->acceleration[axis][0] = 0.0;
+        }
+    }
+}
+
+/**
+ *  Forgets every recorded state.
+ */
+template <uint32_t D> void BasicDenseOutput<D>::clear() noexcept
+{
+    first = 0;
+    count = 0;
+}
+
+/**
+ *  Returns the number of steps interpolated over.
+ */
+template <uint32_t D> size_t BasicDenseOutput<D>::getWindow() const noexcept
+{
+    return samples.size() - 1;
+}
+
+/**
+ *  Returns the number of bodies recorded.
+ */
+template <uint32_t D> size_t BasicDenseOutput<D>::getBodyCount() const noexcept
+{
+    return count > 0 ? sample(0).position[0].size() : 0;
+}
+
+/**
+ *  Returns the earliest time that can be interpolated at, or NaN.
+ */
+template <uint32_t D> double BasicDenseOutput<D>::getStartTime() const noexcept
+{
+    return count > 0 ? sample(0).time : std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ *  Returns the latest time that can be interpolated at, or NaN.
+ */
+template <uint32_t D> double BasicDenseOutput<D>::getEndTime() const noexcept
+{
+    return count > 0 ? sample(count - 1).time : std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ *  Returns true if time lies between the start and end times.
+ */
+template <uint32_t D> bool BasicDenseOutput<D>::covers(double time) const noexcept
+{
+    return count > 0 && time >= sample(0).time && time <= sample(count - 1).time;
+}
+
+/**
+ *  Returns the position of a body at time. Throws std::out_of_range if the
+ *  time is not covered or the row was not recorded.
+ */
+template <uint32_t D> Vector<D> BasicDenseOutput<D>::getPosition(size_t row, double time) const
+{
+    const Weights w = locate(time);
+    if (row >= getBodyCount())
+        throw std::out_of_range("dense output has no row " + std::to_string(row));
+    Vector<D> position;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        const double q0 = w.begin->position[axis][row];
+        const double q1 = w.end->position[axis][row];
+        position[axis] = q0 + (q1 - q0) * w.toEnd
+            + w.h * w.fromStart * w.begin->velocity[axis][row]
+            + w.h * w.fromEnd * w.end->velocity[axis][row];
+    }
+    return position;
+}
+
+/**
+ *  Returns the velocity of a body at time. Throws std::out_of_range if the
+ *  time is not covered or the row was not recorded.
+ */
+template <uint32_t D> Vector<D> BasicDenseOutput<D>::getVelocity(size_t row, double time) const
+{
+    const Weights w = locate(time);
+    if (row >= getBodyCount())
+        throw std::out_of_range("dense output has no row " + std::to_string(row));
+    Vector<D> velocity;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        const double v0 = w.begin->velocity[axis][row];
+        const double v1 = w.end->velocity[axis][row];
+        velocity[axis] = v0 + (v1 - v0) * w.toEnd
+            + w.h * w.fromStart * w.begin->acceleration[axis][row]
+            + w.h * w.fromEnd * w.end->acceleration[axis][row];
+    }
+    return velocity;
+}
+
+/**
+ *  Fills position and velocity with the columns of every body at time,
+ *  reusing their capacity. Throws std::out_of_range if the time is not
+ *  covered.
+ */
+template <uint32_t D>
+void BasicDenseOutput<D>::interpolate(double time, Columns& position, Columns& velocity) const
+{
+    const Weights w = locate(time);
+    const size_t rows = getBodyCount();
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        position[axis].resize(rows);
+        velocity[axis].resize(rows);
+        const double* q0 = w.begin->position[axis].data();
+        const double* q1 = w.end->position[axis].data();
+        const double* v0 = w.begin->velocity[axis].data();
+        const double* v1 = w.end->velocity[axis].data();
+        const double* a0 = w.begin->acceleration[axis].data();
+        const double* a1 = w.end->acceleration[axis].data();
+        double* q = position[axis].data();
+        double* v = velocity[axis].data();
+        const double s0 = w.h * w.fromStart;
+        const double s1 = w.h * w.fromEnd;
+        for (size_t i = 0; i < rows; ++i) {
+            q[i] = q0[i] + (q1[i] - q0[i]) * w.toEnd + s0 * v0[i] + s1 * v1[i];
+            v[i] = v0[i] + (v1[i] - v0[i]) * w.toEnd + s0 * a0[i] + s1 * a1[i];
+        }
+    }
+}
+
+/**
+ *  Returns the i-th retained sample, the oldest first.
+ */
+template <uint32_t D>
+const typename BasicDenseOutput<D>::Sample& BasicDenseOutput<D>::sample(size_t i) const noexcept
+{
+    return samples[(first + i) % samples.size()];
+}
+
+/**
+ *  Finds the step containing time by binary search and returns its
+ *  weights. Throws std::out_of_range if the time is not covered.
+ */
+template <uint32_t D>
+typename BasicDenseOutput<D>::Weights BasicDenseOutput<D>::locate(double time) const
+{
+    if (!covers(time))
+        throw std::out_of_range("dense output does not cover time " + std::to_string(time));
+    if (count == 1)
+        return Weights { &sample(0), &sample(0), 0.0, 0.0, 0.0, 0.0 };
+    // Find the last step starting at or before time.
+    size_t low = 0;
+    size_t high = count - 1;
+    while (high - low > 1) {
+        const size_t middle = low + (high - low) / 2;
+        if (sample(middle).time <= time)
+            low = middle;
+        else
+            high = middle;
+    }
+    const Sample& begin = sample(low);
+    const Sample& end = sample(high);
+    const double h = end.time - begin.time;
+    const double s = (time - begin.time) / h;
+    const double s2 = s * s;
+    return Weights { &begin, &end, h, s2 * (3.0 - 2.0 * s), s * (1.0 - s) * (1.0 - s),
+        s2 * (s - 1.0) };
+}
+
+template class BasicDenseOutput<2>;
+template class BasicDenseOutput<3>;
+
+#endif
+// comment
@@ -0,0 +1,171 @@
+// File name: Diagnostics.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the conserved quantities of the simulation updated after every
+// step
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef DIAGNOSTICS_CPP
+#define DIAGNOSTICS_CPP
+#include "../include/Diagnostics.h"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+/**
+ *  Sweeps state once for the quantities at time after step steps, taking
+ *  the potential energy from the potential of every body if it is known.
+ */
+template <uint32_t D>
+void BasicDiagnostics<D>::update(const BodyStore& state,
+    const typename BodyStore::Column& potential, double time, uint64_t step)
+{
+    const size_t count = state.size();
+    if (!potential.empty() && potential.size() != count)
+        throw std::invalid_argument("diagnostics need one potential per body");
+
+    std::array<const double*, D> q;
+    std::array<const double*, D> v;
+    double origin[D] = {};
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        q[axis] = state.position[axis].data();
+        v[axis] = state.velocity[axis].data();
+        if (count > 0)
+            origin[axis] = q[axis][0];
+    }
+    const double* m = state.mass.data();
+    const double* phi = potential.empty() ? nullptr : potential.data();
+
+    double mass = 0.0;
+    double kinetic = 0.0;
+    double energy = 0.0;
+    double momentum[D] = {};
+    double moment[D] = {};
+    double angular[3] = {};
+    for (size_t i = 0; i < count; ++i) {
+        double r[3] = {};
+        double p[3] = {};
+        double speedSq = 0.0;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            r[axis] = q[axis][i] - origin[axis];
+            p[axis] = m[i] * v[axis][i];
+            speedSq += v[axis][i] * v[axis][i];
+            momentum[axis] += p[axis];
+            moment[axis] += m[i] * q[axis][i];
+        }
+        mass += m[i];
+        kinetic += 0.5 * m[i] * speedSq;
+        if (phi)
+            energy += m[i] * phi[i];
+        angular[0] += r[1] * p[2] - r[2] * p[1];
+        angular[1] += r[2] * p[0] - r[0] * p[2];
+        angular[2] += r[0] * p[1] - r[1] * p[0];
+    }
+
+    current.time = time;
+    current.step = step;
+    current.mass = mass;
+    current.kinetic = kinetic;
+    // Every pair appears in the potential of both of its bodies.
+    current.potential = phi || count == 0 ? 0.5 * energy : std::numeric_limits<double>::quiet_NaN();
+    current.energy = kinetic + current.potential;
+    current.momentum = Vector<D>(momentum);
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        moment[axis] = mass > 0.0 ? moment[axis] / mass : 0.0;
+    }
+    current.centerOfMass = Vector<D>(moment);
+    current.angularMomentum = vector3(angular);
+
+    if (updates++ == 0) {
+        initial = current;
+        maxEnergyDrift = 0.0;
+    }
+    // Once unknown the largest drift stays unknown.
+    const double drift = getEnergyDrift();
+    if (!std::isnan(maxEnergyDrift) && !(std::abs(drift) <= std::abs(maxEnergyDrift)))
+        maxEnergyDrift = drift;
+}
+
+/**
+ *  Forgets every update.
+ */
+template <uint32_t D> void BasicDiagnostics<D>::clear() noexcept
+{
+    initial = Quantities();
+    current = Quantities();
+    updates = 0;
+    maxEnergyDrift = 0.0;
+}
+
+/**
+ *  Returns the number of updates since the last clear.
+ */
+template <uint32_t D> uint64_t BasicDiagnostics<D>::getUpdates() const noexcept
+{
+    return updates;
+}
+
+/**
+ *  Returns the quantities of the last update.
+ */
+template <uint32_t D>
+const typename BasicDiagnostics<D>::Quantities& BasicDiagnostics<D>::getCurrent() const noexcept
+{
+    return current;
+}
+
+/**
+ *  Returns the quantities of the first update.
+ */
+template <uint32_t D>
+const typename BasicDiagnostics<D>::Quantities& BasicDiagnostics<D>::getInitial() const noexcept
+{
+    return initial;
+}
+
+/**
+ *  Returns the change of the energy since the first update relative to its
+ *  initial magnitude, or NaN if either energy is unknown.
+ */
+template <uint32_t D> double BasicDiagnostics<D>::getEnergyDrift() const noexcept
+{
+    if (std::isnan(initial.energy) || std::isnan(current.energy))
+        return std::numeric_limits<double>::quiet_NaN();
+    if (initial.energy == 0.0)
+        return current.energy == initial.energy ? 0.0 : std::numeric_limits<double>::infinity();
+    return (current.energy - initial.energy) / std::abs(initial.energy);
+}
+
+/**
+ *  Returns the relative energy drift largest in magnitude so far, or NaN if
+ *  any energy was unknown.
+ */
+template <uint32_t D> double BasicDiagnostics<D>::getMaxEnergyDrift() const noexcept
+{
+    return maxEnergyDrift;
+}
+
+/**
+ *  Returns the length of the change of the angular momentum since the first
+ *  update relative to its initial length.
+ */
+template <uint32_t D> double BasicDiagnostics<D>::getAngularMomentumDrift() const noexcept
+{
+    const double change = (current.angularMomentum - initial.angularMomentum).norm();
+    const double length = initial.angularMomentum.norm();
+    if (length == 0.0)
+        return change == 0.0 ? 0.0 : std::numeric_limits<double>::infinity();
+    return change / length;
+}
+
+template class BasicDiagnostics<2>;
+template class BasicDiagnostics<3>;
+
+#endif
+// comment
@@ -0,0 +1,440 @@
+// File name: FmmEngine.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements a fast multipole method force engine for the simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef FMM_ENGINE_CPP
+#define FMM_ENGINE_CPP
+#include "../include/FmmEngine.h"
+#include "../include/Trace.h"
+#include "../include/Universe.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Bounds the stack buffers used for powers and derivatives.
+const uint32_t maxOrder = 16;
+// Leaves beyond this depth would not fit the 32 bit cell indices comfortably.
+const uint32_t maxDepth = 12;
+}
+
+/**
+ *  Creates an engine with the given expansion order. The tree is refined
+ *  until the average leaf holds at most leafSize bodies.
+ */
+FmmEngine::FmmEngine(uint32_t order, uint32_t leafSize)
+    : order(0)
+    , leafSize(std::max<uint32_t>(leafSize, 1))
+    , terms(0)
+    , depth(0)
+    , size(0.0)
+{
+    setOrder(order);
+}
+
+/**
+ *  Returns the expansion order.
+ */
+uint32_t FmmEngine::getOrder() const noexcept
+{
+    return order;
+}
+
+/**
+ *  Sets the expansion order. Higher orders are slower but more accurate.
+ */
+void FmmEngine::setOrder(uint32_t order)
+{
+    this->order = std::min(std::max<uint32_t>(order, 1), maxOrder);
+    buildTerms();
+    touch();
+}
+
+/**
+ *  Rebuilds the index tables for the current order.
+ */
+void FmmEngine::buildTerms()
+{
+    terms = (order + 1) * (order + 2) / 2;
+    powerX.resize(terms);
+    powerY.resize(terms);
+    for (uint32_t a = 0; a <= order; ++a) {
+        for (uint32_t b = 0; a + b <= order; ++b) {
+            powerX[term(a, b)] = a;
+            powerY[term(a, b)] = b;
+        }
+    }
+}
+
+/**
+ *  Returns the index of the coefficient for x^a y^b. Coefficients are grouped
+ *  by total degree.
+ */
+uint32_t FmmEngine::term(uint32_t a, uint32_t b) const noexcept
+{
+    return (a + b) * (a + b + 1) / 2 + b;
+}
+
+/**
+ *  Fills out[term(a, b)] with the derivative d^a/dx^a d^b/dy^b of 1/r
+ *  evaluated at r for every a + b <= order.
+ *
+ *  Uses the Hermite recurrence on f_n = (1/r d/dr)^n (1/r):
+ *  R(n; t + 1, u) = t R(n + 1; t - 1, u) + x R(n + 1; t, u), likewise for y.
+ */
+void FmmEngine::derivatives(const vector2& r, double* out) const
+{
+    const uint32_t stride = maxOrder + 1;
+    double tables[2][stride * stride];
+    const double x = r[0];
+    const double y = r[1];
+    const double distSq = x * x + y * y;
+
+    double radial[maxOrder + 1];
+    radial[0] = 1.0 / std::sqrt(distSq);
+    for (uint32_t n = 1; n <= order; ++n) {
+        radial[n] = -(2.0 * n - 1.0) * radial[n - 1] / distSq;
+    }
+
+    double* prev = tables[0];
+    double* cur = tables[1];
+    cur[0] = radial[order];
+    for (int n = static_cast<int>(order) - 1; n >= 0; --n) {
+        std::swap(prev, cur);
+        cur[0] = radial[n];
+        for (uint32_t total = 1; total + n <= order; ++total) {
+            for (uint32_t t = 0; t <= total; ++t) {
+                uint32_t u = total - t;
+                double value;
+                if (t >= 1) {
+                    value = x * prev[(t - 1) * stride + u];
+                    if (t >= 2)
+                        value += (t - 1) * prev[(t - 2) * stride + u];
+                } else {
+                    value = y * prev[u - 1];
+                    if (u >= 2)
+                        value += (u - 1) * prev[u - 2];
+                }
+                cur[t * stride + u] = value;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < terms; ++i) {
+        out[i] = cur[powerX[i] * stride + powerY[i]];
+    }
+}
+
+/**
+ *  Fills out[term(a, b)] with d^a d^b / (a! b!) for every a + b <= order.
+ */
+void FmmEngine::scaledPowers(const vector2& d, double* out) const
+{
+    double px[maxOrder + 1];
+    double py[maxOrder + 1];
+    px[0] = 1.0;
+    py[0] = 1.0;
+    for (uint32_t n = 1; n <= order; ++n) {
+        px[n] = px[n - 1] * d[0] / n;
+        py[n] = py[n - 1] * d[1] / n;
+    }
+    for (uint32_t i = 0; i < terms; ++i) {
+        out[i] = px[powerX[i]] * py[powerY[i]];
+    }
+}
+
+/**
+ *  Returns the centre of cell (ix, iy) at the given level.
+ */
+vector2 FmmEngine::cellCenter(uint32_t level, uint32_t ix, uint32_t iy) const noexcept
+{
+    double width = size / (1u << level);
+    vector2 center = origin;
+    center[0] += (ix + 0.5) * width;
+    center[1] += (iy + 0.5) * width;
+    return center;
+}
+
+/**
+ *  Runs the upward, interaction and downward passes for every body.
+ */
+void FmmEngine::computeAccelerations(
+    const BodyStore& bodies, Accelerations& acc, ThreadPool& /* pool */)
+{
+    TRACE_SCOPE("FmmEngine::computeAccelerations");
+    const size_t count = bodies.size();
+    acc[0].resize(count);
+    acc[1].resize(count);
+    if (count == 0)
+        return;
+
+    const BodyStore::Column& px = bodies.position[0];
+    const BodyStore::Column& py = bodies.position[1];
+    auto rangeX = std::minmax_element(px.begin(), px.end());
+    auto rangeY = std::minmax_element(py.begin(), py.end());
+    double extent = std::max(*rangeX.second - *rangeX.first, *rangeY.second - *rangeY.first);
+    // Pad the root slightly so that bodies on the upper edge fall strictly inside.
+    size = extent > 0.0 ? extent * (1.0 + 1e-9) : 1.0;
+    origin[0] = (*rangeX.first + *rangeX.second - size) * 0.5;
+    origin[1] = (*rangeY.first + *rangeY.second - size) * 0.5;
+
+    depth = 0;
+    while (depth < maxDepth && (size_t(1) << (2 * depth)) * leafSize < count) {
+        ++depth;
+    }
+
+    sortBodies(bodies);
+    upwardPass();
+    interactionPass();
+    downwardPass();
+    evaluate(acc);
+}
+
+/**
+ *  Bins bodies into leaves, sorting a copy of the columns by leaf.
+ */
+void FmmEngine::sortBodies(const BodyStore& bodies)
+{
+    TRACE_SCOPE("FmmEngine::sortBodies");
+    const size_t count = bodies.size();
+    const uint32_t side = 1u << depth;
+    const double scale = side / size;
+    leafOf.resize(count);
+    leafStart.assign(side * side + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t ix = std::min(
+            side - 1, static_cast<uint32_t>((bodies.position[0][i] - origin[0]) * scale));
+        uint32_t iy = std::min(
+            side - 1, static_cast<uint32_t>((bodies.position[1][i] - origin[1]) * scale));
+        leafOf[i] = iy * side + ix;
+        ++leafStart[leafOf[i] + 1];
+    }
+    for (uint32_t c = 0; c < side * side; ++c) {
+        leafStart[c + 1] += leafStart[c];
+    }
+
+    sortedX.resize(count);
+    sortedY.resize(count);
+    sortedMass.resize(count);
+    sortedIndex.resize(count);
+    cursor.assign(leafStart.begin(), leafStart.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t slot = cursor[leafOf[i]]++;
+        sortedX[slot] = bodies.position[0][i];
+        sortedY[slot] = bodies.position[1][i];
+        sortedMass[slot] = bodies.mass[i];
+        sortedIndex[slot] = static_cast<uint32_t>(i);
+    }
+}
+
+/**
+ *  Builds multipoles at the leaves and shifts them up to every level.
+ */
+void FmmEngine::upwardPass()
+{
+    TRACE_SCOPE("FmmEngine::upwardPass");
+    multipoles.resize(depth + 1);
+    for (uint32_t level = 0; level <= depth; ++level) {
+        size_t cells = size_t(1) << (2 * level);
+        multipoles[level].assign(cells * terms, 0.0);
+    }
+
+    // Particle to multipole: M(k) = sum of m d^k / k! about the leaf centre.
+    double powers[(maxOrder + 1) * (maxOrder + 2) / 2];
+    const uint32_t side = 1u << depth;
+    for (uint32_t iy = 0; iy < side; ++iy) {
+        for (uint32_t ix = 0; ix < side; ++ix) {
+            uint32_t cell = iy * side + ix;
+            vector2 center = cellCenter(depth, ix, iy);
+            double* m = &multipoles[depth][cell * terms];
+            for (uint32_t body = leafStart[cell]; body < leafStart[cell + 1]; ++body) {
+                vector2 d;
+                d[0] = sortedX[body] - center[0];
+                d[1] = sortedY[body] - center[1];
+                scaledPowers(d, powers);
+                for (uint32_t k = 0; k < terms; ++k) {
+                    m[k] += sortedMass[body] * powers[k];
+                }
+            }
+        }
+    }
+
+    // Multipole to multipole: M'(k) = sum over j <= k of M(j) d^(k - j) / (k - j)!.
+    for (uint32_t level = depth; level >= 1; --level) {
+        const uint32_t childSide = 1u << level;
+        for (uint32_t iy = 0; iy < childSide; ++iy) {
+            for (uint32_t ix = 0; ix < childSide; ++ix) {
+                const double* child = &multipoles[level][(iy * childSide + ix) * terms];
+                double* parent
+                    = &multipoles[level - 1][((iy / 2) * (childSide / 2) + ix / 2) * terms];
+                scaledPowers(
+                    cellCenter(level, ix, iy) - cellCenter(level - 1, ix / 2, iy / 2), powers);
+                for (uint32_t k = 0; k < terms; ++k) {
+                    double sum = 0.0;
+                    for (uint32_t ja = 0; ja <= powerX[k]; ++ja) {
+                        for (uint32_t jb = 0; jb <= powerY[k]; ++jb) {
+                            sum += child[term(ja, jb)]
+                                * powers[term(powerX[k] - ja, powerY[k] - jb)];
+                        }
+                    }
+                    parent[k] += sum;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  Converts multipoles of well-separated cells into local expansions. The
+ *  interaction list of a cell holds the children of its parent's neighbours
+ *  that are not adjacent to the cell itself.
+ */
+void FmmEngine::interactionPass()
+{
+    TRACE_SCOPE("FmmEngine::interactionPass");
+    locals.resize(depth + 1);
+    for (uint32_t level = 0; level <= depth; ++level) {
+        size_t cells = size_t(1) << (2 * level);
+        locals[level].assign(cells * terms, 0.0);
+    }
+
+    double derivs[(maxOrder + 1) * (maxOrder + 2) / 2];
+    for (uint32_t level = 2; level <= depth; ++level) {
+        const int side = 1 << level;
+        const double width = size / side;
+        for (int iy = 0; iy < side; ++iy) {
+            for (int ix = 0; ix < side; ++ix) {
+                double* local = &locals[level][(iy * side + ix) * terms];
+                int minX = std::max(0, (ix / 2 - 1) * 2);
+                int maxX = std::min(side - 1, (ix / 2 + 1) * 2 + 1);
+                int minY = std::max(0, (iy / 2 - 1) * 2);
+                int maxY = std::min(side - 1, (iy / 2 + 1) * 2 + 1);
+                for (int sy = minY; sy <= maxY; ++sy) {
+                    for (int sx = minX; sx <= maxX; ++sx) {
+                        if (std::abs(sx - ix) <= 1 && std::abs(sy - iy) <= 1)
+                            continue;
+                        const double* m = &multipoles[level][(sy * side + sx) * terms];
+                        vector2 r;
+                        r[0] = (ix - sx) * width;
+                        r[1] = (iy - sy) * width;
+                        derivatives(r, derivs);
+                        // L(n) = sum of (-1)^|k| M(k) D(n + k) over |n| + |k| <= order.
+                        for (uint32_t n = 0; n < terms; ++n) {
+                            const uint32_t na = powerX[n];
+                            const uint32_t nb = powerY[n];
+                            double sum = 0.0;
+                            for (uint32_t k = 0; k < terms; ++k) {
+                                const uint32_t ka = powerX[k];
+                                const uint32_t kb = powerY[k];
+                                if (na + nb + ka + kb > order)
+                                    break;
+                                double contribution = m[k] * derivs[term(na + ka, nb + kb)];
+                                sum += (ka + kb) % 2 ? -contribution : contribution;
+                            }
+                            local[n] += sum;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  Shifts local expansions down to the leaves:
+ *  L'(n) = sum of L(n + k) d^k / k! over |n + k| <= order.
+ */
+void FmmEngine::downwardPass()
+{
+    TRACE_SCOPE("FmmEngine::downwardPass");
+    double powers[(maxOrder + 1) * (maxOrder + 2) / 2];
+    for (uint32_t level = 2; level < depth; ++level) {
+        const uint32_t childSide = 1u << (level + 1);
+        for (uint32_t iy = 0; iy < childSide; ++iy) {
+            for (uint32_t ix = 0; ix < childSide; ++ix) {
+                const double* parent
+                    = &locals[level][((iy / 2) * (childSide / 2) + ix / 2) * terms];
+                double* child = &locals[level + 1][(iy * childSide + ix) * terms];
+                scaledPowers(
+                    cellCenter(level + 1, ix, iy) - cellCenter(level, ix / 2, iy / 2), powers);
+                for (uint32_t n = 0; n < terms; ++n) {
+                    const uint32_t na = powerX[n];
+                    const uint32_t nb = powerY[n];
+                    double sum = 0.0;
+                    for (uint32_t k = 0; k < terms; ++k) {
+                        if (na + nb + powerX[k] + powerY[k] > order)
+                            break;
+                        sum += parent[term(na + powerX[k], nb + powerY[k])] * powers[k];
+                    }
+                    child[n] += sum;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  Evaluates local expansions and direct near-field sums at the bodies.
+ */
+void FmmEngine::evaluate(Accelerations& acc)
+{
+    TRACE_SCOPE("FmmEngine::evaluate");
+    double powers[(maxOrder + 1) * (maxOrder + 2) / 2];
+    const int side = 1 << depth;
+    for (int iy = 0; iy < side; ++iy) {
+        for (int ix = 0; ix < side; ++ix) {
+            const uint32_t cell = iy * side + ix;
+            const double* local = &locals[depth][cell * terms];
+            const vector2 center = cellCenter(depth, ix, iy);
+            for (uint32_t body = leafStart[cell]; body < leafStart[cell + 1]; ++body) {
+                const double x = sortedX[body];
+                const double y = sortedY[body];
+
+                // Far field: the gradient of the local expansion.
+                double sumX = 0.0;
+                double sumY = 0.0;
+                if (depth >= 2) {
+                    vector2 d;
+                    d[0] = x - center[0];
+                    d[1] = y - center[1];
+                    scaledPowers(d, powers);
+                    for (uint32_t n = 0; n < terms; ++n) {
+                        const uint32_t na = powerX[n];
+                        const uint32_t nb = powerY[n];
+                        if (na >= 1)
+                            sumX += local[n] * powers[term(na - 1, nb)];
+                        if (nb >= 1)
+                            sumY += local[n] * powers[term(na, nb - 1)];
+                    }
+                }
+
+                // Near field: direct sums over this leaf and its neighbours.
+                for (int ny = std::max(0, iy - 1); ny <= std::min(side - 1, iy + 1); ++ny) {
+                    for (int nx = std::max(0, ix - 1); nx <= std::min(side - 1, ix + 1); ++nx) {
+                        const uint32_t other = ny * side + nx;
+                        for (uint32_t j = leafStart[other]; j < leafStart[other + 1]; ++j) {
+                            double dx = sortedX[j] - x;
+                            double dy = sortedY[j] - y;
+                            double distSq = dx * dx + dy * dy;
+                            if (distSq == 0.0)
+                                continue;
+                            double scale = sortedMass[j] / (distSq * std::sqrt(distSq));
+                            sumX += scale * dx;
+                            sumY += scale * dy;
+                        }
+                    }
+                }
+                acc[0][sortedIndex[body]] = Universe::G * sumX;
+                acc[1][sortedIndex[body]] = Universe::G * sumY;
+            }
+        }
+    }
+}
+
+#endif
+// comment
\ No newline at end of file
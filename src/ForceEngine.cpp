@@ -0,0 +1,265 @@
+// File name: ForceEngine.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the direct summation force engine used by the Universe to
+// evaluate gravity
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef FORCE_ENGINE_CPP
+#define FORCE_ENGINE_CPP
+#include "../include/ForceEngine.h"
+#include "../include/Trace.h"
+#include "../include/Universe.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ *  Makes every later evaluation of an engine that computesPotentials also
+ *  fill potential, or stops if it is null.
+ */
+template <uint32_t D> void BasicForceEngine<D>::setPotentials(Potentials* potential) noexcept
+{
+    this->potential = potential;
+    touch();
+}
+
+/**
+ *  Returns false: engines computing potentials say so.
+ */
+template <uint32_t D> bool BasicForceEngine<D>::computesPotentials() const noexcept
+{
+    return false;
+}
+
+/**
+ *  Returns true if the potentials given hold those of state as computed by
+ *  the last evaluation with the current parameters.
+ */
+template <uint32_t D>
+bool BasicForceEngine<D>::hasPotentials(const BasicBodyStore<D>& state) const noexcept
+{
+    return potential && potentialState == state.getGeneration()
+        && potentialEngine == generation;
+}
+
+/**
+ *  Returns the generation of the parameters, renewed by every setter.
+ */
+template <uint32_t D> uint64_t BasicForceEngine<D>::getGeneration() const noexcept
+{
+    return generation;
+}
+
+/**
+ *  Renews the generation after a parameter changed.
+ */
+template <uint32_t D> void BasicForceEngine<D>::touch() noexcept
+{
+    generation = nextGeneration();
+}
+
+/**
+ *  Resizes the potentials to the number of bodies and returns them to be
+ *  filled for bodies, or returns null if there are none to fill.
+ */
+template <uint32_t D>
+double* BasicForceEngine<D>::preparePotentials(const BasicBodyStore<D>& bodies)
+{
+    if (!potential || !computesPotentials())
+        return nullptr;
+    potential->resize(bodies.size());
+    potentialState = bodies.getGeneration();
+    potentialEngine = generation;
+    return potential->data();
+}
+
+/**
+ *  Sums the contribution of every other body for each body.
+ */
+template <uint32_t D>
+void BasicDirectEngine<D>::computeAccelerations(
+    const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool)
+{
+    TRACE_SCOPE("DirectEngine::computeAccelerations");
+    const size_t count = bodies.size();
+    std::array<const double*, D> pos;
+    std::array<double*, D> out;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        acc[axis].resize(count);
+        pos[axis] = bodies.position[axis].data();
+        out[axis] = acc[axis].data();
+    }
+    double* phi = this->preparePotentials(bodies);
+    const double* mass = bodies.mass.data();
+    // Hand each worker enough rows to outweigh the cost of waking it.
+    const size_t minRows = std::max<size_t>(1, 32768 / std::max<size_t>(count, 1));
+    pool.parallelFor(count, minRows, [=](size_t begin, size_t end, uint32_t) {
+        for (size_t i = begin; i < end; ++i) {
+            double sum[D] = {};
+            // G m / r is scale * distSq; summing it costs one operation a pair.
+            double energy = 0.0;
+            for (size_t j = 0; j < count; ++j) {
+                double d[D];
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    d[axis] = pos[axis][j] - pos[axis][i];
+                }
+                double distSq = d[0] * d[0];
+                for (uint32_t axis = 1; axis < D; ++axis) {
+                    distSq += d[axis] * d[axis];
+                }
+                // Skips i == j as well as coincident bodies, whose direction is undefined.
+                if (distSq == 0.0)
+                    continue;
+                double scale = BasicUniverse<D>::G * mass[j] / (distSq * std::sqrt(distSq));
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    sum[axis] += scale * d[axis];
+                }
+                energy -= scale * distSq;
+            }
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                out[axis][i] = sum[axis];
+            }
+            if (phi)
+                phi[i] = energy;
+        }
+    });
+}
+
+/**
+ *  Returns true: the potentials are summed over the same pairs.
+ */
+template <uint32_t D> bool BasicDirectEngine<D>::computesPotentials() const noexcept
+{
+    return true;
+}
+
+/**
+ *  Sums every unordered pair once.
+ */
+template <uint32_t D>
+void BasicSymmetricEngine<D>::computeAccelerations(
+    const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool)
+{
+    TRACE_SCOPE("SymmetricEngine::computeAccelerations");
+    const size_t count = bodies.size();
+    // Private columns only pay off once the pair loop outweighs the reduction.
+    const uint32_t workers = count < 512 ? 1 : pool.size();
+    std::array<const double*, D> pos;
+    std::array<double*, D> sums;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        acc[axis].resize(count);
+        pos[axis] = bodies.position[axis].data();
+        sums[axis] = acc[axis].data();
+        if (workers > 1) {
+            partial[axis].resize(workers * count);
+            sums[axis] = partial[axis].data();
+        }
+    }
+    double* const phi = this->preparePotentials(bodies);
+    double* phiSums = phi;
+    if (phi && workers > 1) {
+        partialPotential.resize(workers * count);
+        phiSums = partialPotential.data();
+    }
+
+    const double* mass = bodies.mass.data();
+    pool.run(workers, [=](uint32_t worker) {
+        double* own[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            own[axis] = sums[axis] + worker * count;
+            std::fill(own[axis], own[axis] + count, 0.0);
+        }
+        double* ownPhi = phiSums ? phiSums + worker * count : nullptr;
+        if (ownPhi)
+            std::fill(ownPhi, ownPhi + count, 0.0);
+        for (size_t i = worker; i < count; i += workers) {
+            double at[D];
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                at[axis] = pos[axis][i];
+            }
+            const double mi = mass[i];
+            double sum[D] = {};
+            double energy = 0.0;
+            for (size_t j = i + 1; j < count; ++j) {
+                double d[D];
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    d[axis] = pos[axis][j] - at[axis];
+                }
+                double distSq = d[0] * d[0];
+                for (uint32_t axis = 1; axis < D; ++axis) {
+                    distSq += d[axis] * d[axis];
+                }
+                // Coincident bodies have no defined direction.
+                if (distSq == 0.0)
+                    continue;
+                double scale = BasicUniverse<D>::G / (distSq * std::sqrt(distSq));
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    sum[axis] += scale * mass[j] * d[axis];
+                    own[axis][j] -= scale * mi * d[axis];
+                }
+                if (ownPhi) {
+                    const double inverse = scale * distSq;
+                    energy -= inverse * mass[j];
+                    ownPhi[j] -= inverse * mi;
+                }
+            }
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                own[axis][i] += sum[axis];
+            }
+            if (ownPhi)
+                ownPhi[i] += energy;
+        }
+    });
+
+    if (workers > 1) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            double* out = acc[axis].data();
+            const double* columns = sums[axis];
+            pool.parallelFor(count, 4096, [=](size_t begin, size_t end, uint32_t) {
+                for (size_t i = begin; i < end; ++i) {
+                    double total = 0.0;
+                    for (uint32_t worker = 0; worker < workers; ++worker) {
+                        total += columns[worker * count + i];
+                    }
+                    out[i] = total;
+                }
+            });
+        }
+        if (phi) {
+            double* out = phi;
+            const double* columns = phiSums;
+            pool.parallelFor(count, 4096, [=](size_t begin, size_t end, uint32_t) {
+                for (size_t i = begin; i < end; ++i) {
+                    double total = 0.0;
+                    for (uint32_t worker = 0; worker < workers; ++worker) {
+                        total += columns[worker * count + i];
+                    }
+                    out[i] = total;
+                }
+            });
+        }
+    }
+}
+
+/**
+ *  Returns true: the potentials are summed over the same pairs.
+ */
+template <uint32_t D> bool BasicSymmetricEngine<D>::computesPotentials() const noexcept
+{
+    return true;
+}
+
+template class BasicForceEngine<2>;
+template class BasicForceEngine<3>;
+template class BasicDirectEngine<2>;
+template class BasicDirectEngine<3>;
+template class BasicSymmetricEngine<2>;
+template class BasicSymmetricEngine<3>;
+
+#endif
+// comment
\ No newline at end of file
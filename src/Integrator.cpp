@@ -0,0 +1,222 @@
+// File name: Integrator.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the time integration schemes used by the Universe to move the
+// bodies
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef INTEGRATOR_CPP
+#define INTEGRATOR_CPP
+#include "../include/Integrator.h"
+#include <cmath>
+
+/**
+ *  Returns the accelerations at the current state, evaluating them only if
+ *  the generation of the positions and masses or of the engine differs
+ *  from the last evaluation.
+ */
+template <uint32_t D>
+const typename BasicForceEngine<D>::Accelerations& BasicIntegrator<D>::accelerate(
+    const BodyStore& state, ForceEngine& engine, ThreadPool& pool)
+{
+    if (evaluatedState == state.getGeneration() && evaluatedEngine == engine.getGeneration())
+        return acceleration;
+    engine.computeAccelerations(state, acceleration, pool);
+    evaluations += state.size();
+    evaluatedState = state.getGeneration();
+    evaluatedEngine = engine.getGeneration();
+    return acceleration;
+}
+
+/**
+ *  Returns the number of times the acceleration of a single body has been
+ *  evaluated so far. A full evaluation of N bodies counts N.
+ */
+template <uint32_t D> uint64_t BasicIntegrator<D>::getEvaluations() const noexcept
+{
+    return evaluations;
+}
+
+/**
+ *  Returns the accelerations at state, evaluating them only if they are not
+ *  those of the last evaluation.
+ */
+template <uint32_t D>
+const typename BasicForceEngine<D>::Accelerations& BasicIntegrator<D>::getAccelerations(
+    const BodyStore& state, ForceEngine& engine, ThreadPool& pool)
+{
+    return accelerate(state, engine, pool);
+}
+
+/**
+ *  Takes acc as the accelerations engine evaluates at state.
+ */
+template <uint32_t D>
+void BasicIntegrator<D>::seedAccelerations(const BodyStore& state, const ForceEngine& engine,
+    const typename ForceEngine::Accelerations& acc)
+{
+    acceleration = acc;
+    evaluatedState = state.getGeneration();
+    evaluatedEngine = engine.getGeneration();
+}
+
+/**
+ *  Adds h times the velocity to the position of every movable body.
+ */
+template <uint32_t D> void BasicIntegrator<D>::drift(BodyStore& state, double h, ThreadPool& pool)
+{
+    if (state.size() < 2)
+        return;
+    std::array<double*, D> q;
+    std::array<const double*, D> v;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        q[axis] = state.position[axis].data();
+        v[axis] = state.velocity[axis].data();
+    }
+    // Row 0 is the fixed sun, so the update covers rows [1, count).
+    pool.parallelFor(state.size() - 1, 16384, [=](size_t begin, size_t end, uint32_t) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            for (size_t i = begin + 1; i < end + 1; ++i) {
+                q[axis][i] += v[axis][i] * h;
+            }
+        }
+    });
+    state.touch();
+}
+
+/**
+ *  Adds h times the last accelerations to the velocity of every movable
+ *  body.
+ */
+template <uint32_t D> void BasicIntegrator<D>::kick(BodyStore& state, double h, ThreadPool& pool)
+{
+    if (state.size() < 2)
+        return;
+    std::array<double*, D> v;
+    std::array<const double*, D> a;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        v[axis] = state.velocity[axis].data();
+        a[axis] = acceleration[axis].data();
+    }
+    pool.parallelFor(state.size() - 1, 16384, [=](size_t begin, size_t end, uint32_t) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            for (size_t i = begin + 1; i < end + 1; ++i) {
+                v[axis][i] += a[axis][i] * h;
+            }
+        }
+    });
+    state.touchVelocity();
+}
+
+/**
+ *  Performs one kick-drift-kick leapfrog step of h seconds.
+ */
+template <uint32_t D>
+void BasicIntegrator<D>::kickDriftKick(
+    BodyStore& state, double h, ForceEngine& engine, ThreadPool& pool)
+{
+    accelerate(state, engine, pool);
+    kick(state, 0.5 * h, pool);
+    drift(state, h, pool);
+    accelerate(state, engine, pool);
+    kick(state, 0.5 * h, pool);
+}
+
+/**
+ *  Moves the positions, then the velocities, with the rates at the start.
+ */
+template <uint32_t D>
+void BasicEulerIntegrator<D>::step(
+    BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool)
+{
+    this->accelerate(state, engine, pool);
+    this->drift(state, timeSec, pool);
+    this->kick(state, timeSec, pool);
+}
+
+/**
+ *  Performs one kick-drift-kick step.
+ */
+template <uint32_t D>
+void BasicLeapfrogIntegrator<D>::step(
+    BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool)
+{
+    this->kickDriftKick(state, timeSec, engine, pool);
+}
+
+/**
+ *  Performs one velocity Verlet step.
+ */
+template <uint32_t D>
+void BasicVerletIntegrator<D>::step(
+    BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool)
+{
+    start = this->accelerate(state, engine, pool);
+    if (state.size() < 2)
+        return;
+    std::array<double*, D> q;
+    std::array<double*, D> v;
+    std::array<const double*, D> a;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        q[axis] = state.position[axis].data();
+        v[axis] = state.velocity[axis].data();
+        a[axis] = start[axis].data();
+    }
+    const double h = timeSec;
+    pool.parallelFor(state.size() - 1, 16384, [=](size_t begin, size_t end, uint32_t) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            for (size_t i = begin + 1; i < end + 1; ++i) {
+                q[axis][i] += (v[axis][i] + 0.5 * a[axis][i] * h) * h;
+            }
+        }
+    });
+    state.touch();
+
+    const typename ForceEngine::Accelerations& next = this->accelerate(state, engine, pool);
+    std::array<const double*, D> b;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        b[axis] = next[axis].data();
+    }
+    pool.parallelFor(state.size() - 1, 16384, [=](size_t begin, size_t end, uint32_t) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            for (size_t i = begin + 1; i < end + 1; ++i) {
+                v[axis][i] += 0.5 * (a[axis][i] + b[axis][i]) * h;
+            }
+        }
+    });
+    state.touchVelocity();
+}
+
+/**
+ *  Performs the three leapfrog sub-steps.
+ */
+template <uint32_t D>
+void BasicYoshidaIntegrator<D>::step(
+    BodyStore& state, double timeSec, ForceEngine& engine, ThreadPool& pool)
+{
+    static const double cbrt2 = std::cbrt(2.0);
+    static const double w1 = 1.0 / (2.0 - cbrt2);
+    static const double w0 = 1.0 - 2.0 * w1;
+    this->kickDriftKick(state, w1 * timeSec, engine, pool);
+    this->kickDriftKick(state, w0 * timeSec, engine, pool);
+    this->kickDriftKick(state, w1 * timeSec, engine, pool);
+}
+
+template class BasicIntegrator<2>;
+template class BasicIntegrator<3>;
+template class BasicEulerIntegrator<2>;
+template class BasicEulerIntegrator<3>;
+template class BasicLeapfrogIntegrator<2>;
+template class BasicLeapfrogIntegrator<3>;
+template class BasicVerletIntegrator<2>;
+template class BasicVerletIntegrator<3>;
+template class BasicYoshidaIntegrator<2>;
+template class BasicYoshidaIntegrator<3>;
+
+#endif
+// comment
@@ -11,9 +11,11 @@
 #ifndef OBJECT_CPP
 #define OBJECT_CPP
 #include "../include/Object.h"
+#include "../include/BodyStore.h"
 #include "../include/ObjectFactory.h"
 #include "../include/Universe.h"
 #include "../include/Visitor.h"
+#include <cmath>
 #include <iterator>
 #include <string>
 
@@ -21,18 +23,32 @@
  *  Initializes an object with the provided properties - really only called by
  * the ObjectFactory
  */
-Object ::Object(const std::string& name, double mass, const vector2& pos, const vector2& vel)
-    : name(name)
+template <uint32_t D>
+BasicObject<D>::BasicObject(
+    const std::string& name, double mass, const Vector<D>& pos, const Vector<D>& vel)
+    : store(nullptr)
+    , row(0)
+    , name(name)
     , mass(mass)
     , position(pos)
     , velocity(vel)
 {
 }
 
+/**
+ *  Turns this object into a view over the given row of store. The state
+ *  held by the object itself is ignored from then on.
+ */
+template <uint32_t D> void BasicObject<D>::bind(BasicBodyStore<D>* store, size_t row) noexcept
+{
+    this->store = store;
+    this->row = row;
+}
+
 /**
  *  An entry point for a visitor.
  */
-void Object ::accept(Visitor& visitor)
+template <uint32_t D> void BasicObject<D>::accept(BasicVisitor<D>& visitor)
 {
     return visitor.visit(*this);
 }
@@ -41,33 +57,39 @@ void Object ::accept(Visitor& visitor)
  *  Implementation of the prototype. Returns a dynamically allocated deep
  *  copy of this object.
  */
-Object* Object ::clone() const
+template <uint32_t D> BasicObject<D>* BasicObject<D>::clone() const
 {
-    Object* obj = new Object(name, mass, velocity, position);
+    BasicObject* obj = new BasicObject(getName(), getMass(), getPosition(), getVelocity());
     return obj;
 }
 
 /**
  *  Returns the mass.
  */
-double Object ::getMass() const noexcept
+template <uint32_t D> double BasicObject<D>::getMass() const noexcept
 {
+    if (store != nullptr)
+        return store->mass[row];
     return mass;
 }
 
 /**
  *  Returns the name.
  */
-std::string Object ::getName() const noexcept
+template <uint32_t D> std::string BasicObject<D>::getName() const noexcept
 {
+    if (store != nullptr)
+        return store->name[row];
     return name;
 }
 
 /**
  *  Returns the position vector.
  */
-vector2 Object ::getPosition() const noexcept
+template <uint32_t D> Vector<D> BasicObject<D>::getPosition() const noexcept
 {
+    if (store != nullptr)
+        return store->getPosition(row);
     return position;
 }
 
@@ -76,8 +98,10 @@ vector2 Object ::getPosition() const noexcept
  */
 //* The velocity of an object equals the change in its position divided by the corresponding change
 // in time.
-vector2 Object ::getVelocity() const noexcept
+template <uint32_t D> Vector<D> BasicObject<D>::getVelocity() const noexcept
 {
+    if (store != nullptr)
+        return store->getVelocity(row);
     return velocity;
 }
 
@@ -89,40 +113,47 @@ vector2 Object ::getVelocity() const noexcept
  *  G times the mass of the first times the mass of the second
  *  divided by the square of the distance between the two.
  */
-vector2 Object ::getForce(const Object& rhs) const noexcept
+template <uint32_t D> Vector<D> BasicObject<D>::getForce(const BasicObject& rhs) const noexcept
 {
-    double numerator = ((Universe::G)*mass * rhs.mass);
-    double denominator = (rhs.position - position).normSq();
-    double fMag = numerator / denominator;
-    vector2 direction = (rhs.position - position).normalize();
-    return direction.scale(fMag);
+    // Scaling the offset by 1 / r^3 folds the normalization into the
+    // magnitude: one subtraction, one square root and one division.
+    Vector<D> offset = rhs.getPosition() - getPosition();
+    double distSq = offset.normSq();
+    double fMag = ((BasicUniverse<D>::G)*getMass() * rhs.getMass()) / (distSq * std::sqrt(distSq));
+    return offset.scale(fMag);
 }
 
 /**
  *  Sets the position vector.
  */
-void Object ::setPosition(const vector2& pos)
+template <uint32_t D> void BasicObject<D>::setPosition(const Vector<D>& pos)
 {
-    position = pos;
+    if (store != nullptr)
+        store->setPosition(row, pos);
+    else
+        position = pos;
 }
 
 /**
  *  Sets the velocity vector.
  */
-void Object ::setVelocity(const vector2& vel)
+template <uint32_t D> void BasicObject<D>::setVelocity(const Vector<D>& vel)
 {
-    velocity = vel;
+    if (store != nullptr)
+        store->setVelocity(row, vel);
+    else
+        velocity = vel;
 }
 
 /**
  *  Returns true if this object is member-wise equal to rhs.
  */
-bool Object ::operator==(const Object& rhs) const
+template <uint32_t D> bool BasicObject<D>::operator==(const BasicObject& rhs) const
 {
-    if (position == rhs.position)
-        if (velocity == rhs.velocity)
-            if (abs(mass - rhs.mass) < 0.001)
-                if (name == rhs.name)
+    if (getPosition() == rhs.getPosition())
+        if (getVelocity() == rhs.getVelocity())
+            if (std::abs(getMass() - rhs.getMass()) < 0.001)
+                if (getName() == rhs.getName())
                     return true;
     return false;
 }
@@ -130,10 +161,13 @@ bool Object ::operator==(const Object& rhs) const
 /**
  *  Returns !(*this == rhs).
  */
-bool Object ::operator!=(const Object& rhs) const
+template <uint32_t D> bool BasicObject<D>::operator!=(const BasicObject& rhs) const
 {
     return !(*this == rhs);
 }
 
+template class BasicObject<2>;
+template class BasicObject<3>;
+
 #endif
 // comment
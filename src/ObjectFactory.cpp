@@ -19,15 +19,19 @@
 /**
  *  Creates an object with the provided parameters. Default values of zero
  *  will be assigned to everything except for name.  Also adds the object to
- * the singleton Universe
+ * the singleton Universe of the same dimension
  */
-Object* ObjectFactory ::makeObject(
-    std::string name, double mass, const vector2& pos, const vector2& vel)
+template <uint32_t D>
+BasicObject<D>* BasicObjectFactory<D>::makeObject(
+    std::string name, double mass, const Vector<D>& pos, const Vector<D>& vel)
 {
-    Object* tmp = new Object(name, mass, pos, vel);
-    Universe* insta = Universe::inst;
+    BasicObject<D>* tmp = new BasicObject<D>(name, mass, pos, vel);
+    BasicUniverse<D>* insta = BasicUniverse<D>::inst;
     insta->addObject(tmp);
     return tmp;
 }
+
+template class BasicObjectFactory<2>;
+template class BasicObjectFactory<3>;
 #endif
 // comment
\ No newline at end of file
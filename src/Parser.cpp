@@ -11,8 +11,13 @@
 #ifndef PARSER_CPP
 #define PARSER_CPP
 #include "../include/Parser.h"
+#include "../include/ObjectFactory.h"
+#include "../include/Trace.h"
+#include "../include/Vector.h"
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -22,10 +27,44 @@
  *  Loads the script file and configures the Universe. Consult the
  *  assignment README.md for the syntax of the scripts.
  */
-void Parser ::loadFile(const char* filename)
+template <uint32_t D> void BasicParser<D>::loadFile(const char* filename)
 {
+    TRACE_SCOPE("Parser::loadFile");
     std::ifstream read(filename);
+    std::string line;
+    while (std::getline(read, line)) {
+        std::vector<char> buffer(line.begin(), line.end());
+        buffer.push_back('\0');
+        // Lines without a name are blank or malformed and are skipped.
+        const char* name = std::strtok(buffer.data(), delims());
+        if (name == nullptr)
+            continue;
+        std::string objectName(name);
+        double mass = getDouble();
+        Vector<D> position;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            position[axis] = getDouble();
+        }
+        Vector<D> velocity;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            velocity[axis] = getDouble();
+        }
+        BasicObjectFactory<D>::makeObject(objectName, mass, position, velocity);
+    }
 }
 
+/**
+ *  Returns the next token of the line being parsed as a double, or zero if
+ *  the line has no more tokens.
+ */
+template <uint32_t D> double BasicParser<D>::getDouble()
+{
+    const char* token = std::strtok(nullptr, delims());
+    return token == nullptr ? 0.0 : std::strtod(token, nullptr);
+}
+
+template class BasicParser<2>;
+template class BasicParser<3>;
+
 #endif
 // comment
\ No newline at end of file
@@ -0,0 +1,288 @@
+// File name: PerfCounters.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the hardware performance counters of the simulation phases
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef PERF_COUNTERS_CPP
+#define PERF_COUNTERS_CPP
+#include "../include/PerfCounters.h"
+#include "../include/Allocations.h"
+#include <cerrno>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char* const names[PerfCounters::COUNTERS] = { "cycles", "instructions", "L1d misses",
+    "LLC misses", "branch misses", "task clock", "allocations", "allocated bytes" };
+
+#ifdef __linux__
+/**
+ *  The perf event behind a counter.
+ */
+struct Event {
+    uint32_t type;
+    uint64_t config;
+};
+
+const Event events[PerfCounters::PERF_COUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+/**
+ *  What reading a counter returns with the read format used.
+ */
+struct Reading {
+    uint64_t value;
+    uint64_t enabled;
+    uint64_t running;
+};
+#endif
+
+const double nan = std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ *  Opens and starts every counter available to the calling thread, keeping
+ *  the reason the first one that is not failed, and enables tracking the
+ *  allocations.
+ */
+PerfCounters::PerfCounters()
+{
+    ::Allocations::enable();
+    fds.fill(-1);
+#ifdef __linux__
+    for (uint32_t counter = 0; counter < PERF_COUNTERS; ++counter) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[counter].type;
+        attr.config = events[counter].config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // User space only, which an unprivileged process may count by default.
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        long fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd >= 0)
+            fds[counter] = static_cast<int>(fd);
+        else if (error.empty())
+            error = std::string(names[counter]) + ": perf_event_open failed: "
+                + std::strerror(errno);
+    }
+#else
+    error = "performance counters need Linux perf_event_open";
+#endif
+}
+
+/**
+ *  Closes every counter and disables tracking the allocations.
+ */
+PerfCounters::~PerfCounters()
+{
+    ::Allocations::disable();
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0)
+            ::close(fd);
+    }
+#endif
+}
+
+/**
+ *  Returns true if counter could be opened, or for the allocations, if
+ *  every one is counted.
+ */
+bool PerfCounters::isAvailable(Counter counter) const noexcept
+{
+    if (counter >= PERF_COUNTERS)
+        return ::Allocations::isHooked();
+    return fds[counter] >= 0;
+}
+
+/**
+ *  Returns true if any counter of perf_event_open could be opened.
+ */
+bool PerfCounters::isAvailable() const noexcept
+{
+    for (int fd : fds) {
+        if (fd >= 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ *  Returns why the first unavailable counter could not be opened, or an
+ *  empty string if all of them are available.
+ */
+const std::string& PerfCounters::getError() const noexcept
+{
+    return error;
+}
+
+/**
+ *  Returns the count of every counter so far, scaled up for the time it was
+ *  not scheduled on the hardware. Unavailable counters read zero.
+ */
+PerfCounters::Values PerfCounters::read() const noexcept
+{
+    Values values {};
+    const ::Allocations::Counts allocations = ::Allocations::get();
+    values[Allocations] = allocations.allocations;
+    values[AllocatedBytes] = allocations.bytes;
+#ifdef __linux__
+    for (uint32_t counter = 0; counter < PERF_COUNTERS; ++counter) {
+        Reading reading;
+        if (fds[counter] < 0
+            || ::read(fds[counter], &reading, sizeof(reading)) != sizeof(reading)
+            || reading.running == 0)
+            continue;
+        values[counter] = reading.value;
+        // Counters sharing the hardware are multiplexed and scaled to the full time.
+        if (reading.running < reading.enabled)
+            values[counter] = static_cast<uint64_t>(static_cast<double>(reading.value)
+                * reading.enabled / reading.running);
+    }
+#endif
+    return values;
+}
+
+/**
+ *  Returns the name of counter.
+ */
+const char* PerfCounters::name(Counter counter) noexcept
+{
+    return names[counter];
+}
+
+/**
+ *  Creates empty statistics of the counters available in counters.
+ */
+PerfStats::PerfStats(const PerfCounters& counters)
+    : error(counters.getError())
+{
+    for (uint32_t counter = 0; counter < PerfCounters::COUNTERS; ++counter) {
+        available[counter] = counters.isAvailable(static_cast<Counter>(counter));
+    }
+}
+
+/**
+ *  Returns true if counter is counted.
+ */
+bool PerfStats::isAvailable(Counter counter) const noexcept
+{
+    return available[counter];
+}
+
+/**
+ *  Returns why the counters that are not counted are unavailable.
+ */
+const std::string& PerfStats::getError() const noexcept
+{
+    return error;
+}
+
+/**
+ *  Returns the number of steps counted.
+ */
+uint64_t PerfStats::getSteps() const noexcept
+{
+    return steps;
+}
+
+/**
+ *  Returns the counts of phase in the last step, or summed over every step
+ *  if cumulative.
+ */
+const PerfStats::Counts& PerfStats::getCounts(Phase phase, bool cumulative) const noexcept
+{
+    return cumulative ? total[phase] : last[phase];
+}
+
+/**
+ *  Returns numerator per denominator over phase, or NaN.
+ */
+double PerfStats::getRatio(
+    Counter numerator, Counter denominator, Phase phase, bool cumulative) const noexcept
+{
+    const Values& values = getCounts(phase, cumulative).values;
+    if (!available[numerator] || !available[denominator] || values[denominator] == 0)
+        return nan;
+    return static_cast<double>(values[numerator]) / values[denominator];
+}
+
+/**
+ *  Returns the instructions per cycle of phase, or NaN.
+ */
+double PerfStats::getIpc(Phase phase, bool cumulative) const noexcept
+{
+    return getRatio(PerfCounters::Instructions, PerfCounters::Cycles, phase, cumulative);
+}
+
+/**
+ *  Returns counter over phase per interaction the force engine evaluated in
+ *  the same step or steps, or NaN.
+ */
+double PerfStats::getPerInteraction(Counter counter, Phase phase, bool cumulative) const noexcept
+{
+    const uint64_t interactions = getCounts(Force, cumulative).interactions;
+    if (!available[counter] || interactions == 0)
+        return nan;
+    return static_cast<double>(getCounts(phase, cumulative).values[counter]) / interactions;
+}
+
+/**
+ *  Starts a step, forgetting the counts of the last one.
+ */
+void PerfStats::beginStep() noexcept
+{
+    last.fill(Counts());
+    ++steps;
+}
+
+/**
+ *  Adds a call of phase that counted delta over interactions pairs to the
+ *  last step and to the totals.
+ */
+void PerfStats::add(Phase phase, const Values& delta, uint64_t interactions) noexcept
+{
+    for (Counts* counts : { &last[phase], &total[phase] }) {
+        ++counts->calls;
+        counts->interactions += interactions;
+        for (uint32_t counter = 0; counter < PerfCounters::COUNTERS; ++counter) {
+            counts->values[counter] += delta[counter];
+        }
+    }
+}
+
+/**
+ *  Forgets every count.
+ */
+void PerfStats::reset() noexcept
+{
+    steps = 0;
+    last.fill(Counts());
+    total.fill(Counts());
+}
+
+#endif
+// comment
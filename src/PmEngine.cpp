@@ -0,0 +1,334 @@
+// File name: PmEngine.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements a particle-mesh force engine using an in-tree FFT for the
+// simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef PM_ENGINE_CPP
+#define PM_ENGINE_CPP
+#include "../include/PmEngine.h"
+#include "../include/Trace.h"
+#include "../include/Universe.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Keeps the padded grid and its kernel within a couple of gigabytes.
+const uint32_t maxGridSize = 4096;
+const double pi = 3.14159265358979323846;
+// Empty cells kept around the bodies so every stencil stays inside the grid.
+const uint32_t margin = 2;
+
+/**
+ *  Returns the first of the cells the scheme spreads a body at cell
+ *  coordinate u over along one axis, and fills their weights.
+ */
+inline int64_t stencil(PmEngine::Assignment assignment, double u, double* weight)
+{
+    switch (assignment) {
+    case PmEngine::Assignment::Ngp:
+        weight[0] = 1.0;
+        return static_cast<int64_t>(std::floor(u));
+    case PmEngine::Assignment::Cic: {
+        // Cell centres sit at half-integer coordinates.
+        double shifted = u - 0.5;
+        double first = std::floor(shifted);
+        double fraction = shifted - first;
+        weight[0] = 1.0 - fraction;
+        weight[1] = fraction;
+        return static_cast<int64_t>(first);
+    }
+    default: {
+        double cell = std::floor(u);
+        double offset = u - cell - 0.5;
+        weight[0] = 0.5 * (0.5 - offset) * (0.5 - offset);
+        weight[1] = 0.75 - offset * offset;
+        weight[2] = 0.5 * (0.5 + offset) * (0.5 + offset);
+        return static_cast<int64_t>(cell) - 1;
+    }
+    }
+}
+}
+
+/**
+ *  Creates an engine with a grid of gridSize by gridSize cells, rounded up
+ *  to a power of two.
+ */
+PmEngine::PmEngine(uint32_t gridSize, Assignment assignment)
+    : gridSize(0)
+    , assignment(assignment)
+{
+    setGridSize(gridSize);
+}
+
+/**
+ *  Returns the number of cells along each axis.
+ */
+uint32_t PmEngine::getGridSize() const noexcept
+{
+    return gridSize;
+}
+
+/**
+ *  Sets the number of cells along each axis, rounded up to a power of two
+ *  no smaller than 8.
+ */
+void PmEngine::setGridSize(uint32_t gridSize)
+{
+    uint32_t size = 8;
+    while (size < gridSize && size < maxGridSize) {
+        size <<= 1;
+    }
+    this->gridSize = size;
+    touch();
+}
+
+/**
+ *  Returns the assignment scheme.
+ */
+PmEngine::Assignment PmEngine::getAssignment() const noexcept
+{
+    return assignment;
+}
+
+/**
+ *  Sets the assignment scheme.
+ */
+void PmEngine::setAssignment(Assignment assignment) noexcept
+{
+    this->assignment = assignment;
+    touch();
+}
+
+/**
+ *  Assigns the masses, convolves and interpolates the field.
+ */
+void PmEngine::computeAccelerations(
+    const BodyStore& bodies, Accelerations& acc, ThreadPool& pool)
+{
+    TRACE_SCOPE("PmEngine::computeAccelerations");
+    const size_t count = bodies.size();
+    acc[0].assign(count, 0.0);
+    acc[1].assign(count, 0.0);
+    if (count == 0)
+        return;
+    if (kernelSize != gridSize)
+        buildKernel(pool);
+
+    const double* px = bodies.position[0].data();
+    const double* py = bodies.position[1].data();
+    const double* mass = bodies.mass.data();
+    auto boundsX = std::minmax_element(bodies.position[0].begin(), bodies.position[0].end());
+    auto boundsY = std::minmax_element(bodies.position[1].begin(), bodies.position[1].end());
+    const double extent
+        = std::max(*boundsX.second - *boundsX.first, *boundsY.second - *boundsY.first);
+    // Bodies that all coincide exert no defined force on each other.
+    if (!(extent > 0.0))
+        return;
+    const uint32_t n = gridSize;
+    const size_t m = 2 * static_cast<size_t>(n);
+    const double cell = extent / (n - 2 * margin);
+    const double originX = *boundsX.first - margin * cell;
+    const double originY = *boundsY.first - margin * cell;
+    const Assignment scheme = assignment;
+    const uint32_t points = static_cast<uint32_t>(scheme) + 1;
+
+    // Each worker assigns a contiguous range of bodies to a private grid.
+    const uint32_t workers = count < 65536 ? 1 : pool.size();
+    const size_t cells = static_cast<size_t>(n) * n;
+    partialMass.assign(workers * cells, 0.0);
+    double* partial = partialMass.data();
+    pool.run(workers, [=](uint32_t worker) {
+        double* own = partial + worker * cells;
+        double weightX[3];
+        double weightY[3];
+        for (size_t i = count * worker / workers; i < count * (worker + 1) / workers; ++i) {
+            int64_t firstX = stencil(scheme, (px[i] - originX) / cell, weightX);
+            int64_t firstY = stencil(scheme, (py[i] - originY) / cell, weightY);
+            for (uint32_t b = 0; b < points; ++b) {
+                double* row = own + (firstY + b) * n + firstX;
+                for (uint32_t a = 0; a < points; ++a) {
+                    row[a] += mass[i] * weightX[a] * weightY[b];
+                }
+            }
+        }
+    });
+
+    grid.assign(m * m, Complex());
+    Complex* data = grid.data();
+    pool.parallelFor(n, 16, [=](size_t begin, size_t end, uint32_t) {
+        for (size_t y = begin; y < end; ++y) {
+            for (size_t x = 0; x < n; ++x) {
+                double total = 0.0;
+                for (uint32_t worker = 0; worker < workers; ++worker) {
+                    total += partial[worker * cells + y * n + x];
+                }
+                data[y * m + x] = Complex(total, 0.0);
+            }
+        }
+    });
+
+    // The kernel is real in x and imaginary in y, so a single inverse
+    // transform of the product yields both acceleration components.
+    transform(grid, n, false, pool);
+    const Complex* transfer = kernel.data();
+    pool.parallelFor(m * m, 65536, [=](size_t begin, size_t end, uint32_t) {
+        for (size_t k = begin; k < end; ++k) {
+            double re = data[k].real() * transfer[k].real() - data[k].imag() * transfer[k].imag();
+            double im = data[k].real() * transfer[k].imag() + data[k].imag() * transfer[k].real();
+            data[k] = Complex(re, im);
+        }
+    });
+    transform(grid, n, true, pool);
+
+    const double scale = Universe::G / (cell * cell * static_cast<double>(m * m));
+    double* ax = acc[0].data();
+    double* ay = acc[1].data();
+    pool.parallelFor(count, 4096, [=](size_t begin, size_t end, uint32_t) {
+        double weightX[3];
+        double weightY[3];
+        for (size_t i = begin; i < end; ++i) {
+            int64_t firstX = stencil(scheme, (px[i] - originX) / cell, weightX);
+            int64_t firstY = stencil(scheme, (py[i] - originY) / cell, weightY);
+            double sumX = 0.0;
+            double sumY = 0.0;
+            for (uint32_t b = 0; b < points; ++b) {
+                const Complex* row = data + (firstY + b) * m + firstX;
+                for (uint32_t a = 0; a < points; ++a) {
+                    sumX += weightX[a] * weightY[b] * row[a].real();
+                    sumY += weightX[a] * weightY[b] * row[a].imag();
+                }
+            }
+            ax[i] = scale * sumX;
+            ay[i] = scale * sumY;
+        }
+    });
+}
+
+/**
+ *  Samples the acceleration of a unit mass one cell wide on the padded
+ *  grid, x in the real and y in the imaginary part, and transforms it.
+ */
+void PmEngine::buildKernel(ThreadPool& pool)
+{
+    TRACE_SCOPE("PmEngine::buildKernel");
+    const uint32_t n = gridSize;
+    const size_t m = 2 * static_cast<size_t>(n);
+    twiddle.resize(m / 2);
+    for (size_t k = 0; k < m / 2; ++k) {
+        double angle = -2.0 * pi * static_cast<double>(k) / static_cast<double>(m);
+        twiddle[k] = Complex(std::cos(angle), std::sin(angle));
+    }
+    reversal.resize(m);
+    uint32_t bits = 0;
+    while ((size_t(1) << bits) < m) {
+        ++bits;
+    }
+    for (size_t i = 0; i < m; ++i) {
+        uint32_t reversed = 0;
+        for (uint32_t bit = 0; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        reversal[i] = reversed;
+    }
+
+    // Entry (x, y) is the pull felt at offset (x, y) from the source, with
+    // offsets past n wrapped to negative values.
+    kernel.assign(m * m, Complex());
+    for (size_t y = 0; y < m; ++y) {
+        for (size_t x = 0; x < m; ++x) {
+            if (x == n || y == n || (x == 0 && y == 0))
+                continue;
+            double dx = x < n ? static_cast<double>(x) : static_cast<double>(x) - m;
+            double dy = y < n ? static_cast<double>(y) : static_cast<double>(y) - m;
+            double distSq = dx * dx + dy * dy;
+            double inverse = 1.0 / (distSq * std::sqrt(distSq));
+            kernel[y * m + x] = Complex(-dx * inverse, -dy * inverse);
+        }
+    }
+    transform(kernel, static_cast<uint32_t>(m), false, pool);
+    kernelSize = n;
+}
+
+/**
+ *  Transforms the first rows rows of the padded grid, then every column.
+ *  The inverse transforms the columns first and is not normalized.
+ */
+void PmEngine::transform(std::vector<Complex>& data, uint32_t rows, bool inverse, ThreadPool& pool)
+{
+    TRACE_SCOPE("PmEngine::transform");
+    const size_t m = 2 * static_cast<size_t>(gridSize);
+    columns.resize(pool.size() * m);
+    Complex* values = data.data();
+    Complex* buffers = columns.data();
+    auto transformRows = [&]() {
+        pool.parallelFor(rows, 8, [&](size_t begin, size_t end, uint32_t) {
+            for (size_t y = begin; y < end; ++y) {
+                transformLine(values + y * m, inverse);
+            }
+        });
+    };
+    auto transformColumns = [&]() {
+        pool.parallelFor(m, 8, [&](size_t begin, size_t end, uint32_t worker) {
+            Complex* line = buffers + worker * m;
+            for (size_t x = begin; x < end; ++x) {
+                for (size_t y = 0; y < m; ++y) {
+                    line[y] = values[y * m + x];
+                }
+                transformLine(line, inverse);
+                for (size_t y = 0; y < m; ++y) {
+                    values[y * m + x] = line[y];
+                }
+            }
+        });
+    };
+    // Rows past the first `rows` are zero before the forward transform and
+    // not needed after the inverse one, so they are skipped.
+    if (inverse) {
+        transformColumns();
+        transformRows();
+    } else {
+        transformRows();
+        transformColumns();
+    }
+}
+
+/**
+ *  Transforms one contiguous line of the padded grid in place.
+ */
+void PmEngine::transformLine(Complex* line, bool inverse) const
+{
+    const size_t m = 2 * static_cast<size_t>(gridSize);
+    for (size_t i = 0; i < m; ++i) {
+        size_t j = reversal[i];
+        if (i < j)
+            std::swap(line[i], line[j]);
+    }
+    const double sign = inverse ? -1.0 : 1.0;
+    for (size_t length = 2; length <= m; length <<= 1) {
+        const size_t half = length / 2;
+        const size_t stride = m / length;
+        for (size_t start = 0; start < m; start += length) {
+            for (size_t k = 0; k < half; ++k) {
+                const double wr = twiddle[k * stride].real();
+                const double wi = sign * twiddle[k * stride].imag();
+                Complex& top = line[start + k];
+                Complex& bottom = line[start + k + half];
+                // Written out to avoid the NaN handling of std::complex multiplication.
+                double re = bottom.real() * wr - bottom.imag() * wi;
+                double im = bottom.real() * wi + bottom.imag() * wr;
+                bottom = Complex(top.real() - re, top.imag() - im);
+                top = Complex(top.real() + re, top.imag() + im);
+            }
+        }
+    }
+}
+
+#endif
+// comment
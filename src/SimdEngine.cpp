@@ -0,0 +1,739 @@
+// File name: SimdEngine.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements a tiled, vectorized direct summation force engine with run
+// time instruction set dispatch
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef SIMD_ENGINE_CPP
+#define SIMD_ENGINE_CPP
+#include "../include/SimdEngine.h"
+#include "../include/Trace.h"
+#include "../include/Universe.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_ENGINE_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+// Sources per tile: up to four columns of 512 doubles fit comfortably in a 32 KB L1.
+const size_t tileBodies = 512;
+// Every kernel consumes whole groups of this many sources.
+const size_t padding = 8;
+// Every mixed precision kernel consumes whole groups of this many sources.
+const size_t mixedPadding = 16;
+
+/**
+ *  Signature shared by every kernel: adds the pull of sources [jBegin, jEnd)
+ *  on targets [iBegin, iEnd) to the acc columns and, in the kernels built
+ *  with Phi, their potential to phi.
+ */
+template <uint32_t D> using Kernel = void (*)(const std::array<const double*, D>& x,
+    const double* gm, size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd,
+    const std::array<double*, D>& acc, double* phi);
+
+template <uint32_t D, bool Phi>
+void tileScalar(const std::array<const double*, D>& x, const double* gm, size_t iBegin,
+    size_t iEnd, size_t jBegin, size_t jEnd, const std::array<double*, D>& acc, double* phi)
+{
+    for (size_t i = iBegin; i < iEnd; ++i) {
+        double sum[D] = {};
+        double energy = 0.0;
+        for (size_t j = jBegin; j < jEnd; ++j) {
+            double d[D];
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                d[axis] = x[axis][j] - x[axis][i];
+            }
+            double distSq = d[0] * d[0];
+            for (uint32_t axis = 1; axis < D; ++axis) {
+                distSq += d[axis] * d[axis];
+            }
+            if (distSq == 0.0)
+                continue;
+            double scale = gm[j] / (distSq * std::sqrt(distSq));
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                sum[axis] += scale * d[axis];
+            }
+            // G m / r is scale * distSq; summing it costs one operation a pair.
+            if (Phi)
+                energy -= scale * distSq;
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            acc[axis][i] += sum[axis];
+        }
+        if (Phi)
+            phi[i] += energy;
+    }
+}
+
+#ifdef SIMD_ENGINE_X86
+template <uint32_t D, bool Phi>
+__attribute__((target("sse2"))) void tileSse2(const std::array<const double*, D>& x,
+    const double* gm, size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd,
+    const std::array<double*, D>& acc, double* phi)
+{
+    const __m128d zero = _mm_setzero_pd();
+    for (size_t i = iBegin; i < iEnd; ++i) {
+        __m128d at[D];
+        __m128d sum[D];
+        __m128d energy = zero;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            at[axis] = _mm_set1_pd(x[axis][i]);
+            sum[axis] = zero;
+        }
+        for (size_t j = jBegin; j < jEnd; j += 2) {
+            __m128d d[D];
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                d[axis] = _mm_sub_pd(_mm_loadu_pd(x[axis] + j), at[axis]);
+            }
+            __m128d distSq = _mm_mul_pd(d[0], d[0]);
+            for (uint32_t axis = 1; axis < D; ++axis) {
+                distSq = _mm_add_pd(distSq, _mm_mul_pd(d[axis], d[axis]));
+            }
+            // Coincident lanes divide by zero; the mask clears them afterwards.
+            __m128d scale
+                = _mm_div_pd(_mm_loadu_pd(gm + j), _mm_mul_pd(distSq, _mm_sqrt_pd(distSq)));
+            scale = _mm_and_pd(scale, _mm_cmpgt_pd(distSq, zero));
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                sum[axis] = _mm_add_pd(sum[axis], _mm_mul_pd(scale, d[axis]));
+            }
+            if (Phi)
+                energy = _mm_sub_pd(energy, _mm_mul_pd(scale, distSq));
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            acc[axis][i]
+                += _mm_cvtsd_f64(_mm_add_sd(sum[axis], _mm_unpackhi_pd(sum[axis], sum[axis])));
+        }
+        if (Phi)
+            phi[i] += _mm_cvtsd_f64(_mm_add_sd(energy, _mm_unpackhi_pd(energy, energy)));
+    }
+}
+
+__attribute__((target("avx2,fma"))) double horizontalSum(__m256d v)
+{
+    __m128d low = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+template <uint32_t D, bool Phi>
+__attribute__((target("avx2,fma"))) void tileAvx2(const std::array<const double*, D>& x,
+    const double* gm, size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd,
+    const std::array<double*, D>& acc, double* phi)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    for (size_t i = iBegin; i < iEnd; ++i) {
+        __m256d at[D];
+        __m256d sum[D];
+        __m256d energy = zero;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            at[axis] = _mm256_set1_pd(x[axis][i]);
+            sum[axis] = zero;
+        }
+        for (size_t j = jBegin; j < jEnd; j += 4) {
+            __m256d d[D];
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                d[axis] = _mm256_sub_pd(_mm256_loadu_pd(x[axis] + j), at[axis]);
+            }
+            // The last axis is squared first and the others fused onto it.
+            __m256d distSq = _mm256_mul_pd(d[D - 1], d[D - 1]);
+            for (uint32_t axis = D - 1; axis-- > 0;) {
+                distSq = _mm256_fmadd_pd(d[axis], d[axis], distSq);
+            }
+            __m256d scale = _mm256_div_pd(
+                _mm256_loadu_pd(gm + j), _mm256_mul_pd(distSq, _mm256_sqrt_pd(distSq)));
+            scale = _mm256_and_pd(scale, _mm256_cmp_pd(distSq, zero, _CMP_GT_OQ));
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                sum[axis] = _mm256_fmadd_pd(scale, d[axis], sum[axis]);
+            }
+            if (Phi)
+                energy = _mm256_fnmadd_pd(scale, distSq, energy);
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            acc[axis][i] += horizontalSum(sum[axis]);
+        }
+        if (Phi)
+            phi[i] += horizontalSum(energy);
+    }
+}
+
+// GCC implements _mm512_undefined_pd() as a self-initialized variable and then
+// warns about it wherever the AVX-512 intrinsics are inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+template <uint32_t D, bool Phi>
+__attribute__((target("avx512f"))) void tileAvx512(const std::array<const double*, D>& x,
+    const double* gm, size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd,
+    const std::array<double*, D>& acc, double* phi)
+{
+    const __m512d zero = _mm512_setzero_pd();
+    for (size_t i = iBegin; i < iEnd; ++i) {
+        __m512d at[D];
+        __m512d sum[D];
+        __m512d energy = zero;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            at[axis] = _mm512_set1_pd(x[axis][i]);
+            sum[axis] = zero;
+        }
+        for (size_t j = jBegin; j < jEnd; j += 8) {
+            __m512d d[D];
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                d[axis] = _mm512_sub_pd(_mm512_loadu_pd(x[axis] + j), at[axis]);
+            }
+            __m512d distSq = _mm512_mul_pd(d[D - 1], d[D - 1]);
+            for (uint32_t axis = D - 1; axis-- > 0;) {
+                distSq = _mm512_fmadd_pd(d[axis], d[axis], distSq);
+            }
+            __mmask8 apart = _mm512_cmp_pd_mask(distSq, zero, _CMP_GT_OQ);
+            __m512d scale = _mm512_maskz_div_pd(apart, _mm512_loadu_pd(gm + j),
+                _mm512_mul_pd(distSq, _mm512_sqrt_pd(distSq)));
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                sum[axis] = _mm512_fmadd_pd(scale, d[axis], sum[axis]);
+            }
+            if (Phi)
+                energy = _mm512_fnmadd_pd(scale, distSq, energy);
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            acc[axis][i] += _mm512_reduce_add_pd(sum[axis]);
+        }
+        if (Phi)
+            phi[i] += _mm512_reduce_add_pd(energy);
+    }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+/**
+ *  Returns the kernel compiled for level, summing potentials if Phi.
+ */
+template <uint32_t D, bool Phi> Kernel<D> kernelFor(typename BasicSimdEngine<D>::Level level)
+{
+    typedef typename BasicSimdEngine<D>::Level Level;
+#ifdef SIMD_ENGINE_X86
+    switch (level) {
+    case Level::Avx512:
+        return tileAvx512<D, Phi>;
+    case Level::Avx2:
+        return tileAvx2<D, Phi>;
+    case Level::Sse2:
+        return tileSse2<D, Phi>;
+    default:
+        break;
+    }
+#else
+    (void)(level);
+#endif
+    return tileScalar<D, Phi>;
+}
+
+/**
+ *  Signature shared by every mixed precision kernel: adds the pull of the
+ *  length sources of one tile on a target at offset at to sum and, in the
+ *  kernels built with Phi, their potential to energy.
+ */
+template <uint32_t D> using MixedKernel = void (*)(const std::array<const float*, D>& x,
+    const float* gm, size_t length, const float* at, double* sum, double* energy);
+
+template <uint32_t D, bool Phi>
+void mixedScalar(const std::array<const float*, D>& x, const float* gm, size_t length,
+    const float* at, double* sum, double* energy)
+{
+    float tile[D] = {};
+    float potential = 0.0f;
+    for (size_t j = 0; j < length; ++j) {
+        float d[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            d[axis] = x[axis][j] - at[axis];
+        }
+        float distSq = d[0] * d[0];
+        for (uint32_t axis = 1; axis < D; ++axis) {
+            distSq += d[axis] * d[axis];
+        }
+        if (distSq == 0.0f)
+            continue;
+        float scale = gm[j] / (distSq * std::sqrt(distSq));
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            tile[axis] += scale * d[axis];
+        }
+        if (Phi)
+            potential -= scale * distSq;
+    }
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        sum[axis] += tile[axis];
+    }
+    if (Phi)
+        *energy += potential;
+}
+
+#ifdef SIMD_ENGINE_X86
+/**
+ *  Returns the sum of the lanes of v, widened first so that it is taken in
+ *  double.
+ */
+__attribute__((target("sse2"))) double widenedSum(__m128 v)
+{
+    __m128d pair = _mm_add_pd(_mm_cvtps_pd(v), _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+template <uint32_t D, bool Phi>
+__attribute__((target("sse2"))) void mixedSse2(const std::array<const float*, D>& x,
+    const float* gm, size_t length, const float* at, double* sum, double* energy)
+{
+    const __m128 zero = _mm_setzero_ps();
+    __m128 target[D];
+    __m128 tile[D];
+    __m128 potential = zero;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        target[axis] = _mm_set1_ps(at[axis]);
+        tile[axis] = zero;
+    }
+    for (size_t j = 0; j < length; j += 4) {
+        __m128 d[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            d[axis] = _mm_sub_ps(_mm_loadu_ps(x[axis] + j), target[axis]);
+        }
+        __m128 distSq = _mm_mul_ps(d[0], d[0]);
+        for (uint32_t axis = 1; axis < D; ++axis) {
+            distSq = _mm_add_ps(distSq, _mm_mul_ps(d[axis], d[axis]));
+        }
+        __m128 scale = _mm_div_ps(_mm_loadu_ps(gm + j), _mm_mul_ps(distSq, _mm_sqrt_ps(distSq)));
+        scale = _mm_and_ps(scale, _mm_cmpgt_ps(distSq, zero));
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            tile[axis] = _mm_add_ps(tile[axis], _mm_mul_ps(scale, d[axis]));
+        }
+        if (Phi)
+            potential = _mm_sub_ps(potential, _mm_mul_ps(scale, distSq));
+    }
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        sum[axis] += widenedSum(tile[axis]);
+    }
+    if (Phi)
+        *energy += widenedSum(potential);
+}
+
+__attribute__((target("avx2,fma"))) double widenedSum(__m256 v)
+{
+    return horizontalSum(_mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)),
+        _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1))));
+}
+
+template <uint32_t D, bool Phi>
+__attribute__((target("avx2,fma"))) void mixedAvx2(const std::array<const float*, D>& x,
+    const float* gm, size_t length, const float* at, double* sum, double* energy)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 target[D];
+    __m256 tile[D];
+    __m256 potential = zero;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        target[axis] = _mm256_set1_ps(at[axis]);
+        tile[axis] = zero;
+    }
+    for (size_t j = 0; j < length; j += 8) {
+        __m256 d[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            d[axis] = _mm256_sub_ps(_mm256_loadu_ps(x[axis] + j), target[axis]);
+        }
+        __m256 distSq = _mm256_mul_ps(d[D - 1], d[D - 1]);
+        for (uint32_t axis = D - 1; axis-- > 0;) {
+            distSq = _mm256_fmadd_ps(d[axis], d[axis], distSq);
+        }
+        __m256 scale = _mm256_div_ps(
+            _mm256_loadu_ps(gm + j), _mm256_mul_ps(distSq, _mm256_sqrt_ps(distSq)));
+        scale = _mm256_and_ps(scale, _mm256_cmp_ps(distSq, zero, _CMP_GT_OQ));
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            tile[axis] = _mm256_fmadd_ps(scale, d[axis], tile[axis]);
+        }
+        if (Phi)
+            potential = _mm256_fnmadd_ps(scale, distSq, potential);
+    }
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        sum[axis] += widenedSum(tile[axis]);
+    }
+    if (Phi)
+        *energy += widenedSum(potential);
+}
+
+// The same holds for the single precision intrinsics and their conversions.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+__attribute__((target("avx512f"))) double widenedSum(__m512 v)
+{
+    // Lanes 8 to 15 are moved down to convert them as well.
+    __m512 upper = _mm512_shuffle_f32x4(v, v, 0xee);
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_cvtps_pd(_mm512_castps512_ps256(v)),
+        _mm512_cvtps_pd(_mm512_castps512_ps256(upper))));
+}
+
+template <uint32_t D, bool Phi>
+__attribute__((target("avx512f"))) void mixedAvx512(const std::array<const float*, D>& x,
+    const float* gm, size_t length, const float* at, double* sum, double* energy)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    __m512 target[D];
+    __m512 tile[D];
+    __m512 potential = zero;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        target[axis] = _mm512_set1_ps(at[axis]);
+        tile[axis] = zero;
+    }
+    for (size_t j = 0; j < length; j += 16) {
+        __m512 d[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            d[axis] = _mm512_sub_ps(_mm512_loadu_ps(x[axis] + j), target[axis]);
+        }
+        __m512 distSq = _mm512_mul_ps(d[D - 1], d[D - 1]);
+        for (uint32_t axis = D - 1; axis-- > 0;) {
+            distSq = _mm512_fmadd_ps(d[axis], d[axis], distSq);
+        }
+        __mmask16 apart = _mm512_cmp_ps_mask(distSq, zero, _CMP_GT_OQ);
+        __m512 scale = _mm512_maskz_div_ps(
+            apart, _mm512_loadu_ps(gm + j), _mm512_mul_ps(distSq, _mm512_sqrt_ps(distSq)));
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            tile[axis] = _mm512_fmadd_ps(scale, d[axis], tile[axis]);
+        }
+        if (Phi)
+            potential = _mm512_fnmadd_ps(scale, distSq, potential);
+    }
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        sum[axis] += widenedSum(tile[axis]);
+    }
+    if (Phi)
+        *energy += widenedSum(potential);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+/**
+ *  Returns the mixed precision kernel compiled for level, summing
+ *  potentials if Phi.
+ */
+template <uint32_t D, bool Phi>
+MixedKernel<D> mixedKernelFor(typename BasicSimdEngine<D>::Level level)
+{
+    typedef typename BasicSimdEngine<D>::Level Level;
+#ifdef SIMD_ENGINE_X86
+    switch (level) {
+    case Level::Avx512:
+        return mixedAvx512<D, Phi>;
+    case Level::Avx2:
+        return mixedAvx2<D, Phi>;
+    case Level::Sse2:
+        return mixedSse2<D, Phi>;
+    default:
+        break;
+    }
+#else
+    (void)(level);
+#endif
+    return mixedScalar<D, Phi>;
+}
+
+/**
+ *  Returns the Morton key of a cell: the bits of its coordinates interleaved,
+ *  most significant first, using 63 / D bits per axis.
+ */
+template <uint32_t D> uint64_t mortonKey(const uint64_t* cell)
+{
+    uint64_t key = 0;
+    for (uint32_t bit = 63 / D; bit-- > 0;) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            key = (key << 1) | ((cell[axis] >> bit) & 1);
+        }
+    }
+    return key;
+}
+}
+
+/**
+ *  Creates an engine using the widest level supported by this CPU.
+ */
+template <uint32_t D>
+BasicSimdEngine<D>::BasicSimdEngine(Precision precision)
+    : level(detect())
+    , precision(precision)
+{
+}
+
+/**
+ *  Returns true if this CPU and OS can run the given level.
+ */
+template <uint32_t D> bool BasicSimdEngine<D>::isSupported(Level level) noexcept
+{
+    switch (level) {
+    case Level::Scalar:
+        return true;
+#ifdef SIMD_ENGINE_X86
+    case Level::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Level::Avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Level::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ *  Returns the widest level this CPU and OS can run.
+ */
+template <uint32_t D> typename BasicSimdEngine<D>::Level BasicSimdEngine<D>::detect() noexcept
+{
+    for (Level level : { Level::Avx512, Level::Avx2, Level::Sse2 }) {
+        if (isSupported(level))
+            return level;
+    }
+    return Level::Scalar;
+}
+
+/**
+ *  Returns a printable name of level.
+ */
+template <uint32_t D> const char* BasicSimdEngine<D>::name(Level level) noexcept
+{
+    switch (level) {
+    case Level::Avx512:
+        return "avx512";
+    case Level::Avx2:
+        return "avx2";
+    case Level::Sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ *  Returns the kernel in use.
+ */
+template <uint32_t D>
+typename BasicSimdEngine<D>::Level BasicSimdEngine<D>::getLevel() const noexcept
+{
+    return level;
+}
+
+/**
+ *  Selects a kernel, falling back to the widest supported level not wider
+ *  than the requested one. Returns the level actually selected.
+ */
+template <uint32_t D>
+typename BasicSimdEngine<D>::Level BasicSimdEngine<D>::setLevel(Level level) noexcept
+{
+    while (!isSupported(level)) {
+        level = static_cast<Level>(static_cast<int>(level) - 1);
+    }
+    this->level = level;
+    this->touch();
+    return level;
+}
+
+/**
+ *  Evaluates every pair with the selected kernel.
+ */
+template <uint32_t D>
+void BasicSimdEngine<D>::computeAccelerations(
+    const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool)
+{
+    TRACE_SCOPE("SimdEngine::computeAccelerations");
+    if (precision == Precision::Mixed) {
+        computeMixed(bodies, acc, pool);
+        return;
+    }
+    const size_t count = bodies.size();
+    const size_t padded = (count + padding - 1) / padding * padding;
+    std::array<const double*, D> x;
+    std::array<double*, D> out;
+    // Padding bodies are massless, so they add nothing wherever they sit.
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        acc[axis].assign(count, 0.0);
+        packed[axis].assign(bodies.position[axis].begin(), bodies.position[axis].end());
+        packed[axis].resize(padded, 0.0);
+        x[axis] = packed[axis].data();
+        out[axis] = acc[axis].data();
+    }
+    packedMass.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        packedMass[i] = BasicUniverse<D>::G * bodies.mass[i];
+    }
+    packedMass.resize(padded, 0.0);
+    double* phi = this->preparePotentials(bodies);
+    if (phi)
+        std::fill(phi, phi + count, 0.0);
+
+    // Without potentials the kernel does not spend a single operation on them.
+    const Kernel<D> kernel = phi ? kernelFor<D, true>(level) : kernelFor<D, false>(level);
+    const double* gm = packedMass.data();
+    const size_t minRows = std::max<size_t>(1, 32768 / std::max<size_t>(padded, 1));
+    pool.parallelFor(count, minRows, [=](size_t begin, size_t end, uint32_t) {
+        // Only the sources are tiled. A target row loads and stores 2 * D values for every
+        // tileBodies pairs, so streaming the rows once per tile is lost in the divisions and
+        // square roots; blocking them as well measured no faster up to 262144 bodies.
+        for (size_t tile = 0; tile < padded; tile += tileBodies) {
+            kernel(x, gm, begin, end, tile, std::min(tile + tileBodies, padded), out, phi);
+        }
+    });
+}
+
+/**
+ *  Returns true: the potentials are summed over the same pairs.
+ */
+template <uint32_t D> bool BasicSimdEngine<D>::computesPotentials() const noexcept
+{
+    return true;
+}
+
+/**
+ *  Evaluates every pair at float width on tile-relative offsets.
+ */
+template <uint32_t D>
+void BasicSimdEngine<D>::computeMixed(
+    const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool)
+{
+    const size_t count = bodies.size();
+    const size_t padded = (count + mixedPadding - 1) / mixedPadding * mixedPadding;
+    const size_t tiles = (padded + tileBodies - 1) / tileBodies;
+    double lower[D];
+    double extent = 0.0;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        const typename BasicBodyStore<D>::Column& column = bodies.position[axis];
+        acc[axis].assign(count, 0.0);
+        auto range = std::minmax_element(column.begin(), column.end());
+        lower[axis] = count > 0 ? *range.first : 0.0;
+        extent = count > 0 ? std::max(extent, *range.second - *range.first) : 0.0;
+    }
+    double* phi = this->preparePotentials(bodies);
+    if (count == 0)
+        return;
+    if (phi)
+        std::fill(phi, phi + count, 0.0);
+
+    // Sorting along the curve makes every tile a compact cluster.
+    const double cells = std::ldexp(1.0, 63 / D) - 1.0;
+    const double toCell = extent > 0.0 ? cells / extent : 0.0;
+    keys.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t cell[D];
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            cell[axis] = static_cast<uint64_t>((bodies.position[axis][i] - lower[axis]) * toCell);
+        }
+        keys[i] = std::make_pair(mortonKey<D>(cell), static_cast<uint32_t>(i));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // Offsets and accelerations are measured in units of a power of two no
+    // smaller than the extent, so they stay far from the float limits and the
+    // scaling itself is exact.
+    const double unit = extent > 0.0 ? std::ldexp(1.0, std::ilogb(extent) + 1) : 1.0;
+    const double toUnit = 1.0 / unit;
+    const double massScale = BasicUniverse<D>::G * toUnit * toUnit;
+    scaledMass.assign(padded, 0.0f);
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        offsets[axis].assign(padded, 0.0f);
+        centroids[axis].resize(tiles);
+    }
+    for (size_t tile = 0; tile < tiles; ++tile) {
+        const size_t begin = tile * tileBodies;
+        const size_t end = std::min(begin + tileBodies, count);
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            const double* position = bodies.position[axis].data();
+            double total = 0.0;
+            for (size_t k = begin; k < end; ++k) {
+                total += position[keys[k].second];
+            }
+            const double centroid = end > begin ? total / static_cast<double>(end - begin) : 0.0;
+            centroids[axis][tile] = centroid;
+            for (size_t k = begin; k < end; ++k) {
+                const double offset = position[keys[k].second] - centroid;
+                offsets[axis][k] = static_cast<float>(offset * toUnit);
+            }
+        }
+        for (size_t k = begin; k < end; ++k) {
+            scaledMass[k] = static_cast<float>(massScale * bodies.mass[keys[k].second]);
+        }
+    }
+
+    const MixedKernel<D> kernel
+        = phi ? mixedKernelFor<D, true>(level) : mixedKernelFor<D, false>(level);
+    std::array<const double*, D> position;
+    std::array<const float*, D> source;
+    std::array<const double*, D> centroid;
+    std::array<double*, D> out;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        position[axis] = bodies.position[axis].data();
+        source[axis] = offsets[axis].data();
+        centroid[axis] = centroids[axis].data();
+        out[axis] = acc[axis].data();
+    }
+    const float* gm = scaledMass.data();
+    const size_t minRows = std::max<size_t>(1, 32768 / padded);
+    pool.parallelFor(count, minRows, [=](size_t begin, size_t end, uint32_t) {
+        for (size_t tile = 0; tile < tiles; ++tile) {
+            const size_t first = tile * tileBodies;
+            const size_t length = std::min(tileBodies, padded - first);
+            std::array<const float*, D> x;
+            for (uint32_t axis = 0; axis < D; ++axis) {
+                x[axis] = source[axis] + first;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                // Rounded exactly as the sources were, so a body meets itself at zero.
+                float at[D];
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    const double offset = position[axis][i] - centroid[axis][tile];
+                    at[axis] = static_cast<float>(offset * toUnit);
+                }
+                double sum[D] = {};
+                double energy = 0.0;
+                kernel(x, gm + first, length, at, sum, &energy);
+                for (uint32_t axis = 0; axis < D; ++axis) {
+                    out[axis][i] += sum[axis];
+                }
+                // The accelerations come out in m/s^2, but G m / r divided by unit.
+                if (phi)
+                    phi[i] += energy * unit;
+            }
+        }
+    });
+}
+
+/**
+ *  Returns the format the pairs are evaluated in.
+ */
+template <uint32_t D>
+typename BasicSimdEngine<D>::Precision BasicSimdEngine<D>::getPrecision() const noexcept
+{
+    return precision;
+}
+
+/**
+ *  Selects the format the pairs are evaluated in.
+ */
+template <uint32_t D> void BasicSimdEngine<D>::setPrecision(Precision precision) noexcept
+{
+    this->precision = precision;
+    this->touch();
+}
+
+template class BasicSimdEngine<2>;
+template class BasicSimdEngine<3>;
+
+#endif
+// comment
\ No newline at end of file
@@ -0,0 +1,130 @@
+// File name: ThreadPool.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements a persistent pool of worker threads used to parallelize the
+// simulation
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef THREAD_POOL_CPP
+#define THREAD_POOL_CPP
+#include "../include/ThreadPool.h"
+#include "../include/Trace.h"
+
+/**
+ *  Creates a pool of the given size. Zero selects one worker per hardware
+ *  thread.
+ */
+ThreadPool::ThreadPool(uint32_t count)
+{
+    resize(count);
+}
+
+/**
+ *  Stops and joins every worker.
+ */
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+/**
+ *  Returns the number of workers, counting the calling thread.
+ */
+uint32_t ThreadPool::size() const noexcept
+{
+    return static_cast<uint32_t>(threads.size()) + 1;
+}
+
+/**
+ *  Restarts the pool with the given number of workers. Zero selects one
+ *  worker per hardware thread.
+ */
+void ThreadPool::resize(uint32_t count)
+{
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+    if (count == size())
+        return;
+    stop();
+    stopping = false;
+    threads.reserve(count - 1);
+    for (uint32_t index = 1; index < count; ++index) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, index, generation);
+    }
+}
+
+/**
+ *  Publishes a job to the workers, runs worker 0 inline and waits.
+ */
+void ThreadPool::dispatch(uint32_t workers, Invoker invoker, const void* task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->invoker = invoker;
+        this->task = task;
+        active = workers;
+        remaining = workers - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    {
+        TRACE_SCOPE("ThreadPool::job");
+        invoker(task, 0);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return remaining == 0; });
+}
+
+/**
+ *  Body of background worker index. Jobs up to generation seen were published
+ *  before the worker existed.
+ */
+void ThreadPool::workerLoop(uint32_t index, uint64_t seen)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+            return;
+        seen = generation;
+        if (index >= active)
+            continue;
+
+        Invoker job = invoker;
+        const void* arg = task;
+        lock.unlock();
+        {
+            TRACE_SCOPE("ThreadPool::job");
+            job(arg, index);
+        }
+        lock.lock();
+        if (--remaining == 0)
+            finished.notify_one();
+    }
+}
+
+/**
+ *  Stops and joins every worker.
+ */
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+#endif
+// comment
\ No newline at end of file
@@ -0,0 +1,208 @@
+// File name: Trace.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the per-thread phase tracing of the simulation and its Chrome
+// trace export
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef TRACE_CPP
+#define TRACE_CPP
+#include "../include/Trace.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+/**
+ *  A phase completed on some thread, in nanoseconds since the epoch.
+ */
+struct Event {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+/**
+ *  The events of one thread. Buffers outlive their threads so that the
+ *  workers of a resized pool still show up in the export.
+ */
+struct Buffer {
+    uint32_t thread;
+    std::vector<Event> events;
+};
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+/**
+ *  Guards the list of buffers, not their events.
+ */
+std::mutex registryMutex;
+
+std::vector<std::unique_ptr<Buffer>>& registry()
+{
+    static std::vector<std::unique_ptr<Buffer>> buffers;
+    return buffers;
+}
+
+thread_local Buffer* local = nullptr;
+
+/**
+ *  Returns the buffer of the calling thread, registering it on first use.
+ */
+Buffer& localBuffer()
+{
+    if (local == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::vector<std::unique_ptr<Buffer>>& buffers = registry();
+        const uint32_t thread = static_cast<uint32_t>(buffers.size() + 1);
+        std::unique_ptr<Buffer> buffer(new Buffer { thread, {} });
+        buffers.push_back(std::move(buffer));
+        local = buffers.back().get();
+    }
+    return *local;
+}
+
+/**
+ *  Writes name as a JSON string.
+ */
+void writeString(std::ostream& out, const char* name)
+{
+    out << '"';
+    for (const char* c = name; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+/**
+ *  Writes a time in nanoseconds as the microseconds the format expects.
+ */
+void writeMicros(std::ostream& out, uint64_t nanos)
+{
+    const uint64_t fraction = nanos % 1000;
+    out << nanos / 1000 << '.' << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+}
+}
+
+std::atomic<bool> Trace::enabled(false);
+
+/**
+ *  Starts recording. Events recorded so far are kept.
+ */
+void Trace::enable() noexcept
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ *  Stops recording. Events recorded so far are kept.
+ */
+void Trace::disable() noexcept
+{
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+/**
+ *  Drops every recorded event, keeping the buffers' capacity.
+ */
+void Trace::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (std::unique_ptr<Buffer>& buffer : registry()) {
+        buffer->events.clear();
+    }
+}
+
+/**
+ *  Returns the number of events recorded on every thread.
+ */
+size_t Trace::getEventCount()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t count = 0;
+    for (const std::unique_ptr<Buffer>& buffer : registry()) {
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+/**
+ *  Writes every recorded event as a complete ("X") event of the Chrome
+ *  trace-event format, with a name for the track of each thread.
+ */
+void Trace::writeChromeJson(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    const long pid = static_cast<long>(::getpid());
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const std::unique_ptr<Buffer>& buffer : registry()) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+            << ",\"tid\":" << buffer->thread << ",\"args\":{\"name\":\"thread "
+            << buffer->thread << "\"}}";
+        first = false;
+        for (const Event& event : buffer->events) {
+            out << ",\n{\"name\":";
+            writeString(out, event.name);
+            out << ",\"cat\":\"nbody\",\"ph\":\"X\",\"ts\":";
+            writeMicros(out, event.begin);
+            out << ",\"dur\":";
+            writeMicros(out, event.end - event.begin);
+            out << ",\"pid\":" << pid << ",\"tid\":" << buffer->thread << '}';
+        }
+    }
+    out << "\n]}\n";
+}
+
+/**
+ *  Writes the same JSON to the file at path. Throws std::runtime_error if
+ *  it cannot be written.
+ */
+void Trace::writeChromeJson(const std::string& path)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        throw std::runtime_error(path + ": open failed: " + std::strerror(errno));
+    writeChromeJson(out);
+    out.flush();
+    if (!out)
+        throw std::runtime_error(path + ": write failed");
+}
+
+/**
+ *  Returns the nanoseconds elapsed since the process started tracing time.
+ */
+uint64_t Trace::now() noexcept
+{
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - epoch;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+/**
+ *  Appends a phase that ran from begin to end to the calling thread's
+ *  buffer, dropping it if memory runs out.
+ */
+void Trace::record(const char* name, uint64_t begin, uint64_t end) noexcept
+{
+    try {
+        localBuffer().events.push_back(Event { name, begin, end });
+    } catch (...) {
+    }
+}
+
+#endif
+// comment
@@ -0,0 +1,1018 @@
+// File name: Trajectory.cpp
+// Author: Nishant Jain
+// VUnetID: jainn6
+// Email: nishant.jain@vanderbilt.edu
+// Class: CS3251
+// Assignment Number: 6
+// Description: This class implements the asynchronous trajectory recorder of the simulation and its
+// reader
+// Honor statement: I attest that I understand the honor code for this class and have neither given
+// nor received any unauthorized aid on this assignment.
+// Last Changed: 11/7/20
+
+#ifndef TRAJECTORY_CPP
+#define TRAJECTORY_CPP
+#include "../include/Trajectory.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const char magic[8] = { 'N', 'B', 'O', 'D', 'Y', 'T', 'R', 'J' };
+const char indexMagic[8] = { 'N', 'B', 'O', 'D', 'Y', 'I', 'D', 'X' };
+// Bytes of an index entry and of the count, offset and magic ending the file.
+const uint64_t keyframeBytes = 24;
+const uint64_t trailerBytes = 24;
+const uint32_t nativeTag = 0x01020304;
+// Idle polls the writer spends yielding before it starts to sleep.
+const uint32_t spinPolls = 64;
+// Codec numbers stored in the header.
+const uint32_t rawCodec = 0;
+const uint32_t riceCodec = 1;
+// Rice quotients from this one up are escaped and followed by the raw value.
+const uint32_t escape = 24;
+// Bits storing a column's Rice parameter.
+const uint32_t parameterBits = 6;
+// Quanta beyond this magnitude could overflow the second difference.
+const double maxQuanta = 1.0e18;
+
+/**
+ *  Writes a value to out in the host byte order.
+ */
+template <typename T> void put(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ *  Reads a value from in in the host byte order.
+ */
+template <typename T> void get(std::istream& in, T& value)
+{
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+/**
+ *  Appends bit fields to a byte buffer, least significant bit first.
+ */
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& bytes)
+        : bytes(bytes)
+    {
+    }
+
+    /**
+     *  Appends the low count bits of value, count <= 32.
+     */
+    void put(uint64_t value, uint32_t count)
+    {
+        bits |= value << used;
+        used += count;
+        while (used >= 8) {
+            bytes.push_back(static_cast<uint8_t>(bits));
+            bits >>= 8;
+            used -= 8;
+        }
+    }
+
+    /**
+     *  Appends the low count bits of value, count <= 64.
+     */
+    void putWide(uint64_t value, uint32_t count)
+    {
+        if (count > 32) {
+            put(value & 0xffffffffu, 32);
+            value >>= 32;
+            count -= 32;
+        }
+        put(value & ((uint64_t(1) << count) - 1), count);
+    }
+
+    /**
+     *  Pads the last byte with zeros.
+     */
+    void flush()
+    {
+        if (used > 0)
+            bytes.push_back(static_cast<uint8_t>(bits));
+        bits = 0;
+        used = 0;
+    }
+
+private:
+    std::vector<uint8_t>& bytes;
+    uint64_t bits = 0;
+    uint32_t used = 0;
+};
+
+/**
+ *  Reads the bit fields written by a BitWriter. Reading past the end yields
+ *  zeros and is reported by overrun.
+ */
+class BitReader {
+public:
+    BitReader(const uint8_t* bytes, size_t count)
+        : bytes(bytes)
+        , count(count)
+    {
+    }
+
+    /**
+     *  Returns the next count bits without consuming them, count <= 56.
+     */
+    uint64_t peek(uint32_t count)
+    {
+        refill();
+        return bits & ((uint64_t(1) << count) - 1);
+    }
+
+    /**
+     *  Consumes count bits, count <= 56.
+     */
+    void skip(uint32_t count)
+    {
+        bits >>= count;
+        used -= count;
+    }
+
+    /**
+     *  Consumes and returns the next count bits, count <= 64.
+     */
+    uint64_t get(uint32_t count)
+    {
+        uint64_t value = 0;
+        uint32_t done = 0;
+        while (count > 0) {
+            uint32_t part = std::min(count, 32u);
+            value |= peek(part) << done;
+            skip(part);
+            done += part;
+            count -= part;
+        }
+        return value;
+    }
+
+    /**
+     *  Returns true if more bits were consumed than there are.
+     */
+    bool overrun() const noexcept
+    {
+        return next * 8 - used > count * 8;
+    }
+
+private:
+    /**
+     *  Tops the buffer up to at least 57 bits.
+     */
+    void refill()
+    {
+        while (used <= 56) {
+            bits |= uint64_t(next < count ? bytes[next] : 0) << used;
+            ++next;
+            used += 8;
+        }
+    }
+
+    const uint8_t* bytes;
+    size_t count;
+    size_t next = 0;
+    uint64_t bits = 0;
+    uint32_t used = 0;
+};
+}
+
+/**
+ *  Creates a codec of frames of the given number of rows, with the
+ *  given absolute error bounds on positions and velocities. Throws
+ *  std::invalid_argument unless both bounds are positive and finite.
+ */
+template <uint32_t D>
+BasicTrajectoryCodec<D>::BasicTrajectoryCodec(
+    size_t rows, double positionBound, double velocityBound)
+{
+    if (!(positionBound > 0.0 && velocityBound > 0.0) || !std::isfinite(positionBound)
+        || !std::isfinite(velocityBound))
+        throw std::invalid_argument("trajectory error bounds must be positive and finite");
+    for (uint32_t column = 0; column < 2 * D; ++column) {
+        quantum[column] = 2.0 * (column < D ? positionBound : velocityBound);
+        last[column].resize(rows);
+        beforeLast[column].resize(rows);
+    }
+    residuals.resize(rows);
+}
+
+/**
+ *  Returns the error bound of positions in meters.
+ */
+template <uint32_t D> double BasicTrajectoryCodec<D>::getPositionBound() const noexcept
+{
+    return quantum[0] / 2.0;
+}
+
+/**
+ *  Returns the error bound of velocities in meters/second.
+ */
+template <uint32_t D> double BasicTrajectoryCodec<D>::getVelocityBound() const noexcept
+{
+    return quantum[D] / 2.0;
+}
+
+/**
+ *  Replaces bytes with the columns of frame. Throws std::range_error if
+ *  a value is too large, or not finite, to be quantized to its bound.
+ */
+template <uint32_t D>
+void BasicTrajectoryCodec<D>::encode(const Frame& frame, std::vector<uint8_t>& bytes)
+{
+    bytes.clear();
+    BitWriter writer(bytes);
+    const size_t rows = residuals.size();
+    for (uint32_t column : codingOrder()) {
+        const double* values = column < D ? frame.position[column].data()
+                                          : frame.velocity[column - D].data();
+        const double scale = 1.0 / quantum[column];
+        const double factor = displacementFactor(column, frame.time);
+        int64_t* previous = last[column].data();
+        int64_t* older = beforeLast[column].data();
+        uint64_t sum = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            const double scaled = values[i] * scale;
+            // Also rejects NaN.
+            if (!(std::fabs(scaled) < maxQuanta))
+                throw std::range_error("trajectory value " + std::to_string(values[i])
+                    + " cannot be quantized to its error bound");
+            const int64_t q = std::llround(scaled);
+            const int64_t residual = static_cast<int64_t>(
+                static_cast<uint64_t>(q) - static_cast<uint64_t>(predict(column, i, factor)));
+            // Zigzag maps residuals of either sign to small unsigned numbers.
+            const uint64_t code
+                = (static_cast<uint64_t>(residual) << 1) ^ static_cast<uint64_t>(residual >> 63);
+            residuals[i] = code;
+            sum += std::min<uint64_t>(code, uint64_t(1) << 40);
+            older[i] = previous[i];
+            previous[i] = q;
+        }
+
+        // The mean residual is close to the optimal Rice parameter's power of two.
+        uint32_t parameter = 0;
+        for (uint64_t mean = rows > 0 ? sum / rows : 0; mean > 1; mean >>= 1) {
+            ++parameter;
+        }
+        writer.put(parameter, parameterBits);
+        for (size_t i = 0; i < rows; ++i) {
+            const uint64_t code = residuals[i];
+            const uint64_t quotient = code >> parameter;
+            if (quotient >= escape) {
+                writer.put((uint64_t(1) << escape) - 1, escape);
+                writer.putWide(code, 64);
+            } else {
+                // quotient ones and the terminating zero.
+                writer.put((uint64_t(1) << quotient) - 1, static_cast<uint32_t>(quotient) + 1);
+                writer.putWide(code, parameter);
+            }
+        }
+    }
+    writer.flush();
+    history = std::min(history + 1, 2u);
+    lastTime = frame.time;
+}
+
+/**
+ *  Decodes the columns of the next frame from bytes into frame. Throws
+ *  std::runtime_error if bytes are not a valid frame.
+ */
+template <uint32_t D>
+void BasicTrajectoryCodec<D>::decode(const uint8_t* bytes, size_t count, Frame& frame)
+{
+    BitReader reader(bytes, count);
+    const size_t rows = residuals.size();
+    for (uint32_t column : codingOrder()) {
+        std::vector<double>& values
+            = column < D ? frame.position[column] : frame.velocity[column - D];
+        values.resize(rows);
+        const double factor = displacementFactor(column, frame.time);
+        int64_t* previous = last[column].data();
+        int64_t* older = beforeLast[column].data();
+        const uint32_t parameter = static_cast<uint32_t>(reader.get(parameterBits));
+        if (parameter > 62)
+            throw std::runtime_error("corrupt trajectory frame");
+        for (size_t i = 0; i < rows; ++i) {
+            // Count the ones of the quotient, at most the escape.
+            const uint64_t ones = ~reader.peek(escape) & ((uint64_t(1) << escape) - 1);
+            uint64_t code;
+            if (ones == 0) {
+                reader.skip(escape);
+                code = reader.get(64);
+            } else {
+                const uint32_t quotient = static_cast<uint32_t>(__builtin_ctzll(ones));
+                reader.skip(quotient + 1);
+                code = (uint64_t(quotient) << parameter) | reader.get(parameter);
+            }
+            // Unsigned arithmetic wraps instead of overflowing on corrupt input.
+            const uint64_t residual = (code >> 1) ^ (0 - (code & 1));
+            const int64_t q = static_cast<int64_t>(
+                static_cast<uint64_t>(predict(column, i, factor)) + residual);
+            older[i] = previous[i];
+            previous[i] = q;
+            values[i] = static_cast<double>(q) * quantum[column];
+        }
+    }
+    if (reader.overrun())
+        throw std::runtime_error("corrupt trajectory frame");
+    history = std::min(history + 1, 2u);
+    lastTime = frame.time;
+}
+
+/**
+ *  Forgets the previous frames, so that the next one is coded on its own.
+ */
+template <uint32_t D> void BasicTrajectoryCodec<D>::reset() noexcept
+{
+    history = 0;
+}
+
+/**
+ *  Returns the order the columns are coded in: the velocities first, so
+ *  that the positions can be predicted from them.
+ */
+template <uint32_t D> std::array<uint32_t, 2 * D> BasicTrajectoryCodec<D>::codingOrder() noexcept
+{
+    std::array<uint32_t, 2 * D> order;
+    for (uint32_t column = 0; column < 2 * D; ++column) {
+        order[column] = (column + D) % (2 * D);
+    }
+    return order;
+}
+
+/**
+ *  Returns the factor that turns the sum of a body's velocity quanta in
+ *  the previous and this frame into its displacement in quanta of the
+ *  given position column, or zero for velocity columns.
+ */
+template <uint32_t D>
+double BasicTrajectoryCodec<D>::displacementFactor(uint32_t column, double time) const noexcept
+{
+    if (column >= D || history == 0)
+        return 0.0;
+    const double factor = 0.5 * (time - lastTime) * quantum[D + column] / quantum[column];
+    return std::isfinite(factor) ? factor : 0.0;
+}
+
+/**
+ *  Returns the predicted quantum of a row of a column. A position moves by
+ *  the trapezoid rule over the velocities of the previous and this frame,
+ *  which are already known to both sides; a velocity follows the second
+ *  difference of its previous two quanta.
+ */
+template <uint32_t D>
+int64_t BasicTrajectoryCodec<D>::predict(uint32_t column, size_t row, double factor) const noexcept
+{
+    const int64_t previous = last[column][row];
+    if (history == 0)
+        return 0;
+    if (column < D) {
+        const double moved = (static_cast<double>(last[D + column][row])
+                                 + static_cast<double>(beforeLast[D + column][row]))
+            * factor;
+        if (!(std::fabs(moved) < maxQuanta))
+            return previous;
+        return static_cast<int64_t>(
+            static_cast<uint64_t>(previous) + static_cast<uint64_t>(std::llround(moved)));
+    }
+    if (history == 1)
+        return previous;
+    return static_cast<int64_t>(
+        2 * static_cast<uint64_t>(previous) - static_cast<uint64_t>(beforeLast[column][row]));
+}
+
+/**
+ *  Creates path and records the given rows, or every body if rows is
+ *  empty, every stride steps through a ring of capacity frames. Throws
+ *  std::invalid_argument if stride or capacity is zero and
+ *  std::runtime_error if path cannot be created.
+ */
+template <uint32_t D>
+BasicTrajectoryRecorder<D>::BasicTrajectoryRecorder(const std::string& path, uint64_t stride,
+    const std::vector<size_t>& rows, Policy policy, size_t capacity)
+    : path(path)
+    , stride(stride)
+    , current(stride)
+    , rows(rows)
+    , policy(policy)
+    , slots(capacity)
+    , out(path, std::ios::binary | std::ios::trunc)
+{
+    if (stride == 0 || capacity == 0)
+        throw std::invalid_argument("trajectory stride and capacity must be positive");
+    if (!out)
+        throw std::runtime_error(path + ": cannot create trajectory");
+}
+
+/**
+ *  Closes the recorder, ignoring a write error.
+ */
+template <uint32_t D> BasicTrajectoryRecorder<D>::~BasicTrajectoryRecorder()
+{
+    try {
+        close();
+    } catch (const std::exception&) {
+    }
+}
+
+/**
+ *  Compresses the frames with a BasicTrajectoryCodec of the given
+ *  error bounds, or stores them exactly if both are zero. Throws
+ *  std::invalid_argument for other bounds the codec rejects, and
+ *  std::logic_error once the first frame has been recorded.
+ */
+template <uint32_t D>
+void BasicTrajectoryRecorder<D>::setErrorBound(double positionBound, double velocityBound)
+{
+    if (started || closed)
+        throw std::logic_error(path + ": error bound set after recording");
+    // The codec validates the bounds.
+    if (positionBound != 0.0 || velocityBound != 0.0)
+        BasicTrajectoryCodec<D>(0, positionBound, velocityBound);
+    this->positionBound = positionBound;
+    this->velocityBound = velocityBound;
+}
+
+/**
+ *  Makes every frames-th frame a keyframe. Throws std::invalid_argument
+ *  if frames is zero and std::logic_error once the first frame has been
+ *  recorded.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::setKeyframeInterval(uint64_t frames)
+{
+    if (started || closed)
+        throw std::logic_error(path + ": keyframe interval set after recording");
+    if (frames == 0)
+        throw std::invalid_argument("keyframe interval must be positive");
+    keyframeInterval = frames;
+}
+
+/**
+ *  Offers the state of bodies at the given step. It is recorded if step
+ *  is a multiple of the stride, subject to the policy. Throws
+ *  std::out_of_range if a recorded row does not exist in bodies,
+ *  std::logic_error once closed and std::runtime_error once the writer
+ *  has failed.
+ */
+template <uint32_t D>
+void BasicTrajectoryRecorder<D>::record(const BasicBodyStore<D>& bodies, uint64_t step, double time)
+{
+    if (step % stride != 0)
+        return;
+    if (closed)
+        throw std::logic_error(path + ": trajectory recorder is closed");
+    checkWriter();
+    if (!started)
+        start(bodies);
+    if (!rows.empty() && maxRow >= bodies.size())
+        throw std::out_of_range(path + ": recorded row " + std::to_string(maxRow)
+            + " of " + std::to_string(bodies.size()) + " bodies");
+    if (step % current != 0) {
+        ++dropped;
+        return;
+    }
+
+    const uint64_t next = head.load(std::memory_order_relaxed);
+    uint64_t used = next - tail.load(std::memory_order_acquire);
+    if (used == slots.size()) {
+        if (policy == Policy::Drop) {
+            ++dropped;
+            return;
+        }
+        if (policy == Policy::Downsample) {
+            ++dropped;
+            current *= 2;
+            return;
+        }
+        ++late;
+        do {
+            std::this_thread::yield();
+            checkWriter();
+            used = next - tail.load(std::memory_order_acquire);
+        } while (used == slots.size());
+    }
+    if (policy == Policy::Downsample && current > stride && used <= slots.size() / 4)
+        current /= 2;
+
+    Frame& frame = slots[next % slots.size()];
+    frame.step = step;
+    frame.time = time;
+    for (uint32_t axis = 0; axis < D; ++axis) {
+        const double* position = bodies.position[axis].data();
+        const double* velocity = bodies.velocity[axis].data();
+        for (size_t i = 0; i < rows.size(); ++i) {
+            frame.position[axis][i] = position[rows[i]];
+            frame.velocity[axis][i] = velocity[rows[i]];
+        }
+    }
+    head.store(next + 1, std::memory_order_release);
+    ++recorded;
+}
+
+/**
+ *  Writes every recorded frame and the keyframe index, stops the writer
+ *  and closes the file. Throws std::runtime_error if any write failed.
+ *  Later calls do nothing.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::close()
+{
+    if (closed)
+        return;
+    closed = true;
+    if (!started)
+        writeHeader();
+    stopping.store(true, std::memory_order_release);
+    if (writer.joinable())
+        writer.join();
+    if (!failed.load(std::memory_order_acquire))
+        writeIndex();
+    out.close();
+    if (!out && !failed.load(std::memory_order_acquire)) {
+        error = path + ": cannot write trajectory";
+        failed.store(true, std::memory_order_release);
+    }
+    checkWriter();
+}
+
+/**
+ *  Returns the number of steps between recorded frames.
+ */
+template <uint32_t D> uint64_t BasicTrajectoryRecorder<D>::getStride() const noexcept
+{
+    return stride;
+}
+
+/**
+ *  Returns the recorded rows; empty until the first frame if every body
+ *  is recorded.
+ */
+template <uint32_t D>
+const std::vector<size_t>& BasicTrajectoryRecorder<D>::getRows() const noexcept
+{
+    return rows;
+}
+
+/**
+ *  Returns the number of frames handed to the writer.
+ */
+template <uint32_t D> uint64_t BasicTrajectoryRecorder<D>::getRecorded() const noexcept
+{
+    return recorded;
+}
+
+/**
+ *  Returns the number of sampled frames discarded by the Drop or
+ *  Downsample policy.
+ */
+template <uint32_t D> uint64_t BasicTrajectoryRecorder<D>::getDropped() const noexcept
+{
+    return dropped;
+}
+
+/**
+ *  Returns the number of frames the Block policy had to wait for.
+ */
+template <uint32_t D> uint64_t BasicTrajectoryRecorder<D>::getLate() const noexcept
+{
+    return late;
+}
+
+/**
+ *  Resolves the rows for bodies, allocates the slots, writes the file
+ *  header and starts the writer.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::start(const BasicBodyStore<D>& bodies)
+{
+    if (rows.empty()) {
+        rows.resize(bodies.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            rows[i] = i;
+        }
+    }
+    maxRow = rows.empty() ? 0 : *std::max_element(rows.begin(), rows.end());
+    for (Frame& frame : slots) {
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            frame.position[axis].resize(rows.size());
+            frame.velocity[axis].resize(rows.size());
+        }
+    }
+    if (positionBound != 0.0)
+        codec.reset(new BasicTrajectoryCodec<D>(rows.size(), positionBound, velocityBound));
+
+    writeHeader();
+    writer = std::thread(&BasicTrajectoryRecorder::writerLoop, this);
+    started = true;
+}
+
+/**
+ *  Writes the file header for the recorded rows.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::writeHeader()
+{
+    put(out, magic);
+    put(out, nativeTag);
+    put(out, VERSION);
+    put(out, D);
+    put(out, positionBound != 0.0 ? riceCodec : rawCodec);
+    put(out, uint64_t(rows.size()));
+    for (size_t row : rows) {
+        put(out, uint64_t(row));
+    }
+    if (positionBound != 0.0) {
+        put(out, positionBound);
+        put(out, velocityBound);
+    }
+    put(out, keyframeInterval);
+    offset = static_cast<uint64_t>(out.tellp());
+}
+
+/**
+ *  Body of the writer thread: drains the ring until stopped and empty.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::writerLoop()
+{
+    uint32_t idle = 0;
+    for (;;) {
+        const uint64_t next = tail.load(std::memory_order_relaxed);
+        if (next == head.load(std::memory_order_acquire)) {
+            // Every frame is published before stopping is set.
+            if (stopping.load(std::memory_order_acquire)
+                && next == head.load(std::memory_order_acquire))
+                break;
+            if (++idle < spinPolls)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        idle = 0;
+        // After a failure the frames are still drained, so a blocked simulation can go on.
+        if (!failed.load(std::memory_order_relaxed))
+            write(slots[next % slots.size()]);
+        tail.store(next + 1, std::memory_order_release);
+    }
+    if (!failed.load(std::memory_order_relaxed))
+        out.flush();
+    if (!out && !failed.load(std::memory_order_relaxed)) {
+        error = path + ": cannot write trajectory";
+        failed.store(true, std::memory_order_release);
+    }
+}
+
+/**
+ *  Appends a frame to the file, restarting the codec and adding an index
+ *  entry on keyframes.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::write(const Frame& frame)
+{
+    const bool keyframe = written % keyframeInterval == 0;
+    if (codec) {
+        if (keyframe)
+            codec->reset();
+        try {
+            codec->encode(frame, encoded);
+        } catch (const std::exception& failure) {
+            error = path + ": " + failure.what();
+            failed.store(true, std::memory_order_release);
+            return;
+        }
+    }
+    if (keyframe)
+        keyframes.push_back(TrajectoryKeyframe { frame.step, frame.time, offset });
+    put(out, frame.step);
+    put(out, frame.time);
+    if (codec) {
+        put(out, uint64_t(encoded.size()));
+        out.write(reinterpret_cast<const char*>(encoded.data()),
+            static_cast<std::streamsize>(encoded.size()));
+        offset += 3 * sizeof(uint64_t) + encoded.size();
+    } else {
+        const std::streamsize bytes = static_cast<std::streamsize>(rows.size() * sizeof(double));
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            out.write(reinterpret_cast<const char*>(frame.position[axis].data()), bytes);
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            out.write(reinterpret_cast<const char*>(frame.velocity[axis].data()), bytes);
+        }
+        offset += 2 * sizeof(uint64_t) + 2 * D * static_cast<uint64_t>(bytes);
+    }
+    ++written;
+    if (!out) {
+        error = path + ": cannot write trajectory";
+        failed.store(true, std::memory_order_release);
+    }
+}
+
+/**
+ *  Appends the keyframe index to the file.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::writeIndex()
+{
+    for (const TrajectoryKeyframe& keyframe : keyframes) {
+        put(out, keyframe.step);
+        put(out, keyframe.time);
+        put(out, keyframe.offset);
+    }
+    put(out, uint64_t(keyframes.size()));
+    put(out, offset);
+    put(out, indexMagic);
+}
+
+/**
+ *  Throws the writer's error once it has failed.
+ */
+template <uint32_t D> void BasicTrajectoryRecorder<D>::checkWriter() const
+{
+    if (failed.load(std::memory_order_acquire))
+        throw std::runtime_error(error);
+}
+
+/**
+ *  Opens path and reads its header. Throws std::runtime_error if it
+ *  cannot be read, is not a trajectory, or has another version or
+ *  number of dimensions.
+ */
+template <uint32_t D>
+BasicTrajectoryReader<D>::BasicTrajectoryReader(const std::string& path)
+    : path(path)
+    , in(path, std::ios::binary)
+{
+    if (!in)
+        throw std::runtime_error(path + ": cannot open trajectory");
+    char fileMagic[8] = {};
+    uint32_t tag = 0;
+    uint32_t version = 0;
+    uint32_t dimension = 0;
+    uint32_t format = 0;
+    uint64_t count = 0;
+    get(in, fileMagic);
+    get(in, tag);
+    get(in, version);
+    get(in, dimension);
+    get(in, format);
+    get(in, count);
+    if (!in || std::memcmp(fileMagic, magic, sizeof(magic)) != 0 || tag != nativeTag)
+        throw std::runtime_error(path + ": not a trajectory");
+    // Version 1 only differs in leaving the codec unset.
+    if (version == 0 || version > BasicTrajectoryRecorder<D>::VERSION)
+        throw std::runtime_error(
+            path + ": unsupported trajectory version " + std::to_string(version));
+    if (dimension != D)
+        throw std::runtime_error(path + ": trajectory has " + std::to_string(dimension)
+            + " dimensions, expected " + std::to_string(D));
+    if (format != rawCodec && format != riceCodec)
+        throw std::runtime_error(path + ": unknown trajectory codec " + std::to_string(format));
+    for (uint64_t i = 0; i < count && in; ++i) {
+        uint64_t row = 0;
+        get(in, row);
+        rows.push_back(static_cast<size_t>(row));
+    }
+    if (format == riceCodec) {
+        double positionBound = 0.0;
+        double velocityBound = 0.0;
+        get(in, positionBound);
+        get(in, velocityBound);
+        if (!in)
+            throw std::runtime_error(path + ": truncated trajectory");
+        try {
+            codec.reset(new BasicTrajectoryCodec<D>(rows.size(), positionBound, velocityBound));
+        } catch (const std::invalid_argument&) {
+            throw std::runtime_error(path + ": corrupt trajectory error bounds");
+        }
+    }
+    // Before version 3 every raw frame stands alone and compressed ones never do.
+    if (version >= 3)
+        get(in, keyframeInterval);
+    else if (codec)
+        keyframeInterval = UINT64_MAX;
+    if (!in)
+        throw std::runtime_error(path + ": truncated trajectory");
+    if (keyframeInterval == 0)
+        throw std::runtime_error(path + ": corrupt trajectory keyframe interval");
+    framesStart = static_cast<uint64_t>(in.tellg());
+    readIndex(version);
+    offset = framesStart;
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+}
+
+/**
+ *  Returns the rows of the recorded BodyStore, in column order.
+ */
+template <uint32_t D>
+const std::vector<size_t>& BasicTrajectoryReader<D>::getRows() const noexcept
+{
+    return rows;
+}
+
+/**
+ *  Returns the keyframe index.
+ */
+template <uint32_t D>
+const std::vector<TrajectoryKeyframe>& BasicTrajectoryReader<D>::getKeyframes() const noexcept
+{
+    return keyframes;
+}
+
+/**
+ *  Reads the next frame into frame and returns true, or returns false at
+ *  the end of the frames. Throws std::runtime_error if the frame is cut
+ *  short or corrupt.
+ */
+template <uint32_t D> bool BasicTrajectoryReader<D>::next(Frame& frame)
+{
+    if (hasPending) {
+        std::swap(frame, pending);
+        hasPending = false;
+        return true;
+    }
+    if (offset >= framesEnd)
+        return false;
+    // The stream is kept at offset, so reading on needs no seek.
+    const uint64_t bytes = codec ? 3 * sizeof(uint64_t)
+                                 : 2 * sizeof(uint64_t) + 2 * D * rows.size() * sizeof(double);
+    if (framesEnd - offset < bytes)
+        throw std::runtime_error(path + ": truncated trajectory");
+    get(in, frame.step);
+    get(in, frame.time);
+    if (codec) {
+        uint64_t count = 0;
+        get(in, count);
+        const uint64_t longest = 2 * D * (rows.size() * (escape + 64) + parameterBits) / 8 + 1;
+        if (!in || count > longest || framesEnd - offset - bytes < count)
+            throw std::runtime_error(path + ": truncated trajectory");
+        encoded.resize(static_cast<size_t>(count));
+        in.read(reinterpret_cast<char*>(encoded.data()), static_cast<std::streamsize>(count));
+        if (!in)
+            throw std::runtime_error(path + ": truncated trajectory");
+        if (frameIndex % keyframeInterval == 0)
+            codec->reset();
+        try {
+            codec->decode(encoded.data(), encoded.size(), frame);
+        } catch (const std::runtime_error& failure) {
+            throw std::runtime_error(path + ": " + failure.what());
+        }
+        offset += count;
+    } else {
+        const std::streamsize size = static_cast<std::streamsize>(rows.size() * sizeof(double));
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            frame.position[axis].resize(rows.size());
+            in.read(reinterpret_cast<char*>(frame.position[axis].data()), size);
+        }
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            frame.velocity[axis].resize(rows.size());
+            in.read(reinterpret_cast<char*>(frame.velocity[axis].data()), size);
+        }
+        if (!in)
+            throw std::runtime_error(path + ": truncated trajectory");
+    }
+    offset += bytes;
+    ++frameIndex;
+    return true;
+}
+
+/**
+ *  Positions the reader on the first frame at or after step, so that next
+ *  returns it, and returns true; or returns false if there is none.
+ */
+template <uint32_t D> bool BasicTrajectoryReader<D>::seek(uint64_t step)
+{
+    auto after = std::upper_bound(keyframes.begin(), keyframes.end(), step,
+        [](uint64_t value, const TrajectoryKeyframe& keyframe) { return value < keyframe.step; });
+    const size_t keyframe = after == keyframes.begin() ? 0 : after - keyframes.begin() - 1;
+    return seekFrom(keyframe, [step](const Frame& frame) { return frame.step >= step; });
+}
+
+/**
+ *  Positions the reader on the first frame at or after time, as seek.
+ */
+template <uint32_t D> bool BasicTrajectoryReader<D>::seekTime(double time)
+{
+    auto after = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+        [](double value, const TrajectoryKeyframe& keyframe) { return value < keyframe.time; });
+    const size_t keyframe = after == keyframes.begin() ? 0 : after - keyframes.begin() - 1;
+    return seekFrom(keyframe, [time](const Frame& frame) { return frame.time >= time; });
+}
+
+/**
+ *  Reads the index at the end of the file, or builds it by scanning the
+ *  frames if there is none. Leaves framesEnd after the last whole frame.
+ */
+template <uint32_t D> void BasicTrajectoryReader<D>::readIndex(uint32_t version)
+{
+    in.seekg(0, std::ios::end);
+    const uint64_t size = static_cast<uint64_t>(in.tellg());
+    if (version >= 3 && size >= framesStart + trailerBytes) {
+        uint64_t count = 0;
+        uint64_t indexOffset = 0;
+        char fileMagic[8] = {};
+        in.seekg(static_cast<std::streamoff>(size - trailerBytes));
+        get(in, count);
+        get(in, indexOffset);
+        get(in, fileMagic);
+        if (in && std::memcmp(fileMagic, indexMagic, sizeof(indexMagic)) == 0
+            && indexOffset >= framesStart && count <= size / keyframeBytes
+            && indexOffset + count * keyframeBytes + trailerBytes == size) {
+            in.seekg(static_cast<std::streamoff>(indexOffset));
+            keyframes.resize(static_cast<size_t>(count));
+            for (TrajectoryKeyframe& keyframe : keyframes) {
+                get(in, keyframe.step);
+                get(in, keyframe.time);
+                get(in, keyframe.offset);
+            }
+            if (in) {
+                framesEnd = indexOffset;
+                return;
+            }
+            keyframes.clear();
+        }
+        in.clear();
+    }
+
+    // Without an index, as after a crash, skip over every whole frame once.
+    framesEnd = size;
+    for (offset = framesStart; offset < size; ++frameIndex) {
+        const uint64_t bytes = frameBytes();
+        if (bytes == 0)
+            break;
+        if (frameIndex % keyframeInterval == 0) {
+            in.seekg(static_cast<std::streamoff>(offset));
+            TrajectoryKeyframe keyframe { 0, 0.0, offset };
+            get(in, keyframe.step);
+            get(in, keyframe.time);
+            keyframes.push_back(keyframe);
+        }
+        offset += bytes;
+    }
+    framesEnd = offset;
+    frameIndex = 0;
+}
+
+/**
+ *  Returns the number of bytes of the frame at offset, or zero if it is cut
+ *  short by the end of the frames or has an impossible length.
+ */
+template <uint32_t D> uint64_t BasicTrajectoryReader<D>::frameBytes()
+{
+    if (!codec) {
+        const uint64_t bytes = 2 * sizeof(uint64_t) + 2 * D * rows.size() * sizeof(double);
+        return framesEnd - offset >= bytes ? bytes : 0;
+    }
+    const uint64_t header = 3 * sizeof(uint64_t);
+    if (framesEnd - offset < header)
+        return 0;
+    uint64_t count = 0;
+    in.seekg(static_cast<std::streamoff>(offset + 2 * sizeof(uint64_t)));
+    get(in, count);
+    // Every value takes at most the escape and 64 bits, which bounds a sane length.
+    const uint64_t longest = 2 * D * (rows.size() * (escape + 64) + parameterBits) / 8 + 1;
+    if (!in || count > longest || framesEnd - offset - header < count) {
+        in.clear();
+        return 0;
+    }
+    return header + count;
+}
+
+/**
+ *  Moves to the given keyframe and reads up to the first frame for which
+ *  reached is true, keeping it for next. Returns false if there is none.
+ */
+template <uint32_t D>
+template <typename Reached>
+bool BasicTrajectoryReader<D>::seekFrom(size_t keyframe, const Reached& reached)
+{
+    hasPending = false;
+    if (keyframes.empty()) {
+        offset = framesEnd;
+        return false;
+    }
+    offset = keyframes[keyframe].offset;
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    // Saturates for files whose only keyframe is the first frame.
+    frameIndex = keyframeInterval == UINT64_MAX ? 0 : keyframe * keyframeInterval;
+    while (next(pending)) {
+        if (reached(pending)) {
+            hasPending = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+template class BasicTrajectoryCodec<2>;
+template class BasicTrajectoryCodec<3>;
+template class BasicTrajectoryRecorder<2>;
+template class BasicTrajectoryRecorder<3>;
+template class BasicTrajectoryReader<2>;
+template class BasicTrajectoryReader<3>;
+
+#endif
+// comment
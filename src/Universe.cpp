@@ -11,25 +11,169 @@
 
 #ifndef UNIVERSE_CPP
 #define UNIVERSE_CPP
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
+#include "../include/Checkpoint.h"
 #include "../include/Object.h"
 #include "../include/ObjectFactory.h"
+#include "../include/PerfCounters.h"
+#include "../include/Trace.h"
 #include "../include/Universe.h"
 #include "../include/Visitor.h"
 
 /**
  *  Returns the only instance of the Universe
  */
-Universe* Universe::inst = nullptr;
-;
-Universe* Universe ::instance()
+template <uint32_t D> BasicUniverse<D>* BasicUniverse<D>::inst = nullptr;
+
+namespace {
+/**
+ *  Adds what the counters count over the lifetime of the scope to a phase
+ *  of stats. Does nothing without counters.
+ */
+class PerfScope {
+public:
+    PerfScope(PerfCounters* counters, PerfStats* stats, PerfStats::Phase phase,
+        uint64_t interactions = 0) noexcept
+        : counters(counters)
+        , stats(stats)
+        , phase(phase)
+        , interactions(interactions)
+    {
+        if (counters)
+            start = counters->read();
+    }
+
+    ~PerfScope()
+    {
+        if (!counters)
+            return;
+        const PerfCounters::Values end = counters->read();
+        PerfCounters::Values delta;
+        // Scaling a multiplexed counter can move it back a little.
+        for (uint32_t counter = 0; counter < PerfCounters::COUNTERS; ++counter) {
+            delta[counter] = end[counter] > start[counter] ? end[counter] - start[counter] : 0;
+        }
+        stats->add(phase, delta, interactions);
+    }
+
+    PerfScope(const PerfScope& rhs) = delete;
+    PerfScope& operator=(const PerfScope& rhs) = delete;
+
+private:
+    PerfCounters* counters;
+    PerfStats* stats;
+    PerfStats::Phase phase;
+    uint64_t interactions;
+    PerfCounters::Values start {};
+};
+
+/**
+ *  Force engine that counts every evaluation of the engine it forwards to
+ *  as the force phase, over the pairs a direct sum would visit.
+ */
+template <uint32_t D> class CountingEngine : public BasicForceEngine<D> {
+public:
+    typedef typename BasicForceEngine<D>::Accelerations Accelerations;
+
+    CountingEngine(BasicForceEngine<D>& engine, PerfCounters& counters, PerfStats& stats)
+        : engine(engine)
+        , counters(counters)
+        , stats(stats)
+    {
+    }
+
+    virtual void computeAccelerations(
+        const BasicBodyStore<D>& bodies, Accelerations& acc, ThreadPool& pool)
+    {
+        const uint64_t count = bodies.size();
+        PerfScope counted(&counters, &stats, PerfStats::Force, count > 0 ? count * (count - 1) : 0);
+        engine.computeAccelerations(bodies, acc, pool);
+    }
+
+    virtual uint64_t getGeneration() const noexcept
+    {
+        return engine.getGeneration();
+    }
+
+private:
+    BasicForceEngine<D>& engine;
+    PerfCounters& counters;
+    PerfStats& stats;
+};
+
+/**
+ *  Returns the shortest time in which a movable body of state, starting at
+ *  rest, would fall the distance to the first body with acceleration acc,
+ *  up to a constant. On a circular orbit it is the inverse angular
+ *  velocity. Infinite if no body accelerates.
+ */
+template <uint32_t D>
+double freeFallTime(
+    const BasicBodyStore<D>& state, const typename BasicForceEngine<D>::Accelerations& acc)
+{
+    double shortest = std::numeric_limits<double>::infinity();
+    for (size_t i = 1; i < state.size(); ++i) {
+        double distSq = 0.0;
+        double accSq = 0.0;
+        for (uint32_t axis = 0; axis < D; ++axis) {
+            const double d = state.position[axis][i] - state.position[axis][0];
+            distSq += d * d;
+            accSq += acc[axis][i] * acc[axis][i];
+        }
+        if (distSq > 0.0 && accSq > 0.0)
+            shortest = std::min(shortest, std::sqrt(std::sqrt(distSq / accSq)));
+    }
+    return shortest;
+}
+
+/**
+ *  Returns the largest change from start to end of the acceleration of a
+ *  movable body relative to the larger of the two, or zero if none moves.
+ */
+template <typename Accelerations>
+double accelerationChange(const Accelerations& start, const Accelerations& end)
+{
+    double largest = 0.0;
+    for (size_t i = 1; i < start[0].size(); ++i) {
+        double changeSq = 0.0;
+        double startSq = 0.0;
+        double endSq = 0.0;
+        for (size_t axis = 0; axis < start.size(); ++axis) {
+            const double d = end[axis][i] - start[axis][i];
+            changeSq += d * d;
+            startSq += start[axis][i] * start[axis][i];
+            endSq += end[axis][i] * end[axis][i];
+        }
+        const double scaleSq = std::max(startSq, endSq);
+        if (scaleSq > 0.0)
+            largest = std::max(largest, std::sqrt(changeSq / scaleSq));
+    }
+    return largest;
+}
+}
+
+/**
+ *  Private constructor. Ensures access control.
+ */
+template <uint32_t D>
+BasicUniverse<D>::BasicUniverse()
+    : engine(new BasicDirectEngine<D>())
+    , integrator(new BasicEulerIntegrator<D>())
+{
+}
+
+template <uint32_t D> BasicUniverse<D>* BasicUniverse<D>::instance()
 {
     if (inst == nullptr) {
-        inst = new Universe();
+        inst = new BasicUniverse();
     }
     return inst;
 }
@@ -37,9 +181,10 @@ Universe* Universe ::instance()
 /**
  *  Releases all the dynamic objects still registered with the Universe.
  */
-Universe ::~Universe()
+template <uint32_t D> BasicUniverse<D>::~BasicUniverse()
 {
     release(objects);
+    bodies.clear();
     inst = nullptr;
 }
 
@@ -48,7 +193,18 @@ Universe ::~Universe()
  *  will be the same as that over getSnapshot()'s result as long as no new
  *  objects are added to either of the containers.
  */
-Universe::iterator Universe::begin()
+template <uint32_t D> typename BasicUniverse<D>::iterator BasicUniverse<D>::begin()
+{
+    return objects.begin();
+}
+
+/**
+ *  Returns the begin iterator to the actual Objects. The order of iteration
+ *  will be the same as that over getSnapshot()'s result as long as no new
+ *  objects are added to either of the containers.
+ */
+template <uint32_t D>
+typename BasicUniverse<D>::const_iterator BasicUniverse<D>::begin() const
 {
     return objects.begin();
 }
@@ -58,7 +214,7 @@ Universe::iterator Universe::begin()
  *  will be the same as that over getSnapshot()'s result as long as no new
  *  objects are added to either of the containers.
  */
-Universe::iterator Universe::end()
+template <uint32_t D> typename BasicUniverse<D>::iterator BasicUniverse<D>::end()
 {
     return objects.end();
 }
@@ -68,7 +224,8 @@ Universe::iterator Universe::end()
  *  will be the same as that over getSnapshot()'s result as long as no new
  *  objects are added to either of the containers.
  */
-Universe::const_iterator Universe::end() const
+template <uint32_t D>
+typename BasicUniverse<D>::const_iterator BasicUniverse<D>::end() const
 {
     return objects.end();
 }
@@ -78,9 +235,12 @@ Universe::const_iterator Universe::end() const
  *  Universe. This should be used as the source of data for computing the
  *  next step in the simulation
  */
-std::vector<Object*> Universe ::getSnapshot() const
+template <uint32_t D>
+std::vector<BasicObject<D>*> BasicUniverse<D>::getSnapshot() const
 {
+    TRACE_SCOPE("Universe::getSnapshot");
     std::vector<Object*> ret;
+    ret.reserve(objects.size());
     for (Object* obj : objects) {
         ret.push_back(obj->clone());
     }
@@ -91,57 +251,521 @@ std::vector<Object*> Universe ::getSnapshot() const
  *  Advances the simulation by the provided time step. For this assignment,
  *  you must assume that the first registered object is a "sun" and its
  *  position should not be affected by any of the other objects.
- *
  */
-void Universe ::stepSimulation(const double& timeSec)
+template <uint32_t D> void BasicUniverse<D>::stepSimulation(const double& timeSec)
 {
-    std::vector<Object*> thisObj = getSnapshot();
-    for (uint32_t i = 1; i < thisObj.size(); ++i) {
-        vector2 forces = vector2();
-        for (uint32_t j = 0; j < thisObj.size(); ++j) {
-            if (i != j) {
-                forces += objects[i]->getForce(*objects[j]);
+    TRACE_SCOPE("Universe::stepSimulation");
+    takeStep(bodies, timeSec);
+}
+
+/**
+ *  Advances the simulation by steps consecutive time steps of timeSec,
+ *  producing the same state as that many calls to stepSimulation. The
+ *  steps run on private scratch columns: the registered Objects are only
+ *  updated every stride steps and after the last one, and sample is then
+ *  called with the number of steps taken so far. A stride of zero updates
+ *  the Objects once, at the end.
+ */
+template <uint32_t D>
+void BasicUniverse<D>::advance(const double& timeSec, uint64_t steps, uint64_t stride,
+    const std::function<void(uint64_t)>& sample)
+{
+    if (steps == 0)
+        return;
+    TRACE_SCOPE("Universe::advance");
+    // Copying reuses the scratch capacity, so repeated calls do not allocate.
+    scratch.copyState(bodies);
+
+    for (uint64_t step = 1; step <= steps; ++step) {
+        takeStep(scratch, timeSec);
+        if (step != steps && (stride == 0 || step % stride != 0))
+            continue;
+        sync();
+        if (sample)
+            sample(step);
+    }
+}
+
+/**
+ *  Advances the simulation to endTime in steps that keep the relative
+ *  change of every acceleration over them within tolerance, publishing the
+ *  Objects every stride steps and after the last one. Returns the number of
+ *  steps taken.
+ */
+template <uint32_t D>
+uint64_t BasicUniverse<D>::advanceTo(double endTime, double tolerance, uint64_t stride,
+    const std::function<void(uint64_t)>& sample)
+{
+    if (!(tolerance > 0.0) || !std::isfinite(tolerance))
+        throw std::invalid_argument("adaptive tolerance must be positive");
+    if (!(endTime >= time) || !std::isfinite(endTime))
+        throw std::invalid_argument("adaptive end time lies before the current time");
+    if (endTime == time)
+        return 0;
+    TRACE_SCOPE("Universe::advanceTo");
+    scratch.copyState(bodies);
+
+    // The usual safety factor and bounds of step size control.
+    const double safety = 0.9;
+    const double maxGrowth = 2.0;
+    const double maxShrink = 0.1;
+    double proposed = 0.0;
+    uint64_t steps = 0;
+    bool last = false;
+    while (!last) {
+        double span = 0.0;
+        {
+            if (stats)
+                stats->beginStep();
+            PerfScope counted(counters.get(), stats.get(), PerfStats::Step);
+            // Assignment reuses the capacity, so steps do not allocate.
+            startAcceleration = integrator->getAccelerations(scratch, forces(), pool);
+            if (proposed == 0.0)
+                proposed = tolerance * freeFallTime(scratch, startAcceleration);
+            while (true) {
+                const double remaining = endTime - time;
+                last = proposed >= remaining;
+                span = proposed;
+                if (last)
+                    span = remaining;
+                else if (2.0 * proposed > remaining)
+                    // Two even steps rather than a full one and a sliver.
+                    span = 0.5 * remaining;
+                if (time + span == time) {
+                    sync();
+                    throw std::runtime_error(
+                        "adaptive step vanished at time " + std::to_string(time));
+                }
+                backup.copyState(scratch);
+                integrate(scratch, span);
+                const double change = accelerationChange(
+                    startAcceleration, integrator->getAccelerations(scratch, forces(), pool));
+                // The change grows linearly with the step.
+                const double factor = change > 0.0 ? safety * tolerance / change : maxGrowth;
+                if (change <= tolerance) {
+                    // A step cut short to end on time says nothing against longer ones.
+                    const double next = span * std::min(factor, maxGrowth);
+                    proposed = span < proposed ? std::max(proposed, next) : next;
+                    break;
+                }
+                TRACE_SCOPE("Universe::reject");
+                ++rejected;
+                scratch.copyState(backup);
+                // The retry starts where this trial did, so it needs no evaluation there.
+                integrator->seedAccelerations(scratch, forces(), startAcceleration);
+                proposed = span * std::max(factor, maxShrink);
             }
+            // Rounding may leave time + remaining an ulp off the end.
+            finishStep(scratch, last ? endTime : time + span);
         }
-        vector2 acceleration = forces / objects[i]->getMass();
-        vector2 velocity = objects[i]->getVelocity() + acceleration * timeSec;
-        vector2 position = objects[i]->getPosition() + (objects[i]->getVelocity() * timeSec);
-        thisObj[i]->setVelocity(velocity);
-        thisObj[i]->setPosition(position);
+        ++steps;
+        if (!last && (stride == 0 || steps % stride != 0))
+            continue;
+        sync();
+        if (sample)
+            sample(steps);
     }
-    swap(thisObj);
+    return steps;
+}
+
+/**
+ *  Returns the number of steps advanceTo has rejected and retried.
+ */
+template <uint32_t D> uint64_t BasicUniverse<D>::getRejectedSteps() const noexcept
+{
+    return rejected;
+}
+
+/**
+ *  Returns the simulated time in seconds: the sum of the time steps taken
+ *  since the Universe was created, or of those recorded in the last
+ *  checkpoint loaded plus the steps taken since.
+ */
+template <uint32_t D> double BasicUniverse<D>::getTime() const noexcept
+{
+    return time;
+}
+
+/**
+ *  Returns the number of steps taken, counted the same way.
+ */
+template <uint32_t D> uint64_t BasicUniverse<D>::getStepCount() const noexcept
+{
+    return stepCount;
+}
+
+/**
+ *  Writes every body, the time and the step count to a binary checkpoint
+ *  at path; see BasicCheckpoint for the format. Throws std::runtime_error
+ *  if the file cannot be written.
+ */
+template <uint32_t D> void BasicUniverse<D>::saveCheckpoint(const std::string& path) const
+{
+    TRACE_SCOPE("Universe::saveCheckpoint");
+    BasicCheckpoint<D>::save(path, bodies, time, stepCount);
+}
+
+/**
+ *  Replaces every body, the time and the step count with those of the
+ *  checkpoint at path. Throws std::runtime_error, leaving the Universe
+ *  unchanged, if it cannot be loaded.
+ */
+template <uint32_t D> void BasicUniverse<D>::loadCheckpoint(const std::string& path)
+{
+    TRACE_SCOPE("Universe::loadCheckpoint");
+    BasicCheckpoint<D> checkpoint(path);
+    checkpoint.restore(bodies);
+    time = checkpoint.getTime();
+    stepCount = checkpoint.getSteps();
+    rebindViews();
+    // The loaded state does not continue the steps kept so far.
+    if (dense)
+        dense->clear();
+    sampleDense(bodies);
+    if (diagnostics)
+        diagnostics->clear();
+    diagnose(bodies);
+}
+
+/**
+ *  Starts writing the same checkpoint as saveCheckpoint from a forked
+ *  child process and returns while it is written, so stepping can go on
+ *  meanwhile; the file holds the state at the time of this call. A
+ *  checkpoint still being written is waited for first. Throws
+ *  std::runtime_error if that one failed or the fork does.
+ */
+template <uint32_t D> void BasicUniverse<D>::saveCheckpointInBackground(const std::string& path)
+{
+    TRACE_SCOPE("Universe::saveCheckpointInBackground");
+    BasicCheckpoint<D>::saveInBackground(path, bodies, time, stepCount, background);
+}
+
+/**
+ *  Returns true while a background checkpoint is being written. Throws
+ *  std::runtime_error if it has failed.
+ */
+template <uint32_t D> bool BasicUniverse<D>::checkpointPending()
+{
+    return background.pending();
+}
+
+/**
+ *  Blocks until the background checkpoint, if any, is written. Throws
+ *  std::runtime_error if it failed.
+ */
+template <uint32_t D> void BasicUniverse<D>::waitForCheckpoint()
+{
+    TRACE_SCOPE("Universe::waitForCheckpoint");
+    background.wait();
 }
 
 /**
  *  Swaps the contents of the provided container with the Universe's Object
  *  store and releases the old Objects.
+ *
+ *  The snapshot's state is copied into the column store, so the registered
+ *  views stay valid; the snapshot copies are the Objects that get released.
  */
-void Universe ::swap(std::vector<Object*>& snapshot)
+template <uint32_t D> void BasicUniverse<D>::swap(std::vector<Object*>& snapshot)
 {
-    objects.swap(snapshot);
+    TRACE_SCOPE("Universe::swap");
+    bodies.resize(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const Object& obj = *snapshot[i];
+        bodies.set(i, obj.getName(), obj.getMass(), obj.getPosition(), obj.getVelocity());
+    }
+    rebindViews();
     release(snapshot);
 }
 
+/**
+ *  Returns the column store backing the registered Objects.
+ */
+template <uint32_t D> const BasicBodyStore<D>& BasicUniverse<D>::getBodies() const noexcept
+{
+    return bodies;
+}
+
+/**
+ *  Replaces the strategy used to evaluate gravity in stepSimulation. The
+ *  default is a DirectEngine.
+ */
+template <uint32_t D>
+void BasicUniverse<D>::setForceEngine(std::unique_ptr<ForceEngine> engine)
+{
+    if (!engine)
+        return;
+    this->engine = std::move(engine);
+    if (diagnostics)
+        this->engine->setPotentials(&potential);
+    if (counting)
+        counting.reset(new CountingEngine<D>(*this->engine, *counters, *stats));
+}
+
+/**
+ *  Returns the strategy used to evaluate gravity.
+ */
+template <uint32_t D> BasicForceEngine<D>& BasicUniverse<D>::getForceEngine() noexcept
+{
+    return *engine;
+}
+
+/**
+ *  Replaces the scheme stepSimulation and advance move the bodies with.
+ *  The default is an EulerIntegrator.
+ */
+template <uint32_t D>
+void BasicUniverse<D>::setIntegrator(std::unique_ptr<Integrator> integrator)
+{
+    if (integrator)
+        this->integrator = std::move(integrator);
+}
+
+/**
+ *  Returns the scheme the bodies are moved with.
+ */
+template <uint32_t D> BasicIntegrator<D>& BasicUniverse<D>::getIntegrator() noexcept
+{
+    return *integrator;
+}
+
+/**
+ *  Attaches a recorder that the state after every step is offered to,
+ *  including the steps advance takes between updates of the Objects.
+ *  The current state is offered at once. A previous recorder is detached
+ *  and closed; a null one only detaches it.
+ */
+template <uint32_t D>
+void BasicUniverse<D>::setRecorder(std::unique_ptr<Recorder> recorder)
+{
+    std::unique_ptr<Recorder> previous = std::move(this->recorder);
+    this->recorder = std::move(recorder);
+    if (this->recorder)
+        this->recorder->record(bodies, stepCount, time);
+    if (previous)
+        previous->close();
+}
+
+/**
+ *  Returns the attached recorder, or null.
+ */
+template <uint32_t D> BasicTrajectoryRecorder<D>* BasicUniverse<D>::getRecorder() noexcept
+{
+    return recorder.get();
+}
+
+/**
+ *  Keeps the state and accelerations at the ends of the last window steps,
+ *  including those advance takes between updates of the Objects, so the
+ *  bodies can be interpolated at any time in between. The current state is
+ *  kept at once. Zero stops keeping them.
+ */
+template <uint32_t D> void BasicUniverse<D>::setDenseOutput(size_t window)
+{
+    dense.reset(window > 0 ? new DenseOutput(window) : nullptr);
+    sampleDense(bodies);
+}
+
+/**
+ *  Returns the dense output, or null.
+ */
+template <uint32_t D>
+const BasicDenseOutput<D>* BasicUniverse<D>::getDenseOutput() const noexcept
+{
+    return dense.get();
+}
+
+/**
+ *  Starts updating the conserved quantities after every step from the
+ *  current state, or stops if not enabled.
+ */
+template <uint32_t D> void BasicUniverse<D>::setDiagnostics(bool enabled)
+{
+    diagnostics.reset(enabled ? new Diagnostics() : nullptr);
+    engine->setPotentials(enabled ? &potential : nullptr);
+    diagnose(bodies);
+}
+
+/**
+ *  Returns the conserved quantities, or null.
+ */
+template <uint32_t D>
+const BasicDiagnostics<D>* BasicUniverse<D>::getDiagnostics() const noexcept
+{
+    return diagnostics.get();
+}
+
+/**
+ *  Sets the number of threads stepSimulation runs on, counting the calling
+ *  thread. Zero selects one per hardware thread. The workers are created
+ *  here and reused by every step.
+ */
+template <uint32_t D> void BasicUniverse<D>::setThreadCount(uint32_t threads)
+{
+    pool.resize(threads);
+}
+
+/**
+ *  Returns the number of threads stepSimulation runs on.
+ */
+template <uint32_t D> uint32_t BasicUniverse<D>::getThreadCount() const noexcept
+{
+    return pool.size();
+}
+
+/**
+ *  Starts counting the hardware events of every step from zero, on the
+ *  calling thread, or stops counting if not enabled.
+ */
+template <uint32_t D> void BasicUniverse<D>::setPerfCounters(bool enabled)
+{
+    counting.reset();
+    stats.reset();
+    counters.reset();
+    if (!enabled)
+        return;
+    counters.reset(new PerfCounters());
+    stats.reset(new PerfStats(*counters));
+    counting.reset(new CountingEngine<D>(*engine, *counters, *stats));
+}
+
+/**
+ *  Returns the counts of the steps taken since counting started, or null.
+ */
+template <uint32_t D> const PerfStats* BasicUniverse<D>::getPerfStats() const noexcept
+{
+    return stats.get();
+}
+
 /**
  *  Registers an Object with the universe. The Universe will clean up this
  *  object when it deems necessary.
  */
-Object* Universe::addObject(Object* ptr)
+template <uint32_t D> BasicObject<D>* BasicUniverse<D>::addObject(Object* ptr)
 {
+    size_t row = bodies.add(ptr->getName(), ptr->getMass(), ptr->getPosition(), ptr->getVelocity());
+    ptr->bind(&bodies, row);
     objects.push_back(ptr);
     return ptr;
 }
 
+/**
+ *  Makes objects hold exactly one view per row of bodies.
+ */
+template <uint32_t D> void BasicUniverse<D>::rebindViews()
+{
+    while (objects.size() > bodies.size()) {
+        delete objects.back();
+        objects.pop_back();
+    }
+    while (objects.size() < bodies.size()) {
+        objects.push_back(new Object(std::string(), 0, Vector<D>(), Vector<D>()));
+    }
+    for (size_t row = 0; row < objects.size(); ++row) {
+        objects[row]->bind(&bodies, row);
+    }
+}
+
+/**
+ *  Adds state at the current time to the dense output, if any.
+ */
+template <uint32_t D> void BasicUniverse<D>::sampleDense(const BodyStore& state)
+{
+    if (!dense)
+        return;
+    TRACE_SCOPE("Universe::sampleDense");
+    dense->record(state, time, integrator->getAccelerations(state, forces(), pool));
+}
+
+/**
+ *  Updates the diagnostics, if any, with state at the current time. The
+ *  potentials are those the engine filled when it last evaluated state.
+ */
+template <uint32_t D> void BasicUniverse<D>::diagnose(const BodyStore& state)
+{
+    if (!diagnostics)
+        return;
+    TRACE_SCOPE("Universe::diagnose");
+    // Usually the step ended with an evaluation at state; otherwise this is
+    // one, and the next step reuses it.
+    integrator->getAccelerations(state, forces(), pool);
+    if (!engine->hasPotentials(state))
+        potential.clear();
+    diagnostics->update(state, potential, time, stepCount);
+}
+
+/**
+ *  Takes one step of timeSec on state, then offers it to the recorder, the
+ *  dense output and the diagnostics, counting each phase if counters are
+ *  enabled.
+ */
+template <uint32_t D> void BasicUniverse<D>::takeStep(BodyStore& state, const double& timeSec)
+{
+    if (stats)
+        stats->beginStep();
+    PerfScope counted(counters.get(), stats.get(), PerfStats::Step);
+    integrate(state, timeSec);
+    finishStep(state, time + timeSec);
+}
+
+/**
+ *  Moves state by timeSec with the integrator, without counting the step.
+ */
+template <uint32_t D> void BasicUniverse<D>::integrate(BodyStore& state, const double& timeSec)
+{
+    TRACE_SCOPE("Integrator::step");
+    integrator->step(state, timeSec, forces(), pool);
+}
+
+/**
+ *  Counts the step just integrated on state up to endTime and offers it to
+ *  the recorder, the dense output and the diagnostics.
+ */
+template <uint32_t D> void BasicUniverse<D>::finishStep(BodyStore& state, double endTime)
+{
+    time = endTime;
+    ++stepCount;
+    PerfScope output(counters.get(), stats.get(), PerfStats::Output);
+    if (recorder) {
+        TRACE_SCOPE("TrajectoryRecorder::record");
+        recorder->record(state, stepCount, time);
+    }
+    sampleDense(state);
+    diagnose(state);
+}
+
+/**
+ *  Copies the scratch positions, velocities and masses to the bodies.
+ */
+template <uint32_t D> void BasicUniverse<D>::sync()
+{
+    TRACE_SCOPE("Universe::sync");
+    bodies.copyState(scratch);
+}
+
+/**
+ *  Returns the engine the integrator is handed: the force engine, or the
+ *  one counting it.
+ */
+template <uint32_t D> BasicForceEngine<D>& BasicUniverse<D>::forces() noexcept
+{
+    return counting ? *counting : *engine;
+}
+
 /**
  *  Calls delete on each pointer and removes it from the container.
  */
-void Universe ::release(std::vector<Object*>& object)
+template <uint32_t D> void BasicUniverse<D>::release(std::vector<Object*>& object)
 {
+    TRACE_SCOPE("Universe::release");
     for (uint32_t i = 0; i < object.size(); ++i) {
         delete object[i];
     }
     object.clear();
 }
 
+template class BasicUniverse<2>;
+template class BasicUniverse<3>;
+
 #endif
 // comment
\ No newline at end of file
@@ -18,7 +18,8 @@
 /**
  *  Construct a visitor that prints to the provided ostream.
  */
-PrintVisitor ::PrintVisitor(std::ostream& os)
+template <uint32_t D>
+BasicPrintVisitor<D>::BasicPrintVisitor(std::ostream& os)
     : os(os)
 {
 }
@@ -26,10 +27,13 @@ PrintVisitor ::PrintVisitor(std::ostream& os)
 /**
  *  Prints the object's name.
  */
-void PrintVisitor ::visit(Object& object)
+template <uint32_t D> void BasicPrintVisitor<D>::visit(BasicObject<D>& object)
 {
     os << object.getName();
 }
 
+template class BasicPrintVisitor<2>;
+template class BasicPrintVisitor<3>;
+
 #endif
 // comment
\ No newline at end of file
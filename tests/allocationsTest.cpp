@@ -0,0 +1,159 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "Allocations.h"
+#include "BarnesHutEngine.h"
+#include "BlockIntegrator.h"
+#include "FmmEngine.h"
+#include "ForceEngine.h"
+#include "Integrator.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "PerfCounters.h"
+#include "PmEngine.h"
+#include "SimdEngine.h"
+#include "Universe.h"
+#include <functional>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The fixture for testing the accounting of heap allocations.
+class AllocationsTest : public ::testing::Test {
+protected:
+    /**
+     *  Returns the allocations made by work while tracking.
+     */
+    static Allocations::Counts during(const std::function<void()>& work)
+    {
+        Allocations::enable();
+        const Allocations::Counts before = Allocations::get();
+        work();
+        const Allocations::Counts after = Allocations::get();
+        Allocations::disable();
+        Allocations::Counts counts;
+        counts.allocations = after.allocations - before.allocations;
+        counts.deallocations = after.deallocations - before.deallocations;
+        counts.bytes = after.bytes - before.bytes;
+        return counts;
+    }
+};
+
+TEST_F(AllocationsTest, CountsWhileTracking)
+{
+    EXPECT_FALSE(Allocations::isEnabled());
+    const Allocations::Counts before = Allocations::get();
+    std::unique_ptr<std::vector<double>> untracked(new std::vector<double>(64));
+    untracked.reset();
+    EXPECT_EQ(Allocations::get().allocations, before.allocations);
+
+    Allocations::Counts counts = during([] {
+        std::vector<double> values(100);
+        std::unique_ptr<int[]> array(new int[10]);
+    });
+    EXPECT_EQ(counts.allocations, 2u);
+    EXPECT_EQ(counts.deallocations, 2u);
+    EXPECT_EQ(counts.bytes, 100 * sizeof(double) + 10 * sizeof(int));
+
+    // Tracking nests.
+    Allocations::enable();
+    counts = during([] { std::string("a string too long to be stored in place"); });
+    EXPECT_TRUE(Allocations::isEnabled());
+    Allocations::disable();
+    EXPECT_FALSE(Allocations::isEnabled());
+    EXPECT_EQ(counts.allocations, 1u);
+}
+
+TEST_F(AllocationsTest, CountsHugePageColumns)
+{
+    EXPECT_TRUE(Allocations::isHooked());
+    // Just past a huge page per column, which ColumnAllocator maps itself.
+    const size_t rows = ColumnAllocator<double>::HUGE_PAGE / sizeof(double) + 1;
+    Allocations::Counts counts = during([rows] {
+        BodyStore bodies;
+        bodies.resize(rows);
+    });
+    EXPECT_EQ(counts.allocations, 6u);
+    EXPECT_EQ(counts.deallocations, 6u);
+    EXPECT_EQ(counts.bytes, 5 * rows * sizeof(double) + rows * sizeof(std::string));
+
+    // Steady-state steps at that size do not allocate either.
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makePlanetarySystem(rows - 1);
+    univ->setForceEngine(std::unique_ptr<ForceEngine>(new PmEngine(64)));
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    counts = during([&] { univ->advance(3600, 1); });
+    EXPECT_GE(counts.bytes, 5 * rows * sizeof(double));
+    counts = during([&] { univ->advance(3600, 2); });
+    EXPECT_EQ(counts.allocations, 0u);
+    EXPECT_EQ(counts.deallocations, 0u);
+}
+
+TEST_F(AllocationsTest, SteadyStateStepsDoNotAllocate)
+{
+    const std::vector<std::pair<std::string, std::function<ForceEngine*()>>> engines = {
+        { "direct", [] { return new DirectEngine(); } },
+        { "symmetric", [] { return new SymmetricEngine(); } },
+        { "simd", [] { return new SimdEngine(); } },
+        { "simd/mixed", [] { return new SimdEngine(SimdEngine::Precision::Mixed); } },
+        { "barnes-hut", [] { return new BarnesHutEngine(); } },
+        { "fmm", [] { return new FmmEngine(); } },
+        { "pm", [] { return new PmEngine(64); } },
+    };
+    const std::vector<std::pair<std::string, std::function<Integrator*()>>> integrators = {
+        { "euler", [] { return new EulerIntegrator(); } },
+        { "leapfrog", [] { return new LeapfrogIntegrator(); } },
+        { "verlet", [] { return new VerletIntegrator(); } },
+        { "yoshida", [] { return new YoshidaIntegrator(); } },
+        { "block", [] { return new BlockIntegrator(); } },
+    };
+    for (uint32_t threads : { 1u, 3u }) {
+        for (const auto& engine : engines) {
+            for (const auto& integrator : integrators) {
+                SCOPED_TRACE(engine.first + " " + integrator.first + " on "
+                    + std::to_string(threads) + " threads");
+                std::unique_ptr<Universe> univ(Universe::instance());
+                makePlanetarySystem(199);
+                univ->setThreadCount(threads);
+                univ->setForceEngine(std::unique_ptr<ForceEngine>(engine.second()));
+                univ->setIntegrator(std::unique_ptr<Integrator>(integrator.second()));
+                univ->setDenseOutput(4);
+                univ->setDiagnostics(true);
+                // Warming up sizes every buffer of the engine and integrator.
+                univ->advance(3600, 8);
+                univ->stepSimulation(3600);
+                univ->advanceTo(univ->getTime() + 4 * 3600, 1e-2);
+
+                const Allocations::Counts counts = during([&] {
+                    for (int step = 0; step < 4; ++step) {
+                        univ->stepSimulation(3600);
+                    }
+                    univ->advance(3600, 4, 2);
+                    univ->advanceTo(univ->getTime() + 4 * 3600, 1e-2, 2);
+                });
+                EXPECT_EQ(counts.allocations, 0u);
+                EXPECT_EQ(counts.deallocations, 0u);
+            }
+        }
+    }
+}
+
+TEST_F(AllocationsTest, CountsAllocationsPerPhase)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makePlanetarySystem(199);
+    univ->setPerfCounters(true);
+    univ->stepSimulation(3600);
+    univ->stepSimulation(3600);
+    const PerfStats& stats = *univ->getPerfStats();
+    EXPECT_TRUE(stats.isAvailable(PerfCounters::Allocations));
+    EXPECT_EQ(stats.getCounts(PerfStats::Step).values[PerfCounters::Allocations], 0u);
+
+    // Cloning every Object for a snapshot allocates outside the steps.
+    const Allocations::Counts counts = during([&] {
+        std::vector<Object*> snapshot = univ->getSnapshot();
+        univ->swap(snapshot);
+    });
+    EXPECT_GE(counts.allocations, 200u);
+    EXPECT_EQ(counts.allocations, counts.deallocations);
+}
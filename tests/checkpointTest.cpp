@@ -0,0 +1,266 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "Checkpoint.h"
+#include "Integrator.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "Universe.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The fixture for testing checkpoints of a small solar system.
+class CheckpointTest : public ::testing::Test {
+protected:
+    virtual void TearDown()
+    {
+        std::remove(path);
+        std::remove(other);
+    }
+
+    /**
+     *  Returns the contents of a file.
+     */
+    static std::vector<char> readFile(const char* name)
+    {
+        std::ifstream in(name, std::ios::binary);
+        return std::vector<char>(
+            std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    /**
+     *  Replaces the contents of a file.
+     */
+    static void writeFile(const char* name, const std::vector<char>& bytes)
+    {
+        std::ofstream out(name, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    /**
+     *  Reverses the bytes of the field of the given width at offset.
+     */
+    static void reverse(std::vector<char>& bytes, size_t offset, size_t width)
+    {
+        std::reverse(bytes.begin() + offset, bytes.begin() + offset + width);
+    }
+
+    /**
+     *  Expects every column of two stores to be bitwise equal.
+     */
+    static void expectEqual(const BodyStore& a, const BodyStore& b)
+    {
+        ASSERT_EQ(a.size(), b.size());
+        for (uint32_t axis = 0; axis < 2; ++axis) {
+            EXPECT_EQ(a.position[axis], b.position[axis]);
+            EXPECT_EQ(a.velocity[axis], b.velocity[axis]);
+        }
+        EXPECT_EQ(a.mass, b.mass);
+        EXPECT_EQ(a.name, b.name);
+    }
+
+    const char* path = "checkpointTest.ckp";
+    const char* other = "checkpointTest2.ckp";
+};
+
+TEST_F(CheckpointTest, RoundTripIsExact)
+{
+    BodyStore saved;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->advance(3600, 50);
+        EXPECT_EQ(univ->getStepCount(), 50u);
+        EXPECT_EQ(univ->getTime(), 50 * 3600.0);
+        univ->saveCheckpoint(path);
+        saved = univ->getBodies();
+    }
+
+    Checkpoint checkpoint(path);
+    ASSERT_EQ(checkpoint.size(), 3u);
+    EXPECT_EQ(checkpoint.getTime(), 50 * 3600.0);
+    EXPECT_EQ(checkpoint.getSteps(), 50u);
+    EXPECT_EQ(checkpoint.name(1), "earth");
+    EXPECT_EQ(
+        std::memcmp(checkpoint.position(1), saved.position[1].data(), 3 * sizeof(double)), 0);
+
+    std::unique_ptr<Universe> univ(Universe::instance());
+    univ->loadCheckpoint(path);
+    expectEqual(univ->getBodies(), saved);
+    EXPECT_EQ(univ->getTime(), 50 * 3600.0);
+    EXPECT_EQ(univ->getStepCount(), 50u);
+    EXPECT_EQ((**(++univ->begin())).getName(), "earth");
+    EXPECT_EQ((**(++univ->begin())).getPosition(), saved.getPosition(1));
+}
+
+TEST_F(CheckpointTest, RestartContinuesTheRun)
+{
+    BodyStore expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+        univ->advance(3600, 100);
+        univ->saveCheckpoint(path);
+        univ->advance(3600, 100);
+        expected = univ->getBodies();
+    }
+
+    // A restart holding other bodies adopts the checkpoint's rows.
+    std::unique_ptr<Universe> univ(Universe::instance());
+    ObjectFactory::makeObject("comet", 1.0e12, makeVector2(1.0e12, 0));
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    univ->loadCheckpoint(path);
+    univ->advance(3600, 100);
+    expectEqual(univ->getBodies(), expected);
+    EXPECT_EQ(univ->getStepCount(), 200u);
+}
+
+TEST_F(CheckpointTest, RejectsInvalidFiles)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makeSolarSystem();
+    univ->saveCheckpoint(path);
+    const std::vector<char> good = readFile(path);
+
+    EXPECT_THROW(Checkpoint checkpoint("checkpointTestMissing.ckp"), std::runtime_error);
+    EXPECT_THROW(Checkpoint3 checkpoint(path), std::runtime_error);
+
+    std::vector<char> bytes = good;
+    bytes[0] = 'X';
+    writeFile(other, bytes);
+    EXPECT_THROW(Checkpoint checkpoint(other), std::runtime_error);
+
+    bytes = good;
+    bytes.pop_back();
+    writeFile(other, bytes);
+    EXPECT_THROW(Checkpoint checkpoint(other), std::runtime_error);
+
+    writeFile(other, std::vector<char>(good.begin(), good.begin() + 40));
+    EXPECT_THROW(Checkpoint checkpoint(other), std::runtime_error);
+
+    // A count whose columns overrun the file, with nameBytes wrapping the
+    // total size back to the length of the file.
+    bytes = good;
+    const uint64_t count = 50;
+    const uint64_t column = (count * 8 + 63) / 64 * 64;
+    const uint64_t namesStart = 64 + 5 * column + ((count + 1) * 8 + 63) / 64 * 64;
+    const uint64_t nameBytes = static_cast<uint64_t>(bytes.size()) - namesStart;
+    ASSERT_GT(namesStart, bytes.size());
+    std::memcpy(bytes.data() + 24, &count, sizeof(count));
+    std::memcpy(bytes.data() + 48, &nameBytes, sizeof(nameBytes));
+    writeFile(other, bytes);
+    EXPECT_THROW(Checkpoint checkpoint(other), std::runtime_error);
+
+    // A failed load leaves the Universe as it was.
+    EXPECT_THROW(univ->loadCheckpoint(other), std::runtime_error);
+    EXPECT_EQ(univ->getBodies().size(), 3u);
+}
+
+TEST_F(CheckpointTest, ReadsTheOtherByteOrder)
+{
+    BodyStore saved;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->advance(3600, 10);
+        univ->saveCheckpoint(path);
+        saved = univ->getBodies();
+    }
+
+    // Swap every field of the documented layout, leaving the names as they are.
+    std::vector<char> bytes = readFile(path);
+    reverse(bytes, 8, 4);
+    reverse(bytes, 12, 4);
+    reverse(bytes, 16, 4);
+    for (size_t offset = 24; offset < 56; offset += 8) {
+        reverse(bytes, offset, 8);
+    }
+    const size_t columns = 5 * 64 + 64;
+    for (size_t offset = 64; offset < 64 + columns; offset += 8) {
+        reverse(bytes, offset, 8);
+    }
+    writeFile(other, bytes);
+
+    Checkpoint checkpoint(other);
+    EXPECT_EQ(checkpoint.getTime(), 10 * 3600.0);
+    EXPECT_EQ(checkpoint.getSteps(), 10u);
+    BodyStore restored;
+    checkpoint.restore(restored);
+    expectEqual(restored, saved);
+}
+
+TEST_F(CheckpointTest, ThreeDimensionsRoundTrip)
+{
+    BodyStore3 saved;
+    {
+        std::unique_ptr<Universe3> univ(Universe3::instance());
+        vector3 pos;
+        pos[2] = 1.0e11;
+        vector3 vel;
+        vel[0] = 3.0e4;
+        ObjectFactory3::makeObject("sun", 1.98892e30);
+        ObjectFactory3::makeObject("probe", 1.0e3, pos, vel);
+        univ->advance(60, 5);
+        univ->saveCheckpoint(path);
+        saved = univ->getBodies();
+    }
+    EXPECT_THROW(Checkpoint checkpoint(path), std::runtime_error);
+
+    std::unique_ptr<Universe3> univ(Universe3::instance());
+    univ->loadCheckpoint(path);
+    const BodyStore3& bodies = univ->getBodies();
+    ASSERT_EQ(bodies.size(), 2u);
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        EXPECT_EQ(bodies.position[axis], saved.position[axis]);
+        EXPECT_EQ(bodies.velocity[axis], saved.velocity[axis]);
+    }
+    EXPECT_EQ(bodies.name, saved.name);
+    EXPECT_EQ(univ->getTime(), 300.0);
+}
+
+TEST_F(CheckpointTest, BackgroundSaveHoldsTheRequestedStep)
+{
+    BodyStore expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->advance(3600, 100);
+        expected = univ->getBodies();
+        univ->saveCheckpointInBackground(path);
+        // Keep stepping while the child writes the file.
+        for (int i = 0; i < 100; ++i) {
+            univ->stepSimulation(3600);
+        }
+        univ->waitForCheckpoint();
+        EXPECT_FALSE(univ->checkpointPending());
+        EXPECT_EQ(univ->getStepCount(), 200u);
+    }
+
+    std::unique_ptr<Universe> univ(Universe::instance());
+    univ->loadCheckpoint(path);
+    expectEqual(univ->getBodies(), expected);
+    EXPECT_EQ(univ->getStepCount(), 100u);
+}
+
+TEST_F(CheckpointTest, BackgroundFailureIsReported)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makeSolarSystem();
+    univ->saveCheckpointInBackground("checkpointTestMissing/checkpoint.ckp");
+    EXPECT_THROW(univ->waitForCheckpoint(), std::runtime_error);
+    EXPECT_FALSE(univ->checkpointPending());
+
+    // A failure is reported once; the next checkpoint starts afresh.
+    univ->saveCheckpointInBackground(path);
+    univ->waitForCheckpoint();
+    EXPECT_EQ(Checkpoint(path).size(), 3u);
+}
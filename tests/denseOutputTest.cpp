@@ -0,0 +1,127 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "DenseOutput.h"
+#include "Integrator.h"
+#include "Parser.h"
+#include "Universe.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// The fixture for testing dense output on the sun-earth scenario.
+class DenseOutputTest : public ::testing::Test {
+protected:
+    /**
+     *  Loads the scenario into univ and sets a Yoshida integrator, whose
+     *  error over a few hours is far below that of the interpolation.
+     */
+    void load(Universe& univ)
+    {
+        Parser parser;
+        parser.loadFile("../tests/UCMtest.txt");
+        univ.setIntegrator(std::unique_ptr<Integrator>(new YoshidaIntegrator()));
+    }
+
+    /**
+     *  Returns the earth's position and velocity after time seconds in
+     *  steps of a minute.
+     */
+    std::pair<vector2, vector2> reference(double time)
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        load(*univ);
+        univ->advance(60, static_cast<uint64_t>(time / 60));
+        return { univ->getBodies().getPosition(1), univ->getBodies().getVelocity(1) };
+    }
+};
+
+TEST_F(DenseOutputTest, InterpolatesBetweenCoarseSteps)
+{
+    std::vector<std::pair<vector2, vector2>> expected;
+    for (double time : { 3600.0, 4500.0, 5400.0, 6300.0, 7200.0 }) {
+        expected.push_back(reference(time));
+    }
+
+    std::unique_ptr<Universe> univ(Universe::instance());
+    load(*univ);
+    univ->setDenseOutput(4);
+    univ->advance(3600, 2);
+    univ->stepSimulation(3600);
+    const DenseOutput* dense = univ->getDenseOutput();
+    ASSERT_NE(dense, nullptr);
+    EXPECT_EQ(dense->getStartTime(), 0.0);
+    EXPECT_EQ(dense->getEndTime(), 10800.0);
+    EXPECT_EQ(dense->getPosition(1, 10800.0), univ->getBodies().getPosition(1));
+    EXPECT_EQ(dense->getVelocity(1, 10800.0), univ->getBodies().getVelocity(1));
+
+    // The earth moves 107 km an hour; in between it is off by millimeters.
+    DenseOutput::Columns position;
+    DenseOutput::Columns velocity;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const double time = 3600.0 + 900.0 * i;
+        EXPECT_LT((dense->getPosition(1, time) - expected[i].first).norm(), 1.0e-2);
+        EXPECT_LT((dense->getVelocity(1, time) - expected[i].second).norm(), 1.0e-6);
+        dense->interpolate(time, position, velocity);
+        EXPECT_EQ(makeVector2(position[0][1], position[1][1]), dense->getPosition(1, time));
+        EXPECT_EQ(makeVector2(velocity[0][1], velocity[1][1]), dense->getVelocity(1, time));
+        // The sun stays put.
+        EXPECT_EQ(dense->getPosition(0, time), univ->getBodies().getPosition(0));
+        EXPECT_EQ(dense->getVelocity(0, time), vector2());
+    }
+}
+
+TEST_F(DenseOutputTest, KeepsTheLastWindowOfSteps)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    load(*univ);
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    EXPECT_EQ(univ->getDenseOutput(), nullptr);
+    univ->setDenseOutput(3);
+    univ->advance(60, 10);
+    // Every sample reuses the evaluation its step ended with.
+    EXPECT_EQ(univ->getIntegrator().getEvaluations(), 2u * 11);
+
+    const DenseOutput& dense = *univ->getDenseOutput();
+    EXPECT_EQ(dense.getWindow(), 3u);
+    EXPECT_EQ(dense.getBodyCount(), 2u);
+    EXPECT_EQ(dense.getStartTime(), 420.0);
+    EXPECT_TRUE(dense.covers(500.0));
+    EXPECT_FALSE(dense.covers(419.0));
+    EXPECT_FALSE(dense.covers(601.0));
+    EXPECT_THROW(dense.getPosition(1, 419.0), std::out_of_range);
+    EXPECT_THROW(dense.getVelocity(2, 500.0), std::out_of_range);
+
+    univ->setDenseOutput(0);
+    EXPECT_EQ(univ->getDenseOutput(), nullptr);
+    EXPECT_THROW(DenseOutput output(0), std::invalid_argument);
+}
+
+TEST_F(DenseOutputTest, StartsOverWhenTimeGoesBack)
+{
+    BodyStore bodies;
+    bodies.resize(2);
+    DenseOutput::Columns acceleration;
+    for (uint32_t axis = 0; axis < 2; ++axis) {
+        acceleration[axis].assign(2, 1.0);
+    }
+    DenseOutput dense(2);
+    EXPECT_TRUE(std::isnan(dense.getStartTime()));
+    dense.record(bodies, 0.0, acceleration);
+    bodies.position[0][1] = 1.0;
+    dense.record(bodies, 1.0, acceleration);
+    EXPECT_EQ(dense.getStartTime(), 0.0);
+    dense.record(bodies, 0.5, acceleration);
+    EXPECT_EQ(dense.getStartTime(), 0.5);
+    EXPECT_EQ(dense.getEndTime(), 0.5);
+    EXPECT_EQ(dense.getPosition(1, 0.5), makeVector2(1.0, 0.0));
+    bodies.resize(3);
+    EXPECT_THROW(dense.record(bodies, 1.0, acceleration), std::invalid_argument);
+    for (uint32_t axis = 0; axis < 2; ++axis) {
+        acceleration[axis].assign(3, 1.0);
+    }
+    dense.record(bodies, 1.0, acceleration);
+    EXPECT_EQ(dense.getStartTime(), 1.0);
+    EXPECT_EQ(dense.getBodyCount(), 3u);
+}
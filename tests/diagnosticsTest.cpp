@@ -0,0 +1,219 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "BarnesHutEngine.h"
+#include "BlockIntegrator.h"
+#include "Diagnostics.h"
+#include "FmmEngine.h"
+#include "ForceEngine.h"
+#include "Integrator.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "SimdEngine.h"
+#include "Universe.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+
+// The fixture for testing the conserved quantities and the potentials the
+// force engines compute for them.
+class DiagnosticsTest : public ::testing::Test {
+protected:
+    /**
+     *  Fills a store with count bodies scattered over a square.
+     */
+    static BodyStore scatter(size_t count)
+    {
+        std::mt19937_64 generator(3251);
+        std::uniform_real_distribution<> position(-1.0e12, 1.0e12);
+        std::uniform_real_distribution<> mass(1.0e22, 1.0e26);
+        BodyStore bodies;
+        for (size_t i = 0; i < count; ++i) {
+            bodies.add("body", mass(generator),
+                makeVector2(position(generator), position(generator)), vector2());
+        }
+        return bodies;
+    }
+
+    /**
+     *  Returns the potential of every body of bodies summed over every pair.
+     */
+    static BodyStore::Column exactPotentials(const BodyStore& bodies)
+    {
+        BodyStore::Column potential(bodies.size(), 0.0);
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            for (size_t j = 0; j < bodies.size(); ++j) {
+                if (i != j) {
+                    const double r = (bodies.getPosition(j) - bodies.getPosition(i)).norm();
+                    potential[i] -= Universe::G * bodies.mass[j] / r;
+                }
+            }
+        }
+        return potential;
+    }
+
+    /**
+     *  Returns the RMS error of approx relative to the RMS of exact.
+     */
+    static double relativeError(const BodyStore::Column& approx, const BodyStore::Column& exact)
+    {
+        double error = 0.0;
+        double norm = 0.0;
+        for (size_t i = 0; i < exact.size(); ++i) {
+            error += (approx[i] - exact[i]) * (approx[i] - exact[i]);
+            norm += exact[i] * exact[i];
+        }
+        return std::sqrt(error / norm);
+    }
+};
+
+TEST_F(DiagnosticsTest, EnginesComputePotentials)
+{
+    const BodyStore bodies = scatter(300);
+    const BodyStore::Column exact = exactPotentials(bodies);
+    ThreadPool pool(3);
+    ForceEngine::Accelerations acc;
+    ForceEngine::Potentials potential;
+
+    DirectEngine direct;
+    SymmetricEngine symmetric;
+    BarnesHutEngine barnesHut(0.3);
+    for (ForceEngine* engine : { static_cast<ForceEngine*>(&direct),
+             static_cast<ForceEngine*>(&symmetric), static_cast<ForceEngine*>(&barnesHut) }) {
+        EXPECT_TRUE(engine->computesPotentials());
+        engine->setPotentials(&potential);
+        engine->computeAccelerations(bodies, acc, pool);
+        ASSERT_EQ(potential.size(), bodies.size());
+        EXPECT_LT(relativeError(potential, exact), engine == &barnesHut ? 1e-2 : 1e-12);
+        engine->setPotentials(nullptr);
+        potential.clear();
+        engine->computeAccelerations(bodies, acc, pool);
+        EXPECT_TRUE(potential.empty());
+    }
+}
+
+TEST_F(DiagnosticsTest, SimdKernelsComputePotentials)
+{
+    const BodyStore bodies = scatter(300);
+    const BodyStore::Column exact = exactPotentials(bodies);
+    ThreadPool pool(3);
+    ForceEngine::Accelerations acc;
+    ForceEngine::Accelerations without;
+    ForceEngine::Potentials potential;
+
+    for (SimdEngine::Precision precision :
+        { SimdEngine::Precision::Double, SimdEngine::Precision::Mixed }) {
+        SimdEngine simd(precision);
+        EXPECT_TRUE(simd.computesPotentials());
+        for (SimdEngine::Level level : { SimdEngine::Level::Scalar, SimdEngine::Level::Sse2,
+                 SimdEngine::Level::Avx2, SimdEngine::Level::Avx512 }) {
+            if (!SimdEngine::isSupported(level))
+                continue;
+            simd.setLevel(level);
+            simd.setPotentials(&potential);
+            simd.computeAccelerations(bodies, acc, pool);
+            ASSERT_EQ(potential.size(), bodies.size());
+            EXPECT_LT(relativeError(potential, exact),
+                precision == SimdEngine::Precision::Double ? 1e-12 : 3e-5)
+                << SimdEngine::name(level);
+            // The accelerations do not depend on whether potentials are summed.
+            simd.setPotentials(nullptr);
+            potential.clear();
+            simd.computeAccelerations(bodies, without, pool);
+            EXPECT_TRUE(potential.empty());
+            EXPECT_EQ(without, acc) << SimdEngine::name(level);
+        }
+    }
+}
+
+TEST_F(DiagnosticsTest, SumsTheQuantitiesOfTheBodies)
+{
+    BodyStore bodies;
+    bodies.add("sun", 4.0, makeVector2(1, 1), makeVector2(0, 0));
+    bodies.add("a", 2.0, makeVector2(3, 1), makeVector2(0, 1));
+    bodies.add("b", 2.0, makeVector2(1, 4), makeVector2(-2, 0));
+    BodyStore::Column potential = { -3.0, -2.0, -1.0 };
+
+    Diagnostics diagnostics;
+    diagnostics.update(bodies, potential, 10.0, 2);
+    const Diagnostics::Quantities& now = diagnostics.getCurrent();
+    EXPECT_EQ(diagnostics.getUpdates(), 1u);
+    EXPECT_EQ(now.step, 2u);
+    EXPECT_EQ(now.mass, 8.0);
+    EXPECT_EQ(now.kinetic, 5.0);
+    EXPECT_EQ(now.potential, -9.0);
+    EXPECT_EQ(now.energy, -4.0);
+    assertVector(now.momentum, makeVector2(-4, 2));
+    assertVector(now.centerOfMass, makeVector2(1.5, 1.75));
+    // About the sun: 2 * (2, 0) x (0, 1) + 2 * (0, 3) x (-2, 0).
+    EXPECT_EQ(now.angularMomentum[0], 0.0);
+    EXPECT_EQ(now.angularMomentum[1], 0.0);
+    EXPECT_EQ(now.angularMomentum[2], 16.0);
+    EXPECT_EQ(diagnostics.getEnergyDrift(), 0.0);
+
+    potential.clear();
+    diagnostics.update(bodies, potential, 20.0, 3);
+    EXPECT_TRUE(std::isnan(diagnostics.getCurrent().energy));
+    EXPECT_TRUE(std::isnan(diagnostics.getEnergyDrift()));
+    EXPECT_TRUE(std::isnan(diagnostics.getMaxEnergyDrift()));
+    EXPECT_EQ(diagnostics.getAngularMomentumDrift(), 0.0);
+
+    potential.resize(2);
+    EXPECT_THROW(diagnostics.update(bodies, potential, 30.0, 4), std::invalid_argument);
+    diagnostics.clear();
+    EXPECT_EQ(diagnostics.getUpdates(), 0u);
+}
+
+TEST_F(DiagnosticsTest, UniverseConservesEnergyAndAngularMomentum)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makePlanetarySystem(49);
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    EXPECT_EQ(univ->getDiagnostics(), nullptr);
+    univ->setDiagnostics(true);
+    const Diagnostics& diagnostics = *univ->getDiagnostics();
+    EXPECT_EQ(diagnostics.getUpdates(), 1u);
+    EXPECT_EQ(diagnostics.getInitial().step, 0u);
+    EXPECT_LT(diagnostics.getInitial().energy, 0.0);
+
+    univ->advance(3600, 200, 50);
+    univ->stepSimulation(3600);
+    EXPECT_EQ(diagnostics.getUpdates(), 202u);
+    EXPECT_EQ(diagnostics.getCurrent().step, 201u);
+    EXPECT_LT(std::abs(diagnostics.getMaxEnergyDrift()), 1e-6);
+    EXPECT_LT(diagnostics.getAngularMomentumDrift(), 1e-12);
+
+    // The potential energy of the step matches one summed afresh.
+    const BodyStore::Column exact = exactPotentials(univ->getBodies());
+    double potential = 0.0;
+    for (size_t i = 0; i < exact.size(); ++i) {
+        potential += 0.5 * univ->getBodies().mass[i] * exact[i];
+    }
+    EXPECT_NEAR(diagnostics.getCurrent().potential, potential, 1e-12 * std::abs(potential));
+
+    // Engines without potentials leave the energy unknown until replaced.
+    univ->setForceEngine(std::unique_ptr<ForceEngine>(new FmmEngine()));
+    univ->stepSimulation(3600);
+    EXPECT_TRUE(std::isnan(diagnostics.getCurrent().energy));
+    univ->setForceEngine(std::unique_ptr<ForceEngine>(new BarnesHutEngine(0.0)));
+    univ->stepSimulation(3600);
+    EXPECT_LT(std::abs(diagnostics.getEnergyDrift()), 1e-6);
+    EXPECT_TRUE(std::isnan(diagnostics.getMaxEnergyDrift()));
+
+    univ->setDiagnostics(false);
+    EXPECT_EQ(univ->getDiagnostics(), nullptr);
+}
+
+TEST_F(DiagnosticsTest, BlockStepsLeaveThePotentialUnknown)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makePlanetarySystem(49);
+    univ->setIntegrator(std::unique_ptr<Integrator>(new BlockIntegrator()));
+    univ->setDiagnostics(true);
+    EXPECT_FALSE(std::isnan(univ->getDiagnostics()->getInitial().energy));
+    univ->stepSimulation(3600);
+    const Diagnostics::Quantities& now = univ->getDiagnostics()->getCurrent();
+    EXPECT_TRUE(std::isnan(now.potential));
+    EXPECT_GT(now.kinetic, 0.0);
+    EXPECT_LT(univ->getDiagnostics()->getAngularMomentumDrift(), 1e-6);
+}
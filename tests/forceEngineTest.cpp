@@ -0,0 +1,358 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "BarnesHutEngine.h"
+#include "FmmEngine.h"
+#include "ForceEngine.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "PmEngine.h"
+#include "SimdEngine.h"
+#include "Universe.h"
+#include <array>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+/**
+ *  Fills a store with count bodies scattered uniformly over a square of the
+ *  given size. A fixed seed keeps the runs reproducible.
+ */
+BodyStore makeCluster(size_t count, double size = 1.0e12, unsigned seed = 3251)
+{
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<> position(-size, size);
+    std::uniform_real_distribution<> mass(1.0e22, 1.0e26);
+    BodyStore bodies;
+    for (size_t i = 0; i < count; ++i) {
+        bodies.add("body", mass(generator), makeVector2(position(generator), position(generator)),
+            vector2());
+    }
+    return bodies;
+}
+
+/**
+ *  Fills a 3D store with count bodies scattered uniformly over a cube.
+ */
+BodyStore3 makeCluster3(size_t count, double size = 1.0e12, unsigned seed = 3251)
+{
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<> position(-size, size);
+    std::uniform_real_distribution<> mass(1.0e22, 1.0e26);
+    BodyStore3 bodies;
+    for (size_t i = 0; i < count; ++i) {
+        vector3 pos;
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            pos[axis] = position(generator);
+        }
+        bodies.add("body", mass(generator), pos, vector3());
+    }
+    return bodies;
+}
+
+/**
+ *  Returns the RMS error of approx normalized by the RMS magnitude of exact.
+ *  Normalizing globally keeps bodies whose net force nearly cancels from
+ *  dominating the measure.
+ */
+template <size_t D>
+double relativeError(const std::array<BodyStore::Column, D>& approx,
+    const std::array<BodyStore::Column, D>& exact)
+{
+    double error = 0.0;
+    double norm = 0.0;
+    for (size_t i = 0; i < exact[0].size(); ++i) {
+        for (size_t axis = 0; axis < D; ++axis) {
+            double d = approx[axis][i] - exact[axis][i];
+            error += d * d;
+            norm += exact[axis][i] * exact[axis][i];
+        }
+    }
+    return std::sqrt(error / norm);
+}
+
+// The fixture for testing the force engines against direct summation.
+class ForceEngineTest : public ::testing::Test {
+protected:
+    ThreadPool serial;
+};
+
+TEST_F(ForceEngineTest, BarnesHutMatchesDirect)
+{
+    BodyStore bodies = makeCluster(2000);
+    ForceEngine::Accelerations exact;
+    DirectEngine().computeAccelerations(bodies, exact, serial);
+
+    // Opening angle of zero never approximates, so only summation order differs.
+    ForceEngine::Accelerations approx;
+    BarnesHutEngine engine(0.0);
+    engine.computeAccelerations(bodies, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 1e-12);
+
+    // The usual opening angles stay within a percent on a uniform cluster.
+    engine.setTheta(0.5);
+    engine.computeAccelerations(bodies, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 1e-2);
+
+    engine.setTheta(0.3);
+    engine.computeAccelerations(bodies, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 2e-3);
+}
+
+TEST_F(ForceEngineTest, FmmMatchesDirect)
+{
+    BodyStore bodies = makeCluster(5000);
+    ForceEngine::Accelerations exact;
+    DirectEngine().computeAccelerations(bodies, exact, serial);
+
+    // The error falls geometrically with the expansion order.
+    ForceEngine::Accelerations approx;
+    FmmEngine engine(2, 16);
+    engine.computeAccelerations(bodies, approx, serial);
+    double low = relativeError(approx, exact);
+    EXPECT_LT(low, 1e-2);
+
+    engine.setOrder(6);
+    engine.computeAccelerations(bodies, approx, serial);
+    double high = relativeError(approx, exact);
+    EXPECT_LT(high, 1e-4);
+    EXPECT_LT(high, low);
+
+    // Too few bodies for a far field: every leaf is a neighbour, so it is exact.
+    BodyStore few = makeCluster(20);
+    DirectEngine().computeAccelerations(few, exact, serial);
+    engine.computeAccelerations(few, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 1e-12);
+}
+
+TEST_F(ForceEngineTest, ThreadedDirectMatchesSerial)
+{
+    BodyStore bodies = makeCluster(3001);
+    ForceEngine::Accelerations expected;
+    DirectEngine().computeAccelerations(bodies, expected, serial);
+
+    // Every row is summed by exactly one worker in the same order, so the
+    // threaded result is bit-identical.
+    ThreadPool pool(4);
+    ForceEngine::Accelerations threaded;
+    DirectEngine engine;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        engine.computeAccelerations(bodies, threaded, pool);
+        EXPECT_EQ(threaded[0], expected[0]);
+        EXPECT_EQ(threaded[1], expected[1]);
+    }
+}
+
+TEST_F(ForceEngineTest, SymmetricMatchesDirect)
+{
+    BodyStore bodies = makeCluster(2500);
+    ForceEngine::Accelerations exact;
+    DirectEngine().computeAccelerations(bodies, exact, serial);
+
+    // Only the order of summation differs from direct summation.
+    SymmetricEngine engine;
+    ForceEngine::Accelerations approx;
+    engine.computeAccelerations(bodies, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 1e-13);
+
+    ThreadPool pool(3);
+    ForceEngine::Accelerations threaded;
+    engine.computeAccelerations(bodies, threaded, pool);
+    EXPECT_LT(relativeError(threaded, exact), 1e-13);
+
+    // Rerunning must not pick up stale partial sums.
+    engine.computeAccelerations(bodies, threaded, pool);
+    EXPECT_LT(relativeError(threaded, exact), 1e-13);
+}
+
+TEST_F(ForceEngineTest, SimdMatchesScalar)
+{
+    // An odd count exercises the massless padding of the last group.
+    BodyStore bodies = makeCluster(1237);
+    ForceEngine::Accelerations exact;
+    DirectEngine().computeAccelerations(bodies, exact, serial);
+
+    SimdEngine engine;
+    EXPECT_TRUE(SimdEngine::isSupported(engine.getLevel()));
+    ThreadPool pool(2);
+    for (SimdEngine::Level level : { SimdEngine::Level::Scalar, SimdEngine::Level::Sse2,
+             SimdEngine::Level::Avx2, SimdEngine::Level::Avx512 }) {
+        if (!SimdEngine::isSupported(level))
+            continue;
+        EXPECT_EQ(engine.setLevel(level), level);
+        ForceEngine::Accelerations approx;
+        engine.computeAccelerations(bodies, approx, serial);
+        EXPECT_LT(relativeError(approx, exact), 1e-12) << SimdEngine::name(level);
+        engine.computeAccelerations(bodies, approx, pool);
+        EXPECT_LT(relativeError(approx, exact), 1e-12) << SimdEngine::name(level);
+    }
+}
+
+TEST_F(ForceEngineTest, MixedPrecisionMatchesDirect)
+{
+    // A small cluster far from the origin only keeps its shape in float
+    // because every offset is taken from a nearby centroid.
+    BodyStore bodies = makeCluster(1237, 1.0e10);
+    BodyStore shifted = bodies;
+    for (double& x : shifted.position[0]) {
+        x += 4.0e13;
+    }
+    BodyStore3 space = makeCluster3(1001);
+    ThreadPool pool(3);
+
+    SimdEngine engine(SimdEngine::Precision::Mixed);
+    SimdEngine3 engine3(SimdEngine3::Precision::Mixed);
+    for (SimdEngine::Level level : { SimdEngine::Level::Scalar, SimdEngine::Level::Sse2,
+             SimdEngine::Level::Avx2, SimdEngine::Level::Avx512 }) {
+        if (!SimdEngine::isSupported(level))
+            continue;
+        engine.setLevel(level);
+        for (const BodyStore* store : { &bodies, &shifted }) {
+            ForceEngine::Accelerations exact;
+            DirectEngine().computeAccelerations(*store, exact, serial);
+            ForceEngine::Accelerations approx;
+            engine.computeAccelerations(*store, approx, serial);
+            EXPECT_LT(relativeError(approx, exact), 3e-5) << SimdEngine::name(level);
+            // Each target is summed by one worker in the same order.
+            ForceEngine::Accelerations threaded;
+            engine.computeAccelerations(*store, threaded, pool);
+            EXPECT_EQ(threaded, approx) << SimdEngine::name(level);
+        }
+
+        engine3.setLevel(static_cast<SimdEngine3::Level>(level));
+        ForceEngine3::Accelerations exact;
+        DirectEngine3().computeAccelerations(space, exact, serial);
+        ForceEngine3::Accelerations approx;
+        engine3.computeAccelerations(space, approx, pool);
+        EXPECT_LT(relativeError(approx, exact), 3e-5) << SimdEngine::name(level);
+    }
+}
+
+TEST_F(ForceEngineTest, EnginesAgreeInThreeDimensions)
+{
+    BodyStore3 bodies = makeCluster3(1501);
+    ForceEngine3::Accelerations exact;
+    DirectEngine3().computeAccelerations(bodies, exact, serial);
+    ThreadPool pool(3);
+
+    ForceEngine3::Accelerations approx;
+    SymmetricEngine3 symmetric;
+    symmetric.computeAccelerations(bodies, approx, pool);
+    EXPECT_LT(relativeError(approx, exact), 1e-13);
+
+    SimdEngine3 simd;
+    for (SimdEngine3::Level level : { SimdEngine3::Level::Scalar, SimdEngine3::Level::Sse2,
+             SimdEngine3::Level::Avx2, SimdEngine3::Level::Avx512 }) {
+        if (!SimdEngine3::isSupported(level))
+            continue;
+        simd.setLevel(level);
+        simd.computeAccelerations(bodies, approx, pool);
+        EXPECT_LT(relativeError(approx, exact), 1e-12) << SimdEngine3::name(level);
+    }
+
+    // The octree is exact without opening and within a percent at the usual angle.
+    BarnesHutEngine3 tree(0.0);
+    tree.computeAccelerations(bodies, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 1e-12);
+    tree.setTheta(0.5);
+    tree.computeAccelerations(bodies, approx, serial);
+    EXPECT_LT(relativeError(approx, exact), 1e-2);
+}
+
+TEST_F(ForceEngineTest, PmMatchesDirectInTheFarField)
+{
+    // Light tracers around a dense disk feel its smooth field, which the
+    // mesh resolves; close encounters within the disk are smoothed away.
+    BodyStore bodies = makeCluster(2000, 1.0e11);
+    std::mt19937_64 generator(7);
+    std::uniform_real_distribution<> radius(5.0e11, 1.0e12);
+    std::uniform_real_distribution<> angle(0.0, 6.283185307179586);
+    for (size_t i = 0; i < 500; ++i) {
+        double r = radius(generator);
+        double a = angle(generator);
+        bodies.add("tracer", 1.0, makeVector2(r * std::cos(a), r * std::sin(a)), vector2());
+    }
+    ForceEngine::Accelerations exact;
+    DirectEngine().computeAccelerations(bodies, exact, serial);
+
+    ForceEngine::Accelerations tracers;
+    for (uint32_t axis = 0; axis < BodyStore::DIM; ++axis) {
+        tracers[axis].assign(exact[axis].begin() + 2000, exact[axis].end());
+    }
+
+    ThreadPool pool(2);
+    for (PmEngine::Assignment assignment :
+        { PmEngine::Assignment::Ngp, PmEngine::Assignment::Cic, PmEngine::Assignment::Tsc }) {
+        double previous = 1.0;
+        for (uint32_t grid : { 64u, 128u, 256u }) {
+            PmEngine engine(grid, assignment);
+            ForceEngine::Accelerations approx;
+            engine.computeAccelerations(bodies, approx, serial);
+            ForceEngine::Accelerations threaded;
+            engine.computeAccelerations(bodies, threaded, pool);
+            EXPECT_EQ(threaded, approx);
+
+            // Assignment and interpolation share a stencil, so momentum is conserved.
+            double momentumX = 0.0;
+            double momentumY = 0.0;
+            double scale = 0.0;
+            for (size_t i = 0; i < bodies.size(); ++i) {
+                momentumX += bodies.mass[i] * approx[0][i];
+                momentumY += bodies.mass[i] * approx[1][i];
+                scale += bodies.mass[i] * std::hypot(approx[0][i], approx[1][i]);
+            }
+            EXPECT_LT(std::hypot(momentumX, momentumY), 1e-12 * scale);
+
+            for (uint32_t axis = 0; axis < BodyStore::DIM; ++axis) {
+                approx[axis].erase(approx[axis].begin(), approx[axis].begin() + 2000);
+            }
+            double error = relativeError(approx, tracers);
+            EXPECT_LT(error, assignment == PmEngine::Assignment::Ngp ? 0.05 : 0.003);
+            EXPECT_LT(error, 0.6 * previous);
+            previous = error;
+        }
+    }
+}
+
+TEST_F(ForceEngineTest, ThreadedStepMatchesSerial)
+{
+    BodyStore start = makeCluster(600);
+    std::vector<vector2> expected;
+    for (uint32_t threads : { 1u, 3u }) {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        univ->setThreadCount(threads);
+        EXPECT_EQ(univ->getThreadCount(), threads);
+        for (size_t i = 0; i < start.size(); ++i) {
+            ObjectFactory::makeObject("body", start.mass[i], start.getPosition(i));
+        }
+        for (int step = 0; step < 5; ++step) {
+            univ->stepSimulation(3600);
+        }
+        size_t row = 0;
+        for (Universe::iterator i = univ->begin(); i != univ->end(); ++i, ++row) {
+            if (threads == 1)
+                expected.push_back((*i)->getPosition());
+            else
+                EXPECT_EQ((*i)->getPosition(), expected[row]);
+        }
+    }
+}
+
+TEST_F(ForceEngineTest, BarnesHutKeepsSunFixed)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    univ->setForceEngine(std::unique_ptr<ForceEngine>(new BarnesHutEngine(0.5)));
+    ObjectFactory::makeObject("sun", 1.98892e30);
+    ObjectFactory::makeObject(
+        "earth", 5.9742e24, makeVector2(149597870700.0, 0), makeVector2(0, 29788.4676));
+    ObjectFactory::makeObject(
+        "mars", 6.4171e23, makeVector2(0, 227939200000.0), makeVector2(-24077, 0));
+
+    for (int step = 0; step < 100; ++step) {
+        univ->stepSimulation(60);
+    }
+    assertVector((**univ->begin()).getPosition(), vector2());
+    assertVector((**univ->begin()).getVelocity(), vector2());
+    EXPECT_GT((**(++univ->begin())).getPosition()[1], 0.0);
+}
@@ -0,0 +1,212 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "BarnesHutEngine.h"
+#include "BlockIntegrator.h"
+#include "ForceEngine.h"
+#include "Integrator.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "Parser.h"
+#include "SimdEngine.h"
+#include "Universe.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+/**
+ *  Direct summation that counts its evaluations.
+ */
+class CountingEngine : public DirectEngine {
+public:
+    virtual void computeAccelerations(
+        const BodyStore& bodies, Accelerations& acc, ThreadPool& pool)
+    {
+        ++count;
+        DirectEngine::computeAccelerations(bodies, acc, pool);
+    }
+
+    int count = 0;
+};
+
+// The fixture for testing the integrators on the sun-earth scenario.
+class IntegratorTest : public ::testing::Test {
+protected:
+    /**
+     *  Runs the scenario for 30 days in steps of dt and returns the earth's
+     *  final position.
+     */
+    vector2 orbit(std::unique_ptr<Integrator> integrator, double dt)
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        Parser parser;
+        parser.loadFile("../tests/UCMtest.txt");
+        EXPECT_EQ(univ->getBodies().size(), 2u);
+        if (univ->getBodies().size() != 2)
+            return vector2();
+        univ->setIntegrator(std::move(integrator));
+        univ->advance(dt, static_cast<uint64_t>(30 * 86400 / dt));
+        assertVector((**univ->begin()).getPosition(), vector2());
+        return (**(++univ->begin())).getPosition();
+    }
+};
+
+TEST_F(IntegratorTest, ParserLoadsScenario)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    Parser parser;
+    parser.loadFile("../tests/UCMtest.txt");
+    ASSERT_EQ(univ->getBodies().size(), 2u);
+    const Object& sun = **univ->begin();
+    const Object& earth = **(++univ->begin());
+    EXPECT_EQ(sun.getName(), "sun");
+    EXPECT_EQ(sun.getMass(), 1.98892e30);
+    EXPECT_EQ(earth.getName(), "earth");
+    EXPECT_EQ(earth.getMass(), 5.9742e24);
+    EXPECT_EQ(earth.getPosition(), makeVector2(149597870700, 0));
+    EXPECT_EQ(earth.getVelocity(), makeVector2(0, 29788.4676));
+}
+
+TEST_F(IntegratorTest, HigherOrderSchemesConverge)
+{
+    vector2 reference = orbit(std::unique_ptr<Integrator>(new YoshidaIntegrator()), 60);
+    double euler
+        = (orbit(std::unique_ptr<Integrator>(new EulerIntegrator()), 3600) - reference).norm();
+    double leapfrog
+        = (orbit(std::unique_ptr<Integrator>(new LeapfrogIntegrator()), 3600) - reference).norm();
+    double verlet
+        = (orbit(std::unique_ptr<Integrator>(new VerletIntegrator()), 3600) - reference).norm();
+    double yoshida
+        = (orbit(std::unique_ptr<Integrator>(new YoshidaIntegrator()), 3600) - reference).norm();
+
+    EXPECT_LT(leapfrog, 1.0e4);
+    EXPECT_NEAR(verlet, leapfrog, 1.0);
+    EXPECT_LT(yoshida, 1.0);
+    EXPECT_GT(euler, 1.0e3 * leapfrog);
+}
+
+TEST_F(IntegratorTest, KicksReuseTheLastEvaluation)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    Parser parser;
+    parser.loadFile("../tests/UCMtest.txt");
+    ASSERT_EQ(univ->getBodies().size(), 2u);
+    CountingEngine* engine = new CountingEngine();
+    univ->setForceEngine(std::unique_ptr<ForceEngine>(engine));
+
+    univ->advance(60, 10);
+    EXPECT_EQ(engine->count, 10);
+
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    univ->advance(60, 10);
+    EXPECT_EQ(engine->count, 21);
+    univ->stepSimulation(60);
+    EXPECT_EQ(engine->count, 22);
+
+    // Moving a body invalidates the accelerations of the last evaluation.
+    Object& earth = **(++univ->begin());
+    earth.setPosition(earth.getPosition() * 1.01);
+    univ->stepSimulation(60);
+    EXPECT_EQ(engine->count, 24);
+
+    univ->setIntegrator(std::unique_ptr<Integrator>(new YoshidaIntegrator()));
+    univ->advance(60, 10);
+    EXPECT_EQ(engine->count, 55);
+}
+
+TEST_F(IntegratorTest, ChangingTheEngineInvalidatesTheLastEvaluation)
+{
+    BodyStore bodies;
+    for (int i = 0; i < 64; ++i) {
+        const double radius = 1.0e11 * (1.0 + 0.05 * (i % 7));
+        bodies.add("body", 1.0e24 * (1 + i % 5),
+            makeVector2(radius * std::cos(0.1 * i), radius * std::sin(0.1 * i)), vector2());
+    }
+    ThreadPool pool(1);
+    LeapfrogIntegrator integrator;
+    BarnesHutEngine engine(0.0);
+    const ForceEngine::Accelerations exact = integrator.getAccelerations(bodies, engine, pool);
+    EXPECT_EQ(integrator.getAccelerations(bodies, engine, pool), exact);
+    EXPECT_EQ(integrator.getEvaluations(), 64u);
+
+    // A wider opening angle approximates the same state differently.
+    engine.setTheta(1.0);
+    const ForceEngine::Accelerations approx = integrator.getAccelerations(bodies, engine, pool);
+    EXPECT_EQ(integrator.getEvaluations(), 128u);
+    EXPECT_NE(approx, exact);
+
+    engine.setTheta(0.0);
+    EXPECT_EQ(integrator.getAccelerations(bodies, engine, pool), exact);
+    EXPECT_EQ(integrator.getEvaluations(), 192u);
+
+    // So does writing a column directly, once the store is told.
+    bodies.position[0][1] *= 1.01;
+    bodies.touch();
+    EXPECT_NE(integrator.getAccelerations(bodies, engine, pool), exact);
+    EXPECT_EQ(integrator.getEvaluations(), 256u);
+}
+
+TEST_F(IntegratorTest, BlockStepsFollowTheOrbit)
+{
+    vector2 reference = orbit(std::unique_ptr<Integrator>(new YoshidaIntegrator()), 60);
+    double block
+        = (orbit(std::unique_ptr<Integrator>(new BlockIntegrator()), 86400) - reference).norm();
+    EXPECT_LT(block, 10.0);
+}
+
+TEST_F(IntegratorTest, BlockStepsOnlyShrinkForTheClosePair)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    ObjectFactory::makeObject("sun", 1.98892e30);
+    for (int i = 0; i < 30; ++i) {
+        double radius = 1.496e11 * (1.0 + 0.1 * i);
+        double angle = 0.7 * i;
+        double speed = std::sqrt(Universe::G * 1.98892e30 / radius);
+        ObjectFactory::makeObject("planet", 1.0e24,
+            makeVector2(radius * std::cos(angle), radius * std::sin(angle)),
+            makeVector2(-speed * std::sin(angle), speed * std::cos(angle)));
+    }
+    // A binary 1e7 m wide, circling the sun beyond the planets.
+    const double radius = 6.0e11;
+    const double separation = 1.0e7;
+    const double orbital = std::sqrt(Universe::G * 1.98892e30 / radius);
+    const double internal = 0.5 * std::sqrt(Universe::G * 2.0e24 / separation);
+    ObjectFactory::makeObject("a", 1.0e24, makeVector2(radius + 0.5 * separation, 0),
+        makeVector2(0, orbital + internal));
+    ObjectFactory::makeObject("b", 1.0e24, makeVector2(radius - 0.5 * separation, 0),
+        makeVector2(0, orbital - internal));
+
+    BlockIntegrator* block = new BlockIntegrator();
+    univ->setIntegrator(std::unique_ptr<Integrator>(block));
+    univ->advance(86400, 10);
+
+    const vector2 a = (**(univ->end() - 2)).getPosition();
+    const vector2 b = (**(univ->end() - 1)).getPosition();
+    EXPECT_NEAR((a - b).norm(), separation, 1.0e-4 * separation);
+    assertVector((**univ->begin()).getPosition(), vector2());
+    // A shared step would evaluate all 32 moving bodies at every block time.
+    EXPECT_LT(block->getEvaluations() * 10, block->getBlockSteps() * 32);
+}
+
+TEST_F(IntegratorTest, MixedPrecisionKeepsTheYearlongOrbit)
+{
+    // The scenario of UMCTest, sampled as often, against its tolerance.
+    std::vector<vector2> expected;
+    for (int mixed = 0; mixed < 2; ++mixed) {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        Parser parser;
+        parser.loadFile("../tests/UCMtest.txt");
+        ASSERT_EQ(univ->getBodies().size(), 2u);
+        if (mixed)
+            univ->setForceEngine(
+                std::unique_ptr<ForceEngine>(new SimdEngine(SimdEngine::Precision::Mixed)));
+        size_t sample = 0;
+        univ->advance(60, 365 * 1440, 1440, [&](uint64_t) {
+            vector2 pos = (**(++univ->begin())).getPosition();
+            if (!mixed)
+                expected.push_back(pos);
+            else
+                assertVector(pos, expected[sample++], 1000000.0);
+        });
+    }
+}
@@ -0,0 +1,115 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "Integrator.h"
+#include "Parser.h"
+#include "PerfCounters.h"
+#include "SimdEngine.h"
+#include "Universe.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+
+// Counters are often unavailable in containers and virtual machines, so
+// these tests check the bookkeeping everywhere and the counts where they
+// exist.
+class PerfCountersTest : public ::testing::Test {
+protected:
+    /**
+     *  Loads the sun-earth scenario, moved by leapfrog.
+     */
+    static void load(Universe& univ)
+    {
+        Parser parser;
+        parser.loadFile("../tests/UCMtest.txt");
+        univ.setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    }
+};
+
+TEST_F(PerfCountersTest, CountsThePhasesOfEveryStep)
+{
+    vector2 expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        load(*univ);
+        univ->advance(60, 10);
+        expected = univ->getBodies().getPosition(1);
+    }
+
+    std::unique_ptr<Universe> univ(Universe::instance());
+    load(*univ);
+    EXPECT_EQ(univ->getPerfStats(), nullptr);
+    univ->setPerfCounters(true);
+    univ->advance(60, 5);
+    // Replacing the engine mid-run neither loses the counts nor reuses a stale evaluation.
+    univ->setForceEngine(std::unique_ptr<ForceEngine>(new SimdEngine()));
+    univ->advance(60, 5);
+    EXPECT_LT((univ->getBodies().getPosition(1) - expected).norm(), 1e-3);
+
+    const PerfStats& stats = *univ->getPerfStats();
+    EXPECT_EQ(stats.getSteps(), 10u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Step).calls, 1u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Step, true).calls, 10u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Output, true).calls, 10u);
+    // Leapfrog reuses the evaluation its last step ended with, but the new
+    // engine evaluates once more. Each evaluation visits both ordered pairs.
+    EXPECT_EQ(stats.getCounts(PerfStats::Force).calls, 1u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Force, true).calls, 12u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Force, true).interactions, 24u);
+
+    PerfCounters counters;
+    EXPECT_EQ(counters.getError().empty(), counters.isAvailable(PerfCounters::Cycles)
+            && counters.isAvailable(PerfCounters::Instructions)
+            && counters.isAvailable(PerfCounters::L1dMisses)
+            && counters.isAvailable(PerfCounters::LlcMisses)
+            && counters.isAvailable(PerfCounters::BranchMisses)
+            && counters.isAvailable(PerfCounters::TaskClock));
+    EXPECT_EQ(stats.getError(), counters.getError());
+    if (stats.isAvailable(PerfCounters::TaskClock)) {
+        const PerfStats::Values& step = stats.getCounts(PerfStats::Step, true).values;
+        const PerfStats::Values& force = stats.getCounts(PerfStats::Force, true).values;
+        EXPECT_GT(step[PerfCounters::TaskClock], 0u);
+        EXPECT_GE(step[PerfCounters::TaskClock], force[PerfCounters::TaskClock]);
+        EXPECT_GT(stats.getPerInteraction(PerfCounters::TaskClock, PerfStats::Step, true), 0.0);
+    }
+    if (stats.isAvailable(PerfCounters::Cycles) && stats.isAvailable(PerfCounters::Instructions)) {
+        EXPECT_GT(stats.getIpc(PerfStats::Force, true), 0.0);
+    } else {
+        EXPECT_TRUE(std::isnan(stats.getIpc(PerfStats::Force, true)));
+    }
+
+    univ->setPerfCounters(false);
+    EXPECT_EQ(univ->getPerfStats(), nullptr);
+}
+
+TEST_F(PerfCountersTest, ReportsRatiosOfAvailableCounters)
+{
+    PerfCounters counters;
+    PerfStats stats(counters);
+    PerfStats::Values delta {};
+    delta.fill(6);
+    delta[PerfCounters::Cycles] = 4;
+    stats.beginStep();
+    stats.add(PerfStats::Force, delta, 3);
+    stats.add(PerfStats::Force, delta, 3);
+    stats.beginStep();
+    stats.add(PerfStats::Force, delta, 0);
+
+    EXPECT_EQ(stats.getSteps(), 2u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Force).calls, 1u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Force, true).values[PerfCounters::TaskClock], 18u);
+    // The last step evaluated no pairs.
+    EXPECT_TRUE(std::isnan(stats.getPerInteraction(PerfCounters::TaskClock)));
+    EXPECT_TRUE(std::isnan(stats.getIpc(PerfStats::Step)));
+    if (counters.isAvailable(PerfCounters::TaskClock)) {
+        EXPECT_EQ(stats.getPerInteraction(PerfCounters::TaskClock, PerfStats::Force, true), 3.0);
+    } else {
+        EXPECT_TRUE(std::isnan(stats.getPerInteraction(PerfCounters::TaskClock)));
+    }
+    if (stats.isAvailable(PerfCounters::Cycles) && stats.isAvailable(PerfCounters::Instructions)) {
+        EXPECT_EQ(stats.getIpc(PerfStats::Force), 1.5);
+    }
+
+    stats.reset();
+    EXPECT_EQ(stats.getSteps(), 0u);
+    EXPECT_EQ(stats.getCounts(PerfStats::Force, true).calls, 0u);
+}
@@ -2,9 +2,14 @@
 #ifndef TESTHELPER_H
 #define TESTHELPER_H
 
+#include "ObjectFactory.h"
+#include "Universe.h"
 #include "Vector.h"
+#include <cmath>
+#include <cstddef>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <random>
 
 // #define GRADUATE
 
@@ -29,6 +34,38 @@ inline vector2 makeVector2(double x = 0, double y = 0)
     return v;
 }
 
+/**
+ *  Registers a sun, earth and mars with the Universe.
+ */
+inline void makeSolarSystem()
+{
+    ObjectFactory::makeObject("sun", 1.98892e30);
+    ObjectFactory::makeObject(
+        "earth", 5.9742e24, makeVector2(149597870700.0, 0), makeVector2(0, 29788.4676));
+    ObjectFactory::makeObject(
+        "mars", 6.4171e23, makeVector2(0, 227939200000.0), makeVector2(-24077, 0));
+}
+
+/**
+ *  Registers a sun with planets earth-mass planets on circular orbits
+ *  scattered between 0.5 and 5 AU.
+ */
+inline void makePlanetarySystem(size_t planets)
+{
+    const double solarMass = 1.98892e30;
+    std::mt19937_64 generator(3251);
+    std::uniform_real_distribution<> unit(0.0, 1.0);
+    ObjectFactory::makeObject("sun", solarMass);
+    for (size_t i = 0; i < planets; ++i) {
+        const double radius = 1.5e11 * (0.5 + 4.5 * unit(generator));
+        const double angle = 6.283185307179586 * unit(generator);
+        const double speed = std::sqrt(Universe::G * solarMass / radius);
+        ObjectFactory::makeObject("planet", 5.9742e24,
+            makeVector2(radius * std::cos(angle), radius * std::sin(angle)),
+            makeVector2(-speed * std::sin(angle), speed * std::cos(angle)));
+    }
+}
+
 /**
  *  A RAII struct that will close an ifstream.
  */
@@ -0,0 +1,115 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "Object.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Universe.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The fixture for testing phase tracing; every test starts and ends with
+// tracing off and no events.
+class TraceTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        Trace::disable();
+        Trace::clear();
+    }
+
+    void TearDown() override
+    {
+        Trace::disable();
+        Trace::clear();
+    }
+
+    /**
+     *  Returns the exported trace.
+     */
+    static std::string exported()
+    {
+        std::ostringstream out;
+        Trace::writeChromeJson(out);
+        return out.str();
+    }
+
+    /**
+     *  Returns the number of complete events called name in json.
+     */
+    static size_t countEvents(const std::string& json, const std::string& name)
+    {
+        const std::string key = "{\"name\":\"" + name + "\",\"cat\":\"nbody\",\"ph\":\"X\"";
+        size_t count = 0;
+        for (size_t at = json.find(key); at != std::string::npos; at = json.find(key, at + 1)) {
+            ++count;
+        }
+        return count;
+    }
+};
+
+TEST_F(TraceTest, RecordsThePhasesOfAStep)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    Parser parser;
+    parser.loadFile("../tests/UCMtest.txt");
+    univ->stepSimulation(60);
+    EXPECT_EQ(Trace::getEventCount(), 0u);
+
+    Trace::enable();
+    EXPECT_TRUE(Trace::isEnabled());
+    univ->stepSimulation(60);
+    univ->advance(60, 3);
+    std::vector<Object*> snapshot = univ->getSnapshot();
+    univ->swap(snapshot);
+    Trace::disable();
+    univ->stepSimulation(60);
+
+    const std::string json = exported();
+    EXPECT_EQ(json.compare(0, 15, "{\"displayTimeUn"), 0);
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+    EXPECT_EQ(countEvents(json, "Universe::stepSimulation"), 1u);
+    EXPECT_EQ(countEvents(json, "Universe::advance"), 1u);
+    EXPECT_EQ(countEvents(json, "Universe::sync"), 1u);
+    EXPECT_EQ(countEvents(json, "Integrator::step"), 4u);
+    EXPECT_EQ(countEvents(json, "Universe::getSnapshot"), 1u);
+    EXPECT_EQ(countEvents(json, "Universe::swap"), 1u);
+    EXPECT_EQ(countEvents(json, "Universe::release"), 1u);
+    EXPECT_GE(countEvents(json, "DirectEngine::computeAccelerations"), 4u);
+    EXPECT_EQ(countEvents(json, "Parser::loadFile"), 0u);
+    EXPECT_EQ(json.find("\"dur\":-"), std::string::npos);
+
+    Trace::clear();
+    EXPECT_EQ(Trace::getEventCount(), 0u);
+}
+
+TEST_F(TraceTest, KeepsABufferPerThread)
+{
+    ThreadPool pool(3);
+    Trace::enable();
+    pool.run(3, [](uint32_t) { TRACE_SCOPE("worker \"task\""); });
+    Trace::disable();
+    EXPECT_EQ(Trace::getEventCount(), 6u);
+
+    // Each of the three jobs and the tasks inside them lands on its own track.
+    const std::string json = exported();
+    EXPECT_EQ(countEvents(json, "ThreadPool::job"), 3u);
+    EXPECT_EQ(countEvents(json, "worker \\\"task\\\""), 3u);
+    std::set<std::string> threads;
+    const std::string key = "{\"name\":\"ThreadPool::job\"";
+    for (size_t at = json.find(key); at != std::string::npos; at = json.find(key, at + 1)) {
+        const size_t tid = json.find("\"tid\":", at);
+        threads.insert(json.substr(tid, json.find('}', tid) - tid));
+    }
+    EXPECT_EQ(threads.size(), 3u);
+}
+
+TEST_F(TraceTest, ReportsAnUnwritableFile)
+{
+    EXPECT_THROW(Trace::writeChromeJson("/nonexistent/trace.json"), std::runtime_error);
+}
@@ -0,0 +1,289 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "ObjectFactory.h"
+#include "Trajectory.h"
+#include "Universe.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// The fixture for testing the trajectory recorder on a small solar system.
+class TrajectoryTest : public ::testing::Test {
+protected:
+    virtual void TearDown()
+    {
+        std::remove(path);
+    }
+
+    /**
+     *  Returns every frame of the trajectory at path.
+     */
+    std::vector<TrajectoryReader::Frame> readAll()
+    {
+        TrajectoryReader reader(path);
+        std::vector<TrajectoryReader::Frame> frames(1);
+        while (reader.next(frames.back())) {
+            frames.emplace_back();
+        }
+        frames.pop_back();
+        return frames;
+    }
+
+    /**
+     *  Offers count steps of a store of 4096 bodies to recorder as fast as
+     *  possible, moving one body every step.
+     */
+    static void flood(TrajectoryRecorder& recorder, uint64_t count)
+    {
+        BodyStore bodies;
+        bodies.resize(4096);
+        for (uint64_t step = 1; step <= count; ++step) {
+            bodies.position[0][step % 4096] = static_cast<double>(step);
+            recorder.record(bodies, step, static_cast<double>(step));
+        }
+        recorder.close();
+    }
+
+    const char* path = "trajectoryTest.trj";
+};
+
+TEST_F(TrajectoryTest, RecordsTheStridedSteps)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makeSolarSystem();
+    univ->setRecorder(std::unique_ptr<TrajectoryRecorder>(
+        new TrajectoryRecorder(path, 10, std::vector<size_t> { 2, 1 })));
+
+    // Sample the bodies on the same steps to compare against.
+    std::vector<vector2> earth(1, univ->getBodies().getPosition(1));
+    std::vector<vector2> mars(1, univ->getBodies().getVelocity(2));
+    univ->advance(3600, 95, 10, [&](uint64_t) {
+        earth.push_back(univ->getBodies().getPosition(1));
+        mars.push_back(univ->getBodies().getVelocity(2));
+    });
+    univ->stepSimulation(3600);
+    univ->getRecorder()->close();
+    EXPECT_EQ(univ->getRecorder()->getRecorded(), 10u);
+    EXPECT_EQ(univ->getRecorder()->getDropped(), 0u);
+
+    TrajectoryReader reader(path);
+    EXPECT_EQ(reader.getRows(), (std::vector<size_t> { 2, 1 }));
+    std::vector<TrajectoryReader::Frame> frames = readAll();
+    ASSERT_EQ(frames.size(), 10u);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(frames[i].step, 10 * i);
+        EXPECT_EQ(frames[i].time, 36000.0 * i);
+        EXPECT_EQ(frames[i].position[0][1], earth[i][0]);
+        EXPECT_EQ(frames[i].position[1][1], earth[i][1]);
+        EXPECT_EQ(frames[i].velocity[0][0], mars[i][0]);
+        EXPECT_EQ(frames[i].velocity[1][0], mars[i][1]);
+    }
+}
+
+TEST_F(TrajectoryTest, BlockingKeepsEveryFrame)
+{
+    TrajectoryRecorder recorder(
+        path, 1, std::vector<size_t>(), TrajectoryRecorder::Policy::Block, 2);
+    flood(recorder, 500);
+    EXPECT_EQ(recorder.getRecorded(), 500u);
+    EXPECT_EQ(recorder.getDropped(), 0u);
+    EXPECT_EQ(recorder.getRows().size(), 4096u);
+
+    std::vector<TrajectoryReader::Frame> frames = readAll();
+    ASSERT_EQ(frames.size(), 500u);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        ASSERT_EQ(frames[i].step, i + 1);
+        EXPECT_EQ(frames[i].position[0][(i + 1) % 4096], i + 1.0);
+    }
+}
+
+TEST_F(TrajectoryTest, DroppingNeverWaits)
+{
+    for (TrajectoryRecorder::Policy policy :
+        { TrajectoryRecorder::Policy::Drop, TrajectoryRecorder::Policy::Downsample }) {
+        TrajectoryRecorder recorder(path, 2, std::vector<size_t>(), policy, 2);
+        flood(recorder, 1000);
+        EXPECT_EQ(recorder.getRecorded() + recorder.getDropped(), 500u);
+        EXPECT_EQ(recorder.getLate(), 0u);
+
+        // Whatever was kept is intact and in order.
+        std::vector<TrajectoryReader::Frame> frames = readAll();
+        ASSERT_EQ(frames.size(), recorder.getRecorded());
+        for (size_t i = 0; i < frames.size(); ++i) {
+            EXPECT_EQ(frames[i].step % 2, 0u);
+            EXPECT_EQ(frames[i].position[0][frames[i].step % 4096],
+                static_cast<double>(frames[i].step));
+            if (i > 0) {
+                EXPECT_GT(frames[i].step, frames[i - 1].step);
+            }
+        }
+    }
+}
+
+TEST_F(TrajectoryTest, RejectsBadArguments)
+{
+    EXPECT_THROW(TrajectoryRecorder recorder("trajectoryTestMissing/x.trj"), std::runtime_error);
+    EXPECT_THROW(TrajectoryRecorder recorder(path, 0), std::invalid_argument);
+
+    TrajectoryRecorder recorder(path, 1, std::vector<size_t> { 5 });
+    BodyStore bodies;
+    bodies.resize(3);
+    EXPECT_THROW(recorder.record(bodies, 0, 0.0), std::out_of_range);
+    recorder.close();
+    EXPECT_THROW(recorder.record(bodies, 0, 0.0), std::logic_error);
+    EXPECT_THROW(TrajectoryReader3 reader(path), std::runtime_error);
+}
+
+TEST_F(TrajectoryTest, CompressionKeepsTheErrorBound)
+{
+    BodyStore expected;
+    std::vector<TrajectoryReader::Frame> exact;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        TrajectoryRecorder* recorder = new TrajectoryRecorder(path);
+        recorder->setErrorBound(1.0, 1.0e-3);
+        EXPECT_THROW(recorder->setErrorBound(-1.0, 1.0), std::invalid_argument);
+        univ->setRecorder(std::unique_ptr<TrajectoryRecorder>(recorder));
+        EXPECT_THROW(recorder->setErrorBound(2.0, 1.0e-3), std::logic_error);
+        univ->advance(3600, 200, 1, [&](uint64_t) {
+            const BodyStore& bodies = univ->getBodies();
+            exact.emplace_back();
+            for (uint32_t axis = 0; axis < 2; ++axis) {
+                exact.back().position[axis].assign(
+                    bodies.position[axis].begin(), bodies.position[axis].end());
+                exact.back().velocity[axis].assign(
+                    bodies.velocity[axis].begin(), bodies.velocity[axis].end());
+            }
+        });
+        univ->getRecorder()->close();
+    }
+
+    std::vector<TrajectoryReader::Frame> frames = readAll();
+    ASSERT_EQ(frames.size(), 201u);
+    for (size_t i = 1; i < frames.size(); ++i) {
+        EXPECT_EQ(frames[i].step, i);
+        for (uint32_t axis = 0; axis < 2; ++axis) {
+            for (size_t row = 0; row < 3; ++row) {
+                // Rounding the reconstruction may add an ulp of the value.
+                const double position = exact[i - 1].position[axis][row];
+                const double velocity = exact[i - 1].velocity[axis][row];
+                EXPECT_LE(std::fabs(frames[i].position[axis][row] - position),
+                    1.0 + 1e-12 * std::fabs(position));
+                EXPECT_LE(std::fabs(frames[i].velocity[axis][row] - velocity),
+                    1.0e-3 + 1e-12 * std::fabs(velocity));
+            }
+        }
+    }
+}
+
+TEST_F(TrajectoryTest, CodecRoundTripsExtremes)
+{
+    TrajectoryCodec codec(4, 0.5, 0.5);
+    TrajectoryCodec decoder(4, 0.5, 0.5);
+    TrajectoryCodec::Frame frame;
+    TrajectoryCodec::Frame decoded;
+    const double values[4] = { 0.0, -3.0, 1.0e17, -7.0e16 };
+    std::vector<uint8_t> bytes;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (uint32_t axis = 0; axis < 2; ++axis) {
+            frame.position[axis].assign(values, values + 4);
+            frame.velocity[axis].assign(4, repeat * 1.0e15);
+        }
+        codec.encode(frame, bytes);
+        decoder.decode(bytes.data(), bytes.size(), decoded);
+        for (uint32_t axis = 0; axis < 2; ++axis) {
+            EXPECT_EQ(decoded.position[axis], frame.position[axis]);
+            EXPECT_EQ(decoded.velocity[axis], frame.velocity[axis]);
+        }
+    }
+    EXPECT_THROW(decoder.decode(bytes.data(), 3, decoded), std::runtime_error);
+
+    frame.position[0][0] = 1.0e300;
+    EXPECT_THROW(codec.encode(frame, bytes), std::range_error);
+    frame.position[0][0] = std::nan("");
+    EXPECT_THROW(codec.encode(frame, bytes), std::range_error);
+}
+
+TEST_F(TrajectoryTest, SeeksFromTheNearestKeyframe)
+{
+    for (bool compressed : { false, true }) {
+        TrajectoryRecorder recorder(path, 2);
+        if (compressed)
+            recorder.setErrorBound(0.5, 0.5);
+        recorder.setKeyframeInterval(16);
+        EXPECT_THROW(recorder.setKeyframeInterval(0), std::invalid_argument);
+        flood(recorder, 200);
+        EXPECT_THROW(recorder.setKeyframeInterval(8), std::logic_error);
+        std::vector<TrajectoryReader::Frame> frames = readAll();
+        ASSERT_EQ(frames.size(), 100u);
+
+        TrajectoryReader reader(path);
+        ASSERT_EQ(reader.getKeyframes().size(), 7u);
+        EXPECT_EQ(reader.getKeyframes()[1].step, 34u);
+        TrajectoryReader::Frame frame;
+        // Forwards, backwards, between frames and onto a keyframe.
+        for (uint64_t step : { 150u, 7u, 99u, 34u, 200u, 0u }) {
+            ASSERT_TRUE(reader.seek(step));
+            ASSERT_TRUE(reader.next(frame));
+            const size_t index = (std::max<uint64_t>(step, 1) - 1) / 2;
+            const TrajectoryReader::Frame& expected = frames[index];
+            EXPECT_EQ(frame.step, expected.step);
+            EXPECT_EQ(frame.position[0], expected.position[0]);
+            EXPECT_EQ(frame.velocity[1], expected.velocity[1]);
+            // Reading goes on from there.
+            if (step < 200) {
+                ASSERT_TRUE(reader.next(frame));
+                EXPECT_EQ(frame.position[0], frames[index + 1].position[0]);
+            }
+        }
+        EXPECT_TRUE(reader.seekTime(61.5));
+        ASSERT_TRUE(reader.next(frame));
+        EXPECT_EQ(frame.step, 62u);
+        EXPECT_FALSE(reader.seek(201));
+        EXPECT_FALSE(reader.next(frame));
+    }
+}
+
+TEST_F(TrajectoryTest, SeeksWithoutAnIndex)
+{
+    TrajectoryRecorder recorder(path);
+    recorder.setErrorBound(0.5, 0.5);
+    recorder.setKeyframeInterval(10);
+    flood(recorder, 95);
+    std::vector<TrajectoryReader::Frame> frames = readAll();
+
+    // Drop the index and half of the last frame, as a crash might.
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    uint64_t count = 0;
+    std::memcpy(&count, bytes.data() + bytes.size() - 24, sizeof(count));
+    bytes.resize(bytes.size() - 24 - 24 * count - 5);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    TrajectoryReader reader(path);
+    EXPECT_EQ(reader.getKeyframes().size(), 10u);
+    TrajectoryReader::Frame frame;
+    ASSERT_TRUE(reader.seek(57));
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.step, 57u);
+    EXPECT_EQ(frame.position[0], frames[56].position[0]);
+    ASSERT_TRUE(reader.seek(94));
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_FALSE(reader.next(frame));
+    EXPECT_FALSE(reader.seek(95));
+}
@@ -0,0 +1,275 @@
+/* @author G. Hemingway, copyright 2020 - All rights reserved */
+#include "./testHelper.h"
+#include "Integrator.h"
+#include "Object.h"
+#include "ObjectFactory.h"
+#include "Parser.h"
+#include "Universe.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// The fixture for testing the Universe's stepping API on a small solar system.
+class UniverseTest : public ::testing::Test {
+protected:
+    /**
+     *  Registers the bodies of makeSolarSystem with the 3D Universe. Vectors
+     *  are lifted to z = 0, then tilted out of that plane if incline is set.
+     */
+    void makeSystem3(bool incline)
+    {
+        ObjectFactory3::makeObject("sun", 1.98892e30);
+        ObjectFactory3::makeObject("earth", 5.9742e24,
+            place(makeVector2(149597870700.0, 0), incline),
+            place(makeVector2(0, 29788.4676), incline));
+        ObjectFactory3::makeObject("mars", 6.4171e23,
+            place(makeVector2(0, 227939200000.0), incline), place(makeVector2(-24077, 0), incline));
+    }
+
+    /**
+     *  Lifts v to z = 0 and, if incline is set, rotates it by 30 degrees
+     *  about the x axis and then by 40 degrees about the z axis.
+     */
+    static vector3 place(const vector2& v, bool incline)
+    {
+        vector3 ret;
+        ret[0] = v[0];
+        ret[1] = v[1];
+        if (!incline)
+            return ret;
+        const double a = 30.0 * M_PI / 180.0;
+        const double b = 40.0 * M_PI / 180.0;
+        const double y = v[1] * std::cos(a);
+        ret[0] = v[0] * std::cos(b) - y * std::sin(b);
+        ret[1] = v[0] * std::sin(b) + y * std::cos(b);
+        ret[2] = v[1] * std::sin(a);
+        return ret;
+    }
+
+    /**
+     *  Returns the position of every registered Object.
+     */
+    std::vector<vector2> positions(const Universe& univ)
+    {
+        std::vector<vector2> ret;
+        for (Universe::const_iterator i = univ.begin(); i != univ.end(); ++i) {
+            ret.push_back((*i)->getPosition());
+        }
+        return ret;
+    }
+};
+
+TEST_F(UniverseTest, AdvanceMatchesStepping)
+{
+    std::vector<std::vector<vector2>> expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        for (int step = 1; step <= 250; ++step) {
+            univ->stepSimulation(60);
+            if (step % 100 == 0 || step == 250)
+                expected.push_back(positions(*univ));
+        }
+    }
+
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makeSolarSystem();
+    std::vector<uint64_t> sampled;
+    univ->advance(60, 250, 100, [&](uint64_t step) {
+        EXPECT_EQ(positions(*univ), expected[sampled.size()]);
+        sampled.push_back(step);
+    });
+    EXPECT_EQ(sampled, (std::vector<uint64_t> { 100, 200, 250 }));
+    EXPECT_EQ(positions(*univ), expected.back());
+    assertVector((**univ->begin()).getPosition(), vector2());
+}
+
+TEST_F(UniverseTest, AdvancePublishesOnlyAtTheEnd)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    makeSolarSystem();
+    std::vector<vector2> start = positions(*univ);
+
+    univ->advance(60, 0);
+    EXPECT_EQ(positions(*univ), start);
+
+    uint64_t samples = 0;
+    univ->advance(60, 50, 0, [&](uint64_t step) {
+        EXPECT_EQ(step, 50u);
+        ++samples;
+    });
+    EXPECT_EQ(samples, 1u);
+    EXPECT_NE(positions(*univ)[1], start[1]);
+}
+
+TEST_F(UniverseTest, AdvanceFollowsTheYearlongOrbit)
+{
+    // The reference of UMCTest, read through the Objects advance publishes.
+    std::ifstream file("../tests/testData.txt", std::ifstream::in);
+    if (file.fail())
+        GTEST_SKIP() << "no ../tests/testData.txt";
+    FileCloser closer(file);
+    const double step = 1;
+    const uint64_t io = 100;
+    std::unique_ptr<Universe> univ(Universe::instance());
+    ObjectFactory::makeObject("sun", 1.98892e30);
+    ObjectFactory::makeObject(
+        "earth", 5.9742e24, makeVector2(149597870700.0, 0), makeVector2(0, 29788.4676));
+
+    const double year_s = 31554195.932106005998594489072144;
+    const uint64_t steps = static_cast<uint64_t>(std::ceil(year_s / step));
+    univ->advance(step, steps, io, [&](uint64_t done) {
+        if (done % io != 0)
+            return;
+        vector2 check;
+        file >> check[0] >> check[1];
+        assertVector((**(++univ->begin())).getPosition(), check, 1000000.0);
+    });
+}
+
+TEST_F(UniverseTest, FlatSystemInSpaceMatchesThePlane)
+{
+    std::vector<vector2> expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->advance(60, 250);
+        expected = positions(*univ);
+    }
+
+    // With every z at zero the 3D kernels only add exact zeros.
+    std::unique_ptr<Universe3> univ(Universe3::instance());
+    makeSystem3(false);
+    univ->advance(60, 250);
+    size_t row = 0;
+    for (Universe3::const_iterator i = univ->begin(); i != univ->end(); ++i, ++row) {
+        vector3 pos = (*i)->getPosition();
+        EXPECT_EQ(pos[0], expected[row][0]);
+        EXPECT_EQ(pos[1], expected[row][1]);
+        EXPECT_EQ(pos[2], 0.0);
+    }
+}
+
+TEST_F(UniverseTest, InclinedOrbitMatchesTheRotatedPlane)
+{
+    std::vector<vector2> expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+        makeSolarSystem();
+        univ->advance(3600, 24 * 30);
+        expected = positions(*univ);
+    }
+
+    // Gravity is isotropic, so the tilted system evolves as the plane does.
+    std::unique_ptr<Universe3> univ(Universe3::instance());
+    univ->setIntegrator(std::unique_ptr<Integrator3>(new LeapfrogIntegrator3()));
+    makeSystem3(true);
+    univ->advance(3600, 24 * 30);
+    size_t row = 0;
+    for (Universe3::const_iterator i = univ->begin(); i != univ->end(); ++i, ++row) {
+        vector3 correct = place(expected[row], true);
+        EXPECT_LT(((*i)->getPosition() - correct).norm(), 1.0);
+    }
+}
+
+TEST_F(UniverseTest, ParserReadsThreeComponents)
+{
+    const char* path = "universeTest3d.txt";
+    {
+        std::ofstream script(path);
+        script << "sun 1.98892e30 [0 0 0] [0 0 0]\n";
+        script << "earth 5.9742e24 [149597870700 0 1000] [0 29788.4676 12]\n";
+    }
+    std::unique_ptr<Universe3> univ(Universe3::instance());
+    Parser3().loadFile(path);
+    std::remove(path);
+    ASSERT_EQ(univ->getBodies().size(), 2u);
+    vector3 pos = univ->getBodies().getPosition(1);
+    vector3 vel = univ->getBodies().getVelocity(1);
+    EXPECT_EQ(pos[0], 149597870700.0);
+    EXPECT_EQ(pos[2], 1000.0);
+    EXPECT_EQ(vel[1], 29788.4676);
+    EXPECT_EQ(vel[2], 12.0);
+}
+
+TEST_F(UniverseTest, AdvanceToEndsOnTimeInFewSteps)
+{
+    const double year = 31554195.932106005998594489072144;
+    std::vector<vector2> expected;
+    {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+        univ->advance(year / 1000000, 1000000);
+        expected = positions(*univ);
+    }
+
+    std::vector<double> errors;
+    for (double tolerance : { 1e-3, 1e-4 }) {
+        std::unique_ptr<Universe> univ(Universe::instance());
+        makeSolarSystem();
+        univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+        const uint64_t steps = univ->advanceTo(year, tolerance);
+        EXPECT_EQ(univ->getStepCount(), steps);
+        EXPECT_EQ(univ->getTime(), year);
+        EXPECT_LT(steps, 100.0 / tolerance);
+        EXPECT_LT(univ->getRejectedSteps(), steps / 100 + 2);
+        assertVector(positions(*univ)[0], vector2());
+        errors.push_back((positions(*univ)[1] - expected[1]).norm());
+        EXPECT_EQ(univ->advanceTo(year, tolerance), 0u);
+    }
+    // UMCTest allows a thousand kilometres after a year of one-second steps.
+    EXPECT_LT(errors[0], 1.0e6);
+    // The error of a leapfrog falls with the square of the tolerance.
+    EXPECT_LT(errors[1], errors[0] / 50);
+}
+
+TEST_F(UniverseTest, AdvanceToRetriesWithoutEvaluatingTheStartAgain)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    ObjectFactory::makeObject("sun", 1.98892e30);
+    // Falling almost straight in, the steps grow until the plunge rejects them.
+    ObjectFactory::makeObject(
+        "comet", 1.0e14, makeVector2(149597870700.0, 0), makeVector2(0, 0.02 * 29788.4676));
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+
+    const uint64_t steps = univ->advanceTo(1.0e7, 1e-2);
+    EXPECT_GT(univ->getRejectedSteps(), 0u);
+    // Every trial, rejected or not, evaluates the two bodies once at its end.
+    EXPECT_EQ(univ->getIntegrator().getEvaluations(), 2 * (1 + steps + univ->getRejectedSteps()));
+}
+
+TEST_F(UniverseTest, AdvanceToShortensTheStepsNearThePerihelion)
+{
+    std::unique_ptr<Universe> univ(Universe::instance());
+    ObjectFactory::makeObject("sun", 1.98892e30);
+    ObjectFactory::makeObject(
+        "comet", 1.0e14, makeVector2(149597870700.0, 0), makeVector2(0, 0.5 * 29788.4676));
+    univ->setIntegrator(std::unique_ptr<Integrator>(new LeapfrogIntegrator()));
+    univ->setDiagnostics(true);
+
+    std::vector<double> times = { univ->getTime() };
+    const uint64_t steps = univ->advanceTo(3.0e7, 1e-2, 1, [&](uint64_t step) {
+        EXPECT_EQ(step, times.size());
+        times.push_back(univ->getTime());
+    });
+    ASSERT_EQ(times.size(), steps + 1);
+    double shortest = times[1] - times[0];
+    double longest = shortest;
+    for (size_t i = 1; i < times.size(); ++i) {
+        shortest = std::min(shortest, times[i] - times[i - 1]);
+        longest = std::max(longest, times[i] - times[i - 1]);
+    }
+    EXPECT_GT(longest, 10 * shortest);
+    EXPECT_LT(std::abs(univ->getDiagnostics()->getMaxEnergyDrift()), 1e-3);
+
+    EXPECT_THROW(univ->advanceTo(4.0e7, 0.0), std::invalid_argument);
+    EXPECT_THROW(univ->advanceTo(1.0e7, 1e-2), std::invalid_argument);
+    EXPECT_EQ(univ->getTime(), 3.0e7);
+}